@@ -0,0 +1,57 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread. Each side caches the other
+// side's index and only reloads it when the queue looks full or empty, so the shared cache lines are rarely touched
+template<typename T, uint32_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+    SpscQueue() : m_Slots(Capacity) {}
+
+    // Producer side, returns false without blocking when the queue is full
+    bool tryPush(const T& p_Value)
+    {
+        const uint32_t l_Tail = m_Tail.load(std::memory_order_relaxed);
+        if (l_Tail - m_CachedHead == Capacity)
+        {
+            m_CachedHead = m_Head.load(std::memory_order_acquire);
+            if (l_Tail - m_CachedHead == Capacity)
+                return false;
+        }
+        m_Slots[l_Tail & MASK] = p_Value;
+        m_Tail.store(l_Tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer side, returns false without blocking when the queue is empty
+    bool tryPop(T& p_Value)
+    {
+        const uint32_t l_Head = m_Head.load(std::memory_order_relaxed);
+        if (l_Head == m_CachedTail)
+        {
+            m_CachedTail = m_Tail.load(std::memory_order_acquire);
+            if (l_Head == m_CachedTail)
+                return false;
+        }
+        p_Value = m_Slots[l_Head & MASK];
+        m_Head.store(l_Head + 1, std::memory_order_release);
+        return true;
+    }
+
+private:
+    static constexpr uint32_t MASK = Capacity - 1;
+
+    // Indices grow without wrapping to the capacity, unsigned overflow keeps their difference right
+    alignas(64) std::atomic<uint32_t> m_Head{ 0 };
+    uint32_t m_CachedTail = 0;
+    alignas(64) std::atomic<uint32_t> m_Tail{ 0 };
+    uint32_t m_CachedHead = 0;
+
+    std::vector<T> m_Slots;
+};
@@ -0,0 +1,41 @@
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstdint>
+
+// Hands the latest value from one producer thread to one consumer thread without locks or waiting. The producer
+// fills its private buffer and swaps it with the shared one, the consumer swaps its buffer with the shared one when
+// it is newer. Values published in between are skipped, only the most recent one is ever read
+template<typename T>
+class TripleBuffer
+{
+public:
+    // Producer side. The buffer holds an older value, every field has to be written before publishing
+    [[nodiscard]] T& getWriteBuffer() { return m_Buffers[m_WriteIndex]; }
+    void publish()
+    {
+        const uint8_t l_Previous = m_Shared.exchange(static_cast<uint8_t>(m_WriteIndex | DIRTY_BIT), std::memory_order_acq_rel);
+        m_WriteIndex = l_Previous & INDEX_MASK;
+    }
+
+    // Consumer side, returns whether a newer value was picked up
+    bool update()
+    {
+        if ((m_Shared.load(std::memory_order_relaxed) & DIRTY_BIT) == 0)
+            return false;
+        const uint8_t l_Previous = m_Shared.exchange(m_ReadIndex, std::memory_order_acq_rel);
+        m_ReadIndex = l_Previous & INDEX_MASK;
+        return true;
+    }
+    [[nodiscard]] const T& getReadBuffer() const { return m_Buffers[m_ReadIndex]; }
+
+private:
+    static constexpr uint8_t INDEX_MASK = 0x3;
+    static constexpr uint8_t DIRTY_BIT = 0x4;
+
+    std::array<T, 3> m_Buffers{};
+    uint8_t m_WriteIndex = 0;
+    uint8_t m_ReadIndex = 1;
+    std::atomic<uint8_t> m_Shared{ 2 };
+};
@@ -0,0 +1,69 @@
+#include "culling_benchmark.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <vector>
+#include <glm/gtc/matrix_transform.hpp>
+
+#include "culling/frustum_culler.hpp"
+
+static constexpr uint32_t BENCHMARK_ITERATIONS = 50;
+
+static void benchmarkConfiguration(FrustumCuller& p_Culler, const Frustum& p_Frustum, const AabbSoA& p_Boxes, std::ostream& p_Stream)
+{
+    std::vector<uint32_t> l_Visible{};
+    l_Visible.reserve(p_Boxes.size());
+
+    // Warm up so page faults on the output and thread start up of the first run don't end up in the numbers
+    p_Culler.cull(p_Frustum, p_Boxes, l_Visible);
+
+    const std::chrono::steady_clock::time_point l_Start = std::chrono::steady_clock::now();
+    uint32_t l_VisibleCount = 0;
+    for (uint32_t i = 0; i < BENCHMARK_ITERATIONS; i++)
+        l_VisibleCount = p_Culler.cull(p_Frustum, p_Boxes, l_Visible);
+    const double l_Ms = std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - l_Start).count() / BENCHMARK_ITERATIONS;
+
+    const uint32_t l_Threads = p_Boxes.size() >= FrustumCuller::PARALLEL_THRESHOLD ? p_Culler.getThreadCount() : 1;
+    p_Stream << std::fixed << std::setprecision(3)
+        << FrustumCuller::getPathName(p_Culler.getPath()) << " x" << l_Threads
+        << " | " << l_Ms << " ms"
+        << " | " << (l_Ms > 0.0 ? p_Boxes.size() / l_Ms / 1000.0 : 0.0) << " Mboxes/s"
+        << " | visible: " << l_VisibleCount << "\n";
+}
+
+void runCullingBenchmark(const uint32_t p_Count, std::ostream& p_Stream)
+{
+    std::mt19937 l_Rng{ 1234 };
+    std::uniform_real_distribution<float> l_Position{ -500.0f, 500.0f };
+    std::uniform_real_distribution<float> l_Size{ 0.5f, 5.0f };
+
+    AabbSoA l_Boxes{};
+    l_Boxes.reserve(p_Count);
+    for (uint32_t i = 0; i < p_Count; i++)
+        l_Boxes.push({ l_Position(l_Rng), l_Position(l_Rng), l_Position(l_Rng) }, glm::vec3{ l_Size(l_Rng) });
+
+    const glm::mat4 l_Proj = glm::perspective(glm::radians(60.0f), 16.0f / 9.0f, 0.1f, 400.0f);
+    const glm::mat4 l_View = glm::lookAt(glm::vec3{ 0.0f }, glm::vec3{ 0.0f, 0.0f, -1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f });
+    const Frustum l_Frustum = Frustum::fromMatrix(l_Proj * l_View);
+
+    p_Stream << "Culling " << p_Count << " boxes, " << BENCHMARK_ITERATIONS << " iterations\n";
+
+    FrustumCuller l_Culler{};
+    const FrustumCuller::Path l_Best = l_Culler.getPath();
+    const uint32_t l_Threads = l_Culler.getThreadCount();
+    l_Culler.setThreadCount(1);
+    for (const FrustumCuller::Path l_Path : { FrustumCuller::Path::SCALAR, FrustumCuller::Path::SSE, FrustumCuller::Path::AVX })
+    {
+        if (l_Path > l_Best)
+            break;
+        l_Culler.setPath(l_Path);
+        benchmarkConfiguration(l_Culler, l_Frustum, l_Boxes, p_Stream);
+    }
+
+    if (l_Threads > 1)
+    {
+        l_Culler.setThreadCount(l_Threads);
+        benchmarkConfiguration(l_Culler, l_Frustum, l_Boxes, p_Stream);
+    }
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Culls p_Count random boxes against a perspective frustum with every available path and thread setup
+void runCullingBenchmark(uint32_t p_Count, std::ostream& p_Stream);
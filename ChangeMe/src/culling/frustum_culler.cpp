@@ -0,0 +1,306 @@
+#include "frustum_culler.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "jobs/job_system.hpp"
+#include "mesh/mesh_file.hpp"
+
+#if defined(_M_X64) || defined(__x86_64__) || defined(_M_IX86) || defined(__i386__)
+#define CULLING_X86 1
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+// MSVC exposes every intrinsic regardless of /arch, the AVX path is only entered after the CPU check
+#define CULLING_TARGET_AVX
+#else
+#define CULLING_TARGET_AVX __attribute__((target("avx")))
+#endif
+#endif
+
+Frustum Frustum::fromMatrix(const glm::mat4& p_ViewProj)
+{
+    // Gribb/Hartmann, glm is column major so row i is m[0][i], m[1][i], m[2][i], m[3][i]
+    const auto l_Row = [&p_ViewProj](const int p_Row) { return glm::vec4{ p_ViewProj[0][p_Row], p_ViewProj[1][p_Row], p_ViewProj[2][p_Row], p_ViewProj[3][p_Row] }; };
+    const glm::vec4 l_X = l_Row(0);
+    const glm::vec4 l_Y = l_Row(1);
+    const glm::vec4 l_Z = l_Row(2);
+    const glm::vec4 l_W = l_Row(3);
+
+    Frustum l_Frustum{};
+    l_Frustum.planes = { l_W + l_X, l_W - l_X, l_W + l_Y, l_W - l_Y, l_W + l_Z, l_W - l_Z };
+    for (glm::vec4& l_Plane : l_Frustum.planes)
+    {
+        const float l_Length = glm::length(glm::vec3{ l_Plane });
+        if (l_Length > 0.0f)
+            l_Plane /= l_Length;
+    }
+    return l_Frustum;
+}
+
+void AabbSoA::clear()
+{
+    m_CenterX.clear();
+    m_CenterY.clear();
+    m_CenterZ.clear();
+    m_ExtentX.clear();
+    m_ExtentY.clear();
+    m_ExtentZ.clear();
+}
+
+void AabbSoA::reserve(const size_t p_Count)
+{
+    m_CenterX.reserve(p_Count);
+    m_CenterY.reserve(p_Count);
+    m_CenterZ.reserve(p_Count);
+    m_ExtentX.reserve(p_Count);
+    m_ExtentY.reserve(p_Count);
+    m_ExtentZ.reserve(p_Count);
+}
+
+void AabbSoA::push(const glm::vec3 p_Center, const glm::vec3 p_Extent)
+{
+    m_CenterX.push_back(p_Center.x);
+    m_CenterY.push_back(p_Center.y);
+    m_CenterZ.push_back(p_Center.z);
+    m_ExtentX.push_back(p_Extent.x);
+    m_ExtentY.push_back(p_Extent.y);
+    m_ExtentZ.push_back(p_Extent.z);
+}
+
+void AabbSoA::push(const MeshBounds& p_Bounds)
+{
+    const glm::vec3 l_Min{ p_Bounds.min[0], p_Bounds.min[1], p_Bounds.min[2] };
+    const glm::vec3 l_Max{ p_Bounds.max[0], p_Bounds.max[1], p_Bounds.max[2] };
+    push((l_Min + l_Max) * 0.5f, (l_Max - l_Min) * 0.5f);
+}
+
+#ifdef CULLING_X86
+static bool isAvxSupported()
+{
+#ifdef _MSC_VER
+    int l_Info[4];
+    __cpuid(l_Info, 1);
+    // AVX needs the CPU flag and the OS saving the YMM registers
+    const bool l_OsSaves = (l_Info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    return l_OsSaves && (l_Info[2] & (1 << 28)) != 0;
+#else
+    return __builtin_cpu_supports("avx");
+#endif
+}
+#endif
+
+FrustumCuller::FrustumCuller()
+{
+#ifdef CULLING_X86
+    m_BestPath = isAvxSupported() ? Path::AVX : Path::SSE;
+#endif
+    m_Path = m_BestPath;
+    setThreadCount(0);
+}
+
+void FrustumCuller::setPath(const Path p_Path)
+{
+    m_Path = std::min(p_Path, m_BestPath);
+}
+
+const char* FrustumCuller::getPathName(const Path p_Path)
+{
+    switch (p_Path)
+    {
+    case Path::SCALAR: return "scalar";
+    case Path::SSE: return "SSE";
+    case Path::AVX: return "AVX";
+    }
+    return "unknown";
+}
+
+void FrustumCuller::setThreadCount(const uint32_t p_Count)
+{
+    m_ThreadCount = p_Count != 0 ? p_Count : std::max(1u, std::thread::hardware_concurrency());
+}
+
+uint32_t FrustumCuller::cull(const Frustum& p_Frustum, const AabbSoA& p_Boxes, std::vector<uint32_t>& p_Visible) const
+{
+    const uint32_t l_Count = p_Boxes.size();
+    p_Visible.resize(l_Count);
+
+    const uint32_t l_Threads = l_Count >= PARALLEL_THRESHOLD ? m_ThreadCount : 1;
+    if (l_Threads <= 1)
+    {
+        const uint32_t l_Visible = cullRange(p_Frustum, p_Boxes, 0, l_Count, p_Visible.data());
+        p_Visible.resize(l_Visible);
+        return l_Visible;
+    }
+
+    // Every thread writes into its own slice of the output, slices are then packed in order so the list stays sorted.
+    // Slice sizes are kept a multiple of 8 so only the last one runs a scalar tail
+    const uint32_t l_Slice = (l_Count / l_Threads + 7) & ~7u;
+    std::vector<uint32_t> l_SliceCounts(l_Threads, 0);
+    const auto l_CullSlice = [&](const uint32_t p_SliceIndex)
+    {
+        const uint32_t l_Begin = std::min(l_Count, p_SliceIndex * l_Slice);
+        const uint32_t l_End = p_SliceIndex + 1 == l_Threads ? l_Count : std::min(l_Count, l_Begin + l_Slice);
+        l_SliceCounts[p_SliceIndex] = cullRange(p_Frustum, p_Boxes, l_Begin, l_End, p_Visible.data() + l_Begin);
+    };
+    if (m_JobSystem != nullptr)
+    {
+        m_JobSystem->parallelFor(l_Threads, 1, [&](const uint32_t p_Begin, const uint32_t p_End)
+        {
+            for (uint32_t i = p_Begin; i < p_End; i++)
+                l_CullSlice(i);
+        });
+    }
+    else
+    {
+        std::vector<std::jthread> l_Workers{};
+        l_Workers.reserve(l_Threads - 1);
+        for (uint32_t i = 1; i < l_Threads; i++)
+            l_Workers.emplace_back(l_CullSlice, i);
+        l_CullSlice(0);
+    }
+
+    uint32_t l_Visible = l_SliceCounts[0];
+    for (uint32_t i = 1; i < l_Threads; i++)
+    {
+        const uint32_t l_Begin = std::min(l_Count, i * l_Slice);
+        std::memmove(p_Visible.data() + l_Visible, p_Visible.data() + l_Begin, l_SliceCounts[i] * sizeof(uint32_t));
+        l_Visible += l_SliceCounts[i];
+    }
+    p_Visible.resize(l_Visible);
+    return l_Visible;
+}
+
+static uint32_t cullScalar(const Frustum& p_Frustum, const float* const* p_Streams, const uint32_t p_Begin, const uint32_t p_End, uint32_t* p_Out)
+{
+    uint32_t l_Visible = 0;
+    for (uint32_t i = p_Begin; i < p_End; i++)
+    {
+        bool l_Inside = true;
+        for (const glm::vec4& l_Plane : p_Frustum.planes)
+        {
+            const float l_Distance = l_Plane.x * p_Streams[0][i] + l_Plane.y * p_Streams[1][i] + l_Plane.z * p_Streams[2][i] + l_Plane.w;
+            const float l_Radius = std::abs(l_Plane.x) * p_Streams[3][i] + std::abs(l_Plane.y) * p_Streams[4][i] + std::abs(l_Plane.z) * p_Streams[5][i];
+            if (l_Distance + l_Radius < 0.0f)
+            {
+                l_Inside = false;
+                break;
+            }
+        }
+        p_Out[l_Visible] = i;
+        l_Visible += l_Inside;
+    }
+    return l_Visible;
+}
+
+#ifdef CULLING_X86
+static uint32_t cullSse(const Frustum& p_Frustum, const float* const* p_Streams, const uint32_t p_Begin, const uint32_t p_End, uint32_t* p_Out)
+{
+    // Plane coefficients splatted once, then n.x, n.y, n.z, w, |n.x|, |n.y|, |n.z| per plane
+    __m128 l_Planes[6][7];
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        const glm::vec4& l_Plane = p_Frustum.planes[p];
+        l_Planes[p][0] = _mm_set1_ps(l_Plane.x);
+        l_Planes[p][1] = _mm_set1_ps(l_Plane.y);
+        l_Planes[p][2] = _mm_set1_ps(l_Plane.z);
+        l_Planes[p][3] = _mm_set1_ps(l_Plane.w);
+        l_Planes[p][4] = _mm_set1_ps(std::abs(l_Plane.x));
+        l_Planes[p][5] = _mm_set1_ps(std::abs(l_Plane.y));
+        l_Planes[p][6] = _mm_set1_ps(std::abs(l_Plane.z));
+    }
+
+    uint32_t l_Visible = 0;
+    uint32_t i = p_Begin;
+    for (; i + 4 <= p_End; i += 4)
+    {
+        const __m128 l_CX = _mm_loadu_ps(p_Streams[0] + i);
+        const __m128 l_CY = _mm_loadu_ps(p_Streams[1] + i);
+        const __m128 l_CZ = _mm_loadu_ps(p_Streams[2] + i);
+        const __m128 l_EX = _mm_loadu_ps(p_Streams[3] + i);
+        const __m128 l_EY = _mm_loadu_ps(p_Streams[4] + i);
+        const __m128 l_EZ = _mm_loadu_ps(p_Streams[5] + i);
+
+        __m128 l_Outside = _mm_setzero_ps();
+        for (const __m128* l_Plane : l_Planes)
+        {
+            const __m128 l_Distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l_Plane[0], l_CX), _mm_mul_ps(l_Plane[1], l_CY)), _mm_add_ps(_mm_mul_ps(l_Plane[2], l_CZ), l_Plane[3]));
+            const __m128 l_Radius = _mm_add_ps(_mm_add_ps(_mm_mul_ps(l_Plane[4], l_EX), _mm_mul_ps(l_Plane[5], l_EY)), _mm_mul_ps(l_Plane[6], l_EZ));
+            l_Outside = _mm_or_ps(l_Outside, _mm_cmplt_ps(_mm_add_ps(l_Distance, l_Radius), _mm_setzero_ps()));
+        }
+
+        uint32_t l_Mask = ~static_cast<uint32_t>(_mm_movemask_ps(l_Outside)) & 0xF;
+        while (l_Mask != 0)
+        {
+            p_Out[l_Visible++] = i + static_cast<uint32_t>(std::countr_zero(l_Mask));
+            l_Mask &= l_Mask - 1;
+        }
+    }
+    return l_Visible + cullScalar(p_Frustum, p_Streams, i, p_End, p_Out + l_Visible);
+}
+
+CULLING_TARGET_AVX static uint32_t cullAvx(const Frustum& p_Frustum, const float* const* p_Streams, const uint32_t p_Begin, const uint32_t p_End, uint32_t* p_Out)
+{
+    // Plane coefficients splatted once, then n.x, n.y, n.z, w, |n.x|, |n.y|, |n.z| per plane
+    __m256 l_Planes[6][7];
+    for (uint32_t p = 0; p < 6; p++)
+    {
+        const glm::vec4& l_Plane = p_Frustum.planes[p];
+        l_Planes[p][0] = _mm256_set1_ps(l_Plane.x);
+        l_Planes[p][1] = _mm256_set1_ps(l_Plane.y);
+        l_Planes[p][2] = _mm256_set1_ps(l_Plane.z);
+        l_Planes[p][3] = _mm256_set1_ps(l_Plane.w);
+        l_Planes[p][4] = _mm256_set1_ps(std::abs(l_Plane.x));
+        l_Planes[p][5] = _mm256_set1_ps(std::abs(l_Plane.y));
+        l_Planes[p][6] = _mm256_set1_ps(std::abs(l_Plane.z));
+    }
+
+    uint32_t l_Visible = 0;
+    uint32_t i = p_Begin;
+    for (; i + 8 <= p_End; i += 8)
+    {
+        const __m256 l_CX = _mm256_loadu_ps(p_Streams[0] + i);
+        const __m256 l_CY = _mm256_loadu_ps(p_Streams[1] + i);
+        const __m256 l_CZ = _mm256_loadu_ps(p_Streams[2] + i);
+        const __m256 l_EX = _mm256_loadu_ps(p_Streams[3] + i);
+        const __m256 l_EY = _mm256_loadu_ps(p_Streams[4] + i);
+        const __m256 l_EZ = _mm256_loadu_ps(p_Streams[5] + i);
+
+        __m256 l_Outside = _mm256_setzero_ps();
+        for (const __m256* l_Plane : l_Planes)
+        {
+            const __m256 l_Distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(l_Plane[0], l_CX), _mm256_mul_ps(l_Plane[1], l_CY)), _mm256_add_ps(_mm256_mul_ps(l_Plane[2], l_CZ), l_Plane[3]));
+            const __m256 l_Radius = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(l_Plane[4], l_EX), _mm256_mul_ps(l_Plane[5], l_EY)), _mm256_mul_ps(l_Plane[6], l_EZ));
+            l_Outside = _mm256_or_ps(l_Outside, _mm256_cmp_ps(_mm256_add_ps(l_Distance, l_Radius), _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+
+        uint32_t l_Mask = ~static_cast<uint32_t>(_mm256_movemask_ps(l_Outside)) & 0xFF;
+        while (l_Mask != 0)
+        {
+            p_Out[l_Visible++] = i + static_cast<uint32_t>(std::countr_zero(l_Mask));
+            l_Mask &= l_Mask - 1;
+        }
+    }
+    return l_Visible + cullScalar(p_Frustum, p_Streams, i, p_End, p_Out + l_Visible);
+}
+#endif
+
+uint32_t FrustumCuller::cullRange(const Frustum& p_Frustum, const AabbSoA& p_Boxes, const uint32_t p_Begin, const uint32_t p_End, uint32_t* p_Out) const
+{
+    const std::array<const float*, 6> l_Streams = {
+        p_Boxes.m_CenterX.data(), p_Boxes.m_CenterY.data(), p_Boxes.m_CenterZ.data(),
+        p_Boxes.m_ExtentX.data(), p_Boxes.m_ExtentY.data(), p_Boxes.m_ExtentZ.data()
+    };
+
+    switch (m_Path)
+    {
+#ifdef CULLING_X86
+    case Path::AVX: return cullAvx(p_Frustum, l_Streams.data(), p_Begin, p_End, p_Out);
+    case Path::SSE: return cullSse(p_Frustum, l_Streams.data(), p_Begin, p_End, p_Out);
+#endif
+    default: return cullScalar(p_Frustum, l_Streams.data(), p_Begin, p_End, p_Out);
+    }
+}
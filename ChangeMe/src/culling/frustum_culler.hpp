@@ -0,0 +1,78 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <vector>
+#include <glm/glm.hpp>
+
+struct MeshBounds;
+class JobSystem;
+
+// Planes point inwards, a point p is inside when dot(plane.xyz, p) + plane.w >= 0 for all of them
+struct Frustum
+{
+    std::array<glm::vec4, 6> planes;
+
+    // Works for both the [-1, 1] and [0, 1] depth conventions, with [0, 1] the near plane is just conservative
+    static Frustum fromMatrix(const glm::mat4& p_ViewProj);
+};
+
+// Axis aligned boxes stored as center/half extent streams so SIMD lanes load contiguous objects
+class AabbSoA
+{
+public:
+    void clear();
+    void reserve(size_t p_Count);
+    void push(glm::vec3 p_Center, glm::vec3 p_Extent);
+    void push(const MeshBounds& p_Bounds);
+
+    [[nodiscard]] uint32_t size() const { return static_cast<uint32_t>(m_CenterX.size()); }
+
+private:
+    std::vector<float> m_CenterX{};
+    std::vector<float> m_CenterY{};
+    std::vector<float> m_CenterZ{};
+    std::vector<float> m_ExtentX{};
+    std::vector<float> m_ExtentY{};
+    std::vector<float> m_ExtentZ{};
+
+    friend class FrustumCuller;
+};
+
+class FrustumCuller
+{
+public:
+    enum class Path : uint8_t
+    {
+        SCALAR,
+        SSE,
+        AVX
+    };
+
+    FrustumCuller();
+
+    // Writes the indices of the visible boxes in ascending order and returns how many there are
+    uint32_t cull(const Frustum& p_Frustum, const AabbSoA& p_Boxes, std::vector<uint32_t>& p_Visible) const;
+
+    // Defaults to the widest path the CPU supports, asking for an unsupported one falls back to the best available
+    void setPath(Path p_Path);
+    [[nodiscard]] Path getPath() const { return m_Path; }
+    [[nodiscard]] static const char* getPathName(Path p_Path);
+
+    // 0 uses every hardware thread. Small sets are always culled on the calling thread
+    void setThreadCount(uint32_t p_Count);
+    [[nodiscard]] uint32_t getThreadCount() const { return m_ThreadCount; }
+
+    // Slices run as jobs instead of on threads started for every call, nullptr goes back to plain threads
+    void setJobSystem(JobSystem* p_JobSystem) { m_JobSystem = p_JobSystem; }
+
+    static constexpr uint32_t PARALLEL_THRESHOLD = 32768;
+
+private:
+    uint32_t cullRange(const Frustum& p_Frustum, const AabbSoA& p_Boxes, uint32_t p_Begin, uint32_t p_End, uint32_t* p_Out) const;
+
+    Path m_Path = Path::SCALAR;
+    Path m_BestPath = Path::SCALAR;
+    uint32_t m_ThreadCount = 1;
+    JobSystem* m_JobSystem = nullptr;
+};
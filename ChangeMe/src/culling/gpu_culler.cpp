@@ -0,0 +1,219 @@
+#include "gpu_culler.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+#include "vulkan_buffer.hpp"
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+void GpuCuller::init(const ResourceID p_DeviceID, PipelineCache& p_PipelineCache, const uint32_t p_BufferFamilyIndex, const uint32_t p_FramesInFlight, const bool p_MultiDrawIndirect, const bool p_DrawIndirectCount)
+{
+    m_DeviceID = p_DeviceID;
+    m_BufferFamilyIndex = p_BufferFamilyIndex;
+    m_MultiDrawIndirect = p_MultiDrawIndirect;
+    m_DrawIndirectCount = p_DrawIndirectCount;
+
+    createPipeline(p_PipelineCache);
+    m_Readback.init(m_DeviceID, p_FramesInFlight * sizeof(uint32_t), "culling");
+}
+
+void GpuCuller::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    freeObjectBuffers();
+    m_Readback.free();
+
+    vkDestroyPipeline(*l_Device, m_Pipeline, nullptr);
+    vkDestroyPipelineLayout(*l_Device, m_PipelineLayout, nullptr);
+    vkDestroyDescriptorPool(*l_Device, m_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(*l_Device, m_SetLayout, nullptr);
+    m_Pipeline = VK_NULL_HANDLE;
+    m_PipelineLayout = VK_NULL_HANDLE;
+    m_DescriptorPool = VK_NULL_HANDLE;
+    m_SetLayout = VK_NULL_HANDLE;
+    m_DeviceID = UINT32_MAX;
+}
+
+UploadTicket GpuCuller::setObjects(UploadService& p_UploadService, const std::span<const GpuCullObject> p_Objects)
+{
+    if (p_Objects.empty())
+        throw std::runtime_error("GPU culling needs at least one object");
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    freeObjectBuffers();
+    m_ObjectCount = static_cast<uint32_t>(p_Objects.size());
+    m_Compact = m_DrawIndirectCount && m_ObjectCount <= m_MaxDrawIndirectCount;
+
+    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
+        .preferredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+    m_ObjectBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {p_Objects.size_bytes(), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_BufferFamilyIndex});
+    m_CommandBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {m_ObjectCount * sizeof(VkDrawIndexedIndirectCommand), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT, m_BufferFamilyIndex});
+    m_CountBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {sizeof(uint32_t), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_SRC_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_BufferFamilyIndex});
+
+    const std::array<VkDescriptorBufferInfo, 3> l_BufferInfos = {{
+        { *l_Device.getBuffer(m_ObjectBufferID), 0, VK_WHOLE_SIZE },
+        { *l_Device.getBuffer(m_CommandBufferID), 0, VK_WHOLE_SIZE },
+        { *l_Device.getBuffer(m_CountBufferID), 0, VK_WHOLE_SIZE }
+    }};
+    std::array<VkWriteDescriptorSet, 3> l_Writes{};
+    for (uint32_t i = 0; i < l_Writes.size(); i++)
+    {
+        l_Writes[i].sType = VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET;
+        l_Writes[i].dstSet = m_DescriptorSet;
+        l_Writes[i].dstBinding = i;
+        l_Writes[i].descriptorCount = 1;
+        l_Writes[i].descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        l_Writes[i].pBufferInfo = &l_BufferInfos[i];
+    }
+    vkUpdateDescriptorSets(*l_Device, static_cast<uint32_t>(l_Writes.size()), l_Writes.data(), 0, nullptr);
+
+    return p_UploadService.uploadBuffer(m_ObjectBufferID, p_Objects.data(), p_Objects.size_bytes());
+}
+
+void GpuCuller::recordCulling(const VkCommandBuffer p_CmdBuffer, const Frustum& p_Frustum) const
+{
+    const VkBuffer l_CountBuffer = getCountBuffer();
+
+    vkCmdFillBuffer(p_CmdBuffer, l_CountBuffer, 0, sizeof(uint32_t), 0);
+
+    VkMemoryBarrier l_ClearBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    l_ClearBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    l_ClearBarrier.dstAccessMask = VK_ACCESS_SHADER_READ_BIT | VK_ACCESS_SHADER_WRITE_BIT;
+    vkCmdPipelineBarrier(p_CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, 0, 1, &l_ClearBarrier, 0, nullptr, 0, nullptr);
+
+    PushData l_PushData{};
+    std::copy(p_Frustum.planes.begin(), p_Frustum.planes.end(), l_PushData.planes);
+    l_PushData.objectCount = m_ObjectCount;
+    l_PushData.compact = m_Compact ? 1 : 0;
+
+    vkCmdBindPipeline(p_CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_Pipeline);
+    vkCmdBindDescriptorSets(p_CmdBuffer, VK_PIPELINE_BIND_POINT_COMPUTE, m_PipelineLayout, 0, 1, &m_DescriptorSet, 0, nullptr);
+    vkCmdPushConstants(p_CmdBuffer, m_PipelineLayout, VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushData), &l_PushData);
+    vkCmdDispatch(p_CmdBuffer, (m_ObjectCount + WORKGROUP_SIZE - 1) / WORKGROUP_SIZE, 1, 1);
+}
+
+void GpuCuller::recordReadback(const VkCommandBuffer p_CmdBuffer, const uint32_t p_FrameSlot) const
+{
+    const VkBufferCopy l_CountCopy{ 0, p_FrameSlot * sizeof(uint32_t), sizeof(uint32_t) };
+    vkCmdCopyBuffer(p_CmdBuffer, getCountBuffer(), m_Readback.getBuffer(), 1, &l_CountCopy);
+
+    VkMemoryBarrier l_HostBarrier{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+    l_HostBarrier.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+    l_HostBarrier.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+    vkCmdPipelineBarrier(p_CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &l_HostBarrier, 0, nullptr, 0, nullptr);
+}
+
+void GpuCuller::recordDraw(const VkCommandBuffer p_CmdBuffer) const
+{
+    const VkBuffer l_CommandBuffer = getDrawCommandBuffer();
+    constexpr uint32_t STRIDE = sizeof(VkDrawIndexedIndirectCommand);
+    if (m_Compact)
+    {
+        vkCmdDrawIndexedIndirectCount(p_CmdBuffer, l_CommandBuffer, 0, getCountBuffer(), 0, m_ObjectCount, STRIDE);
+        return;
+    }
+
+    // Without multiDrawIndirect every indirect draw is limited to a single command
+    const uint32_t l_MaxDraws = m_MultiDrawIndirect ? m_MaxDrawIndirectCount : 1;
+    for (uint32_t l_First = 0; l_First < m_ObjectCount; l_First += l_MaxDraws)
+    {
+        const uint32_t l_DrawCount = std::min(l_MaxDraws, m_ObjectCount - l_First);
+        vkCmdDrawIndexedIndirect(p_CmdBuffer, l_CommandBuffer, static_cast<VkDeviceSize>(l_First) * STRIDE, l_DrawCount, STRIDE);
+    }
+}
+
+VkBuffer GpuCuller::getDrawCommandBuffer() const
+{
+    return *VulkanContext::getDevice(m_DeviceID).getBuffer(m_CommandBufferID);
+}
+
+VkBuffer GpuCuller::getCountBuffer() const
+{
+    return *VulkanContext::getDevice(m_DeviceID).getBuffer(m_CountBufferID);
+}
+
+uint32_t GpuCuller::getVisibleCount(const uint32_t p_FrameSlot) const
+{
+    m_Readback.invalidate();
+    return static_cast<const uint32_t*>(m_Readback.getData())[p_FrameSlot];
+}
+
+void GpuCuller::createPipeline(PipelineCache& p_PipelineCache)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    m_MaxDrawIndirectCount = std::max(l_Device.getGPU().getProperties().limits.maxDrawIndirectCount, 1U);
+
+    std::array<VkDescriptorSetLayoutBinding, 3> l_Bindings{};
+    for (uint32_t i = 0; i < l_Bindings.size(); i++)
+        l_Bindings[i] = { i, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1, VK_SHADER_STAGE_COMPUTE_BIT, nullptr };
+
+    VkDescriptorSetLayoutCreateInfo l_LayoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    l_LayoutInfo.bindingCount = static_cast<uint32_t>(l_Bindings.size());
+    l_LayoutInfo.pBindings = l_Bindings.data();
+    if (vkCreateDescriptorSetLayout(*l_Device, &l_LayoutInfo, nullptr, &m_SetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling descriptor set layout");
+
+    const VkDescriptorPoolSize l_PoolSize{ VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, static_cast<uint32_t>(l_Bindings.size()) };
+    VkDescriptorPoolCreateInfo l_PoolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    l_PoolInfo.maxSets = 1;
+    l_PoolInfo.poolSizeCount = 1;
+    l_PoolInfo.pPoolSizes = &l_PoolSize;
+    if (vkCreateDescriptorPool(*l_Device, &l_PoolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling descriptor pool");
+
+    VkDescriptorSetAllocateInfo l_SetInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    l_SetInfo.descriptorPool = m_DescriptorPool;
+    l_SetInfo.descriptorSetCount = 1;
+    l_SetInfo.pSetLayouts = &m_SetLayout;
+    if (vkAllocateDescriptorSets(*l_Device, &l_SetInfo, &m_DescriptorSet) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate culling descriptor set");
+
+    const VkPushConstantRange l_PushConstants{ VK_SHADER_STAGE_COMPUTE_BIT, 0, sizeof(PushData) };
+    VkPipelineLayoutCreateInfo l_PipelineLayoutInfo{ VK_STRUCTURE_TYPE_PIPELINE_LAYOUT_CREATE_INFO };
+    l_PipelineLayoutInfo.setLayoutCount = 1;
+    l_PipelineLayoutInfo.pSetLayouts = &m_SetLayout;
+    l_PipelineLayoutInfo.pushConstantRangeCount = 1;
+    l_PipelineLayoutInfo.pPushConstantRanges = &l_PushConstants;
+    if (vkCreatePipelineLayout(*l_Device, &l_PipelineLayoutInfo, nullptr, &m_PipelineLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create culling pipeline layout");
+
+#ifndef _DEBUG
+    VulkanShader l_Shader{0, false};
+    l_Shader.enableCache("shaders/cache/cull_release.bin");
+#else
+    VulkanShader l_Shader{0, true};
+    l_Shader.enableCache("shaders/cache/cull_debug.bin");
+#endif
+    l_Shader.setExpectedStages(VK_SHADER_STAGE_COMPUTE_BIT);
+    l_Shader.addModule("shaders/cull.slang", "main");
+    l_Shader.compile();
+    const ResourceID l_ShaderModule = l_Device.createShaderModule(l_Shader, VK_SHADER_STAGE_COMPUTE_BIT);
+
+    VkComputePipelineCreateInfo l_PipelineInfo{ VK_STRUCTURE_TYPE_COMPUTE_PIPELINE_CREATE_INFO };
+    l_PipelineInfo.stage.sType = VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO;
+    l_PipelineInfo.stage.stage = VK_SHADER_STAGE_COMPUTE_BIT;
+    l_PipelineInfo.stage.module = *l_Device.getShaderModule(l_ShaderModule);
+    l_PipelineInfo.stage.pName = "main";
+    l_PipelineInfo.layout = m_PipelineLayout;
+    m_Pipeline = p_PipelineCache.createComputePipeline(l_PipelineInfo);
+    l_Device.freeShaderModule(l_ShaderModule);
+}
+
+void GpuCuller::freeObjectBuffers()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    for (ResourceID* l_BufferID : { &m_ObjectBufferID, &m_CommandBufferID, &m_CountBufferID })
+    {
+        if (*l_BufferID != UINT32_MAX)
+            l_Device.freeBuffer(*l_BufferID);
+        *l_BufferID = UINT32_MAX;
+    }
+    m_ObjectCount = 0;
+}
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+#include <Volk/volk.h>
+#include <glm/glm.hpp>
+#include <utils/identifiable.hpp>
+
+#include "culling/frustum_culler.hpp"
+#include "pipeline/pipeline_cache.hpp"
+#include "resources/readback_buffer.hpp"
+#include "upload/upload_service.hpp"
+
+// Matches CullObject in shaders/cull.slang
+struct GpuCullObject
+{
+    glm::vec4 center;
+    glm::vec4 extent;
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    // Object index, the draw covers just this one and the vertex shader derives its submesh and instance from it
+    uint32_t firstInstance;
+};
+
+static_assert(sizeof(GpuCullObject) == 48, "GpuCullObject must match the std430 layout of the shader");
+
+// Compute pass that tests every object against the frustum. With drawIndirectCount the visible commands are compacted
+// at the front of the command buffer through the visible counter and drawn with vkCmdDrawIndexedIndirectCount, so
+// culled objects cost the GPU nothing. Otherwise, or when the object count exceeds maxDrawIndirectCount, every object
+// keeps its own slot, culled ones get an instance count of 0 and the whole set is drawn with plain indirect draws
+class GpuCuller
+{
+public:
+    // p_BufferFamilyIndex is the graphics family, the culling dispatch, the draw and the readback all run there.
+    // p_DrawIndirectCount tells whether the device was created with the drawIndirectCount feature
+    void init(ResourceID p_DeviceID, PipelineCache& p_PipelineCache, uint32_t p_BufferFamilyIndex, uint32_t p_FramesInFlight, bool p_MultiDrawIndirect, bool p_DrawIndirectCount);
+    void free();
+
+    // Replaces the object set, the bounds reach the GPU through the upload service. The previous set must no longer be in use
+    UploadTicket setObjects(UploadService& p_UploadService, std::span<const GpuCullObject> p_Objects);
+
+    // Must be recorded outside of a render pass. Only the counter clear is synchronized in here, the render graph orders
+    // culling against the previous frame's draw and readback and against this frame's
+    void recordCulling(VkCommandBuffer p_CmdBuffer, const Frustum& p_Frustum) const;
+    // Copies the visible count into the slot's host visible buffer, the host barrier is included
+    void recordReadback(VkCommandBuffer p_CmdBuffer, uint32_t p_FrameSlot) const;
+    void recordDraw(VkCommandBuffer p_CmdBuffer) const;
+
+    // Written by the culling dispatch, read by the indirect draw and the readback. The draw reads the count buffer too
+    // when the commands are compacted
+    [[nodiscard]] VkBuffer getDrawCommandBuffer() const;
+    [[nodiscard]] VkBuffer getCountBuffer() const;
+
+    // Visible object count the slot wrote the last time it was recorded, only valid once its fence has been waited on
+    [[nodiscard]] uint32_t getVisibleCount(uint32_t p_FrameSlot) const;
+    [[nodiscard]] uint32_t getObjectCount() const { return m_ObjectCount; }
+    [[nodiscard]] bool isCompacted() const { return m_Compact; }
+
+private:
+    static constexpr uint32_t WORKGROUP_SIZE = 64;
+
+    struct PushData
+    {
+        glm::vec4 planes[6];
+        uint32_t objectCount;
+        uint32_t compact;
+    };
+
+    void createPipeline(PipelineCache& p_PipelineCache);
+    void freeObjectBuffers();
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    uint32_t m_BufferFamilyIndex = 0;
+    bool m_MultiDrawIndirect = false;
+    bool m_DrawIndirectCount = false;
+    uint32_t m_MaxDrawIndirectCount = 1;
+
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_DescriptorSet = VK_NULL_HANDLE;
+    VkPipelineLayout m_PipelineLayout = VK_NULL_HANDLE;
+    VkPipeline m_Pipeline = VK_NULL_HANDLE;
+
+    uint32_t m_ObjectCount = 0;
+    // Decided per object set, a compacted draw can't be split once the count lives on the GPU
+    bool m_Compact = false;
+    ResourceID m_ObjectBufferID = UINT32_MAX;
+    ResourceID m_CommandBufferID = UINT32_MAX;
+    ResourceID m_CountBufferID = UINT32_MAX;
+
+    // One copy of the visible count per frame slot, read back for statistics only
+    ReadbackBuffer m_Readback{};
+};
@@ -1,14 +1,21 @@
 #include "engine.hpp"
 
+#include <algorithm>
 #include <array>
+#include <atomic>
+#include <cfloat>
+#include <cmath>
+#include <cstddef>
+#include <exception>
+#include <fstream>
 
 #include <imgui.h>
 #include <iostream>
 #include <thread>
 #include <backends/imgui_impl_vulkan.h>
+#include <glm/gtc/matrix_transform.hpp>
 
 #include "vertex.hpp"
-#include "vulkan_binding.hpp"
 #include "vulkan_buffer.hpp"
 
 #include "vulkan_device.hpp"
@@ -20,37 +27,80 @@
 #include "camera/flight_camera.hpp"
 #include "camera/ortho_controller_camera.hpp"
 #include "utils/logger.hpp"
+#include "resources/readback_buffer.hpp"
 
 constexpr std::array<Vertex, 3> VERTICES = {
-    Vertex{ {  0.0f, -0.5f, 0.0f }, { 255,   0,   0 } },
-    Vertex{ {  0.5f,  0.5f, 0.0f }, {   0, 255,   0 } },
-    Vertex{ { -0.5f,  0.5f, 0.0f }, {   0,   0, 255 } }
+    Vertex{ {  0.0f, -0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, { 255,   0,   0 } },
+    Vertex{ {  0.5f,  0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, {   0, 255,   0 } },
+    Vertex{ { -0.5f,  0.5f, 0.0f }, { 0.0f, 0.0f, 1.0f }, {   0,   0, 255 } }
 };
 
 constexpr std::array<uint16_t, 3> INDICES = { 0, 1, 2 };
 
+static constexpr std::array<VkPresentModeKHR, 4> PRESENT_MODES = { VK_PRESENT_MODE_FIFO_KHR, VK_PRESENT_MODE_FIFO_RELAXED_KHR, VK_PRESENT_MODE_MAILBOX_KHR, VK_PRESENT_MODE_IMMEDIATE_KHR };
+
+static const char* getPresentModeName(const VkPresentModeKHR p_Mode)
+{
+    switch (p_Mode)
+    {
+    case VK_PRESENT_MODE_FIFO_KHR: return "FIFO";
+    case VK_PRESENT_MODE_FIFO_RELAXED_KHR: return "FIFO relaxed";
+    case VK_PRESENT_MODE_MAILBOX_KHR: return "Mailbox";
+    case VK_PRESENT_MODE_IMMEDIATE_KHR: return "Immediate";
+    default: return "Unknown";
+    }
+}
+
 static VulkanGPU chooseCorrectGPU()
 {
     std::array<VulkanGPU, 10> l_GPUs;
     VulkanContext::getGPUs(l_GPUs.data());
-    for (uint32_t i = 0; i < VulkanContext::getGPUCount(); i++)
+    const uint32_t l_GPUCount = std::min(VulkanContext::getGPUCount(), static_cast<uint32_t>(l_GPUs.size()));
+    if (l_GPUCount == 0)
+        throw std::runtime_error("No Vulkan capable GPU found");
+
+    // Prefer a discrete GPU, but fall back to integrated or software implementations (lavapipe) so benchmarks can run anywhere
+    constexpr std::array<VkPhysicalDeviceType, 3> PREFERENCE = { VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU, VK_PHYSICAL_DEVICE_TYPE_INTEGRATED_GPU, VK_PHYSICAL_DEVICE_TYPE_CPU };
+    for (const VkPhysicalDeviceType l_Type : PREFERENCE)
     {
-        if (l_GPUs[i].getProperties().deviceType == VK_PHYSICAL_DEVICE_TYPE_DISCRETE_GPU)
+        for (uint32_t i = 0; i < l_GPUCount; i++)
         {
-            return l_GPUs[i];
+            if (l_GPUs[i].getProperties().deviceType == l_Type)
+            {
+                return l_GPUs[i];
+            }
         }
     }
 
-    throw std::runtime_error("No discrete GPU found");
+    return l_GPUs[0];
 }
 
-Engine::Engine() : m_Window("Vulkan", 1920, 1080)
+Engine::Engine(const EngineConfig& p_Config)
+    : m_Config(p_Config), m_Window(p_Config.headless ? SDLWindow{} : SDLWindow{"Vulkan", 1920, 1080})
 {
+    if (m_Config.framesInFlight == 0)
+        throw std::runtime_error("At least one frame in flight is required");
+    if (m_Config.headless && m_Config.benchmarkFrames == 0 && m_Config.benchmarkSeconds <= 0.0f)
+        throw std::runtime_error("Headless mode requires a frame count or duration limit");
+    if (m_Config.instanceCount == 0)
+        throw std::runtime_error("At least one instance is required");
+    // More queued frames than slots can't happen anyway, 0 means no limit
+    if (m_Config.maxQueuedFrames == 0 || m_Config.maxQueuedFrames > m_Config.framesInFlight)
+        m_Config.maxQueuedFrames = m_Config.framesInFlight;
+
+    m_JobSystem.init(m_Config.jobThreads);
+    m_Culler.setJobSystem(&m_JobSystem);
+    m_Culler.setThreadCount(m_JobSystem.getThreadCount());
+
     // Vulkan Instance
     Logger::setRootContext("Engine init");
 
-    std::vector<const char*> l_RequiredExtensions{ m_Window.getRequiredVulkanExtensionCount() };
-    m_Window.getRequiredVulkanExtensions(l_RequiredExtensions.data());
+    std::vector<const char*> l_RequiredExtensions{};
+    if (!m_Config.headless)
+    {
+        l_RequiredExtensions.resize(m_Window.getRequiredVulkanExtensionCount());
+        m_Window.getRequiredVulkanExtensions(l_RequiredExtensions.data());
+    }
 #ifndef _DEBUG
     Logger::setLevels(Logger::WARN | Logger::ERR);
     VulkanContext::init(VK_API_VERSION_1_3, false, false, l_RequiredExtensions);
@@ -63,7 +113,8 @@ Engine::Engine() : m_Window("Vulkan", 1920, 1080)
     VulkanContext::initializeArenaMemory(1LL * 1024 * 1024);
 
     // Vulkan Surface
-    m_Window.createSurface(VulkanContext::getHandle());
+    if (!m_Config.headless)
+        m_Window.createSurface(VulkanContext::getHandle());
 
     // Choose Physical Device
     const VulkanGPU l_GPU = chooseCorrectGPU();
@@ -73,104 +124,132 @@ Engine::Engine() : m_Window("Vulkan", 1920, 1080)
     QueueFamilySelector l_QueueFamilySelector(l_QueueStructure);
 
     const QueueFamily l_GraphicsQueueFamily = l_QueueStructure.findQueueFamily(VK_QUEUE_GRAPHICS_BIT);
-    const QueueFamily l_PresentQueueFamily = l_QueueStructure.findPresentQueueFamily(m_Window.getSurface());
     const QueueFamily l_TransferQueueFamily = l_QueueStructure.findQueueFamily(VK_QUEUE_TRANSFER_BIT);
 
     // Select Queue Families and assign queues
     QueueFamilySelector l_Selector{ l_QueueStructure };
     l_Selector.selectQueueFamily(l_GraphicsQueueFamily, QueueFamilyTypeBits::GRAPHICS);
-    l_Selector.selectQueueFamily(l_PresentQueueFamily, QueueFamilyTypeBits::PRESENT);
     m_GraphicsQueuePos = l_Selector.getOrAddQueue(l_GraphicsQueueFamily, 1.0);
-    m_PresentQueuePos = l_Selector.getOrAddQueue(l_PresentQueueFamily, 1.0);
+    if (!m_Config.headless)
+    {
+        const QueueFamily l_PresentQueueFamily = l_QueueStructure.findPresentQueueFamily(m_Window.getSurface());
+        l_Selector.selectQueueFamily(l_PresentQueueFamily, QueueFamilyTypeBits::PRESENT);
+        m_PresentQueuePos = l_Selector.getOrAddQueue(l_PresentQueueFamily, 1.0);
+    }
     m_TransferQueuePos = l_Selector.addQueue(l_TransferQueueFamily, 1.0);
 
     // Logical Device
     VulkanDeviceExtensionManager l_Extensions{};
-    l_Extensions.addExtension(new VulkanSwapchainExtension(m_DeviceID));
-    m_DeviceID = VulkanContext::createDevice(l_GPU, l_Selector, &l_Extensions, {});
+    if (!m_Config.headless)
+        l_Extensions.addExtension(new VulkanSwapchainExtension(m_DeviceID));
+    // Multi draw indirect lets GPU culling submit every submesh with a single indirect draw, draw indirect count lets
+    // it draw only the visible ones
+    VkPhysicalDeviceVulkan12Features l_Supported12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    VkPhysicalDeviceFeatures2 l_SupportedFeatures{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+    l_SupportedFeatures.pNext = &l_Supported12;
+    vkGetPhysicalDeviceFeatures2(*l_GPU, &l_SupportedFeatures);
+    VkPhysicalDeviceFeatures l_Features{};
+    l_Features.multiDrawIndirect = l_SupportedFeatures.features.multiDrawIndirect;
+    VkPhysicalDeviceVulkan12Features l_Vulkan12Features{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    l_Vulkan12Features.drawIndirectCount = l_Supported12.drawIndirectCount;
+    // The bindless texture array is runtime sized, partially bound and updated after bind
+    BindlessTable::requireFeatures(*l_GPU, l_Features, l_Vulkan12Features);
+    m_DeviceID = VulkanContext::createDevice(l_GPU, l_Selector, &l_Extensions, l_Features, &l_Vulkan12Features);
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    m_PipelineCache.init(m_DeviceID, "shaders/cache/pipelines.bin");
+    m_DeferredRelease.init(m_DeviceID);
 
     // Swapchain
-    VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(m_DeviceID);
-    m_SwapchainID = l_SwapchainExt->createSwapchain(m_Window.getSurface(), m_Window.getSize().toExtent2D(), { VK_FORMAT_R8G8B8A8_SRGB, VK_COLORSPACE_SRGB_NONLINEAR_KHR }, VK_PRESENT_MODE_FIFO_KHR);
-    VulkanSwapchain& l_Swapchain = l_SwapchainExt->getSwapchain(m_SwapchainID);
+    if (!m_Config.headless)
+    {
+        VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(m_DeviceID);
+        m_PresentMode = choosePresentMode(m_Config.presentMode);
+        m_RequestedPresentMode = m_PresentMode;
+        m_SwapchainID = l_SwapchainExt->createSwapchain(m_Window.getSurface(), m_Window.getSize().toExtent2D(), { VK_FORMAT_R8G8B8A8_SRGB, VK_COLORSPACE_SRGB_NONLINEAR_KHR }, m_PresentMode);
+    }
+    const VkExtent2D l_Extent = getRenderExtent();
 
     // Command Buffers
     l_Device.configureOneTimeQueue(m_TransferQueuePos);
     l_Device.initializeCommandPool(l_GraphicsQueueFamily, 0, true);
-    m_GraphicsCmdBufferID = l_Device.createCommandBuffer(l_GraphicsQueueFamily, 0, false);
-
-    // Depth Buffer
-    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
-        .preferredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
-    };
-    m_DepthBuffer = l_Device.createAndAllocateImage(l_MemPrefs, {VK_IMAGE_TYPE_2D, VK_FORMAT_D32_SFLOAT, { l_Swapchain.getExtent().width, l_Swapchain.getExtent().height, 1 }, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT, 0});
-    VulkanImage& l_DepthImage = l_Device.getImage(m_DepthBuffer);
-    m_DepthBufferView = l_DepthImage.createImageView(VK_FORMAT_D32_SFLOAT, VK_IMAGE_ASPECT_DEPTH_BIT);
-    
-    l_Device.configureStagingBuffer(5LL * 1024 * 1024, m_TransferQueuePos);
-
-    // Dump Data
+    m_Frames.resize(m_Config.framesInFlight);
+    for (FrameData& l_Frame : m_Frames)
     {
-        ResourceID l_FenceID = l_Device.createFence(false);
-        VulkanFence& l_Fence = l_Device.getFence(l_FenceID);
-
-        const ResourceID l_OneTimeTransferCmdBufferID = l_Device.createCommandBuffer(l_TransferQueueFamily, 0, false);
-        VulkanCommandBuffer& l_CmdBuffer = l_Device.getCommandBuffer(l_OneTimeTransferCmdBufferID, 0);
-        
-        // Vertex Buffer
-        m_VertexBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {sizeof(VERTICES), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_TransferQueuePos.familyIndex});
-        
-        l_CmdBuffer.beginRecording();
-        l_CmdBuffer.ecmdDumpDataIntoBuffer(m_VertexBufferID, reinterpret_cast<const uint8_t*>(VERTICES.data()), sizeof(VERTICES));
-        l_CmdBuffer.endRecording();
-        l_CmdBuffer.submit(l_Device.getQueue(m_TransferQueuePos), {}, {}, l_FenceID);
-        
-        // Index Buffer
-        m_IndexBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {sizeof(INDICES), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_TransferQueuePos.familyIndex});
-        
-        l_Fence.wait();
-        l_Fence.reset();
-
-        l_CmdBuffer.reset();
-        l_CmdBuffer.beginRecording();
-        l_CmdBuffer.ecmdDumpDataIntoBuffer(m_IndexBufferID, reinterpret_cast<const uint8_t*>(INDICES.data()), sizeof(INDICES));
-        l_CmdBuffer.endRecording();
-        l_CmdBuffer.submit(l_Device.getQueue(m_TransferQueuePos), {}, {}, l_FenceID);
-
-        l_Fence.wait();
+        l_Frame.commandBufferID = l_Device.createCommandBuffer(l_GraphicsQueueFamily, 0, false);
+    }
 
-        //Free resources
-        l_Device.freeCommandBuffer(l_OneTimeTransferCmdBufferID, 0);
-        l_Device.freeFence(l_Fence);
+    // Every recorded range gets its own pool, pools can't be used from two threads at once
+    if (m_Config.recordThreads > 0)
+    {
+        for (uint32_t i = 1; i <= m_Config.recordThreads; i++)
+            l_Device.initializeCommandPool(l_GraphicsQueueFamily, i, true);
+        for (FrameData& l_Frame : m_Frames)
+        {
+            for (uint32_t i = 1; i <= m_Config.recordThreads; i++)
+                l_Frame.secondaryBufferIDs.push_back(l_Device.createCommandBuffer(l_GraphicsQueueFamily, i, true));
+            l_Frame.imguiBufferID = l_Device.createCommandBuffer(l_GraphicsQueueFamily, 0, true);
+        }
     }
 
+    // Offscreen color target
+    if (m_Config.headless)
+        createOffscreenTarget();
+
+    // Upload geometry, the transfer runs while the rest of the engine initializes
+    m_UploadService.init(m_DeviceID, l_TransferQueueFamily, m_TransferQueuePos, m_GraphicsQueuePos, m_Config.uploadChunkSize, m_Config.uploadChunkCount);
+    // Frames don't draw until the fallbacks are submitted, every unloaded texture samples the white one
+    m_BindlessUploadTicket = m_BindlessTable.init(m_DeviceID, m_UploadService, m_TransferQueuePos.familyIndex, m_Config.framesInFlight);
+    // Decoding starts right away, frames sample white until the first levels arrive
+    m_TextureStreamer.init(m_DeviceID, m_JobSystem, m_UploadService, m_BindlessTable, m_DeferredRelease, m_Config.textureBudget);
+    for (const std::string& l_Path : m_Config.texturePaths)
+        m_TextureHandles.push_back(m_TextureStreamer.load(l_Path));
+    if (m_Config.gpuCulling)
+        m_GpuCuller.init(m_DeviceID, m_PipelineCache, m_GraphicsQueuePos.familyIndex, m_Config.framesInFlight, l_Features.multiDrawIndirect == VK_TRUE,
+            l_Vulkan12Features.drawIndirectCount == VK_TRUE);
+    uploadGeometry();
+
+    // Transient per frame data, the instances are rewritten into it every frame
+    const VkDeviceSize l_InstanceBytes = static_cast<VkDeviceSize>(m_Instances.size()) * sizeof(InstanceData);
+    m_FrameAllocator.init(m_DeviceID, m_GraphicsQueuePos.familyIndex, std::max(m_Config.frameArenaSize, l_InstanceBytes + 64LL * 1024), m_Config.framesInFlight);
+
     // Renderpass and pipelines
     createRenderPasses();
+    m_RenderGraph.init(m_DeviceID, m_DeferredRelease, m_Profiler);
+    m_PipelineCompiler.init(m_JobSystem);
     createPipelines();
 
-    // Framebuffers
-    m_FramebufferIDs.resize(l_Swapchain.getImageCount());
-    for (uint32_t i = 0; i < l_Swapchain.getImageCount(); i++)
+    // Sync objects
+    if (!m_Config.headless)
     {
-        VkImageView l_Color = *l_Swapchain.getImage(i).getImageView(l_Swapchain.getImageView(i));
-        const std::array<VkImageView, 2> l_Attachments = { l_Color, *l_Device.getImage(m_DepthBuffer).getImageView(m_DepthBufferView) };
-        m_FramebufferIDs[i] = VulkanContext::getDevice(m_DeviceID).createFramebuffer({ l_Swapchain.getExtent().width, l_Swapchain.getExtent().height, 1 }, m_RenderPassID, l_Attachments);
+        const VulkanSwapchain& l_Swapchain = VulkanSwapchainExtension::get(m_DeviceID)->getSwapchain(m_SwapchainID);
+        for (uint32_t i = 0; i < l_Swapchain.getImageCount(); i++)
+        {
+            m_RenderFinishedSemaphoreIDs.push_back(l_Device.createSemaphore());
+        }
     }
-
-    // Sync objects
-    for (uint32_t i = 0; i < l_Swapchain.getImageCount(); i++)
+    for (FrameData& l_Frame : m_Frames)
     {
-        m_RenderFinishedSemaphoreIDs.push_back(l_Device.createSemaphore());
+        l_Frame.inFlightFenceID = l_Device.createFence(true);
+        if (!m_Config.headless)
+            l_Frame.imageAvailableSemaphoreID = l_Device.createSemaphore();
     }
-    m_InFlightFenceID = l_Device.createFence(true);
 
-    m_Window.getPixelResizedSignal().connect(this, &Engine::recreateSwapchain);
+    m_Profiler.init(m_DeviceID, m_GraphicsQueuePos.familyIndex, m_Config.framesInFlight);
+
+    m_Camera.setScreenSize(l_Extent.width, l_Extent.height);
+    publishCamera();
+
+    // Benchmarks should measure full frames from the first one, the window shows frames without geometry instead
+    if (m_Config.headless)
+        m_PipelineCompiler.wait(m_GraphicsPipelines[static_cast<uint32_t>(m_VertexFormat)]);
 
-    m_Camera.setScreenSize(l_Swapchain.getExtent().width, l_Swapchain.getExtent().height);
+    if (!m_Config.headless)
+    {
+        m_Window.getPixelResizedSignal().connect<&Engine::requestSwapchainResize>(this);
 
-    initImgui();
-    configureCamera();
+        initImgui();
+        configureCamera();
+    }
 }
 
 Engine::~Engine()
@@ -179,45 +258,192 @@ Engine::~Engine()
 
     Logger::setRootContext("Resource cleanup");
 
-    ImGui_ImplVulkan_Shutdown();
-    m_Window.shutdownImgui();
-    ImGui::DestroyContext();
+    m_DeferredRelease.free();
+    m_RenderGraph.free();
+    m_FrameAllocator.free();
+    for (const PipelineCompiler::Handle l_Handle : m_GraphicsPipelines)
+        vkDestroyPipeline(*VulkanContext::getDevice(m_DeviceID), m_PipelineCompiler.resolve(l_Handle, VK_NULL_HANDLE), nullptr);
+    m_PipelineCompiler.free();
+    m_Profiler.free();
+    m_GpuCuller.free();
+    m_TextureStreamer.free();
+    m_BindlessTable.free();
+    m_UploadService.free();
+    m_PipelineCache.save();
+    m_PipelineCache.free();
+
+    if (!m_Config.headless)
+    {
+        ImGui_ImplVulkan_Shutdown();
+        m_Window.shutdownImgui();
+        ImGui::DestroyContext();
+    }
 
     VulkanContext::freeDevice(m_DeviceID);
-    m_Window.free();
+    if (!m_Config.headless)
+        m_Window.free();
     VulkanContext::free();
+    m_JobSystem.free();
 }
 
 void Engine::run()
+{
+    m_FrameBenchmark.reset();
+    m_BenchmarkStart = std::chrono::steady_clock::now();
+    if (!m_Config.tracePath.empty())
+        m_Profiler.startCapture();
+
+    if (m_Config.headless)
+        runHeadless();
+    else
+        runWindowed();
+
+    if (!m_Config.tracePath.empty())
+        m_Profiler.stopCapture(m_Config.tracePath);
+
+    if (m_Config.benchmarkFrames > 0 || m_Config.benchmarkSeconds > 0.0f)
+    {
+        std::cout << "Mesh: " << (m_Config.meshPath.empty() ? "built-in triangle" : m_Config.meshPath) << " | " << m_MeshVertexCount << " vertices, "
+            << m_MeshIndexCount << " indices, " << m_Submeshes.size() << " submeshes\n";
+        m_FrameBenchmark.report(std::cout, m_Config.framesInFlight);
+
+        const UploadStats& l_UploadStats = m_UploadService.getStats();
+        std::cout << "Upload chunk: " << m_Config.uploadChunkSize / 1024 << " KB x " << m_Config.uploadChunkCount
+            << " | uploaded: " << static_cast<double>(l_UploadStats.bytes) / (1024.0 * 1024.0) << " MB in " << l_UploadStats.batches << " batches"
+            << " | throughput: " << l_UploadStats.getMBps() << " MB/s\n";
+
+        const uint32_t l_RecordThreads = std::max(m_Config.recordThreads, 1U);
+        std::cout << "Draw recording: avg " << m_DrawRecordStats.getAverage() << " ms | p95 " << m_DrawRecordStats.getPercentile(0.95)
+            << " ms | draws: " << getDrawCount() << " | threads: " << l_RecordThreads << (m_Config.recordThreads == 0 ? " (inline)" : " (secondary)") << "\n";
+
+        const PipelineCacheStats& l_CacheStats = m_PipelineCache.getStats();
+        std::cout << "Pipeline cache: " << l_CacheStats.loadedBytes / 1024 << " KB loaded" << (l_CacheStats.rejected ? " (stale file discarded)" : "")
+            << " | hits: " << l_CacheStats.hits << " in " << l_CacheStats.hitMs << " ms | misses: " << l_CacheStats.misses << " in " << l_CacheStats.missMs << " ms\n";
+
+        if (!m_TextureHandles.empty())
+        {
+            const TextureStreamStats& l_TextureStats = m_TextureStreamer.getStats();
+            std::cout << "Textures: " << l_TextureStats.textureCount << " | uploaded: " << static_cast<double>(l_TextureStats.uploadedBytes) / (1024.0 * 1024.0) << " MB"
+                << " | decode failures: " << l_TextureStats.failedTextures;
+            if (l_TextureStats.failedTextures > 0)
+                std::cout << " (last: " << l_TextureStats.lastError << ")";
+            std::cout << "\n";
+        }
+
+        if (!m_Config.headless)
+        {
+            std::cout << "Present: " << getPresentModeName(m_PresentMode);
+            if (m_UnsupportedPresentMode != VK_PRESENT_MODE_MAX_ENUM_KHR)
+                std::cout << " (" << getPresentModeName(m_UnsupportedPresentMode) << " isn't supported)";
+            std::cout << " | max queued frames: " << m_Config.maxQueuedFrames
+                << " | latency sleep: " << (m_Config.latencySleep ? "on" : "off")
+                << " | input to present: avg " << m_InputLatencyStats.getAverage() << " ms | p95 " << m_InputLatencyStats.getPercentile(0.95) << " ms\n";
+        }
+    }
+}
+
+void Engine::runWindowed()
+{
+    // SDL events have to be pumped on the thread that created the window. This thread keeps sampling input and moving
+    // the camera at its own rate while frames are recorded and presented on the render thread. The render thread runs
+    // ImGui's SDL calls on this one, so it keeps pumping until the render thread is done
+    constexpr uint32_t INPUT_POLL_TIMEOUT_MS = 1;
+
+    std::atomic<bool> l_RenderDone = false;
+    std::exception_ptr l_RenderError = nullptr;
+    std::jthread l_RenderThread{ [this, &l_RenderDone, &l_RenderError](const std::stop_token& p_Stop)
+    {
+        try
+        {
+            renderWindowed(p_Stop);
+        }
+        catch (...)
+        {
+            l_RenderError = std::current_exception();
+        }
+        l_RenderDone.store(true, std::memory_order_release);
+    } };
+
+    while (!m_Window.shouldClose() && !l_RenderDone.load(std::memory_order_acquire))
+    {
+        m_Window.pollEvents(INPUT_POLL_TIMEOUT_MS);
+        publishCamera();
+    }
+
+    l_RenderThread.request_stop();
+    while (!l_RenderDone.load(std::memory_order_acquire))
+        m_Window.pollEvents(INPUT_POLL_TIMEOUT_MS);
+    l_RenderThread.join();
+    if (l_RenderError)
+        std::rethrow_exception(l_RenderError);
+}
+
+void Engine::renderWindowed(const std::stop_token& p_Stop)
 {
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
     VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(l_Device);
 
-    VulkanFence& l_InFlightFence = l_Device.getFence(m_InFlightFenceID);
-
     const VulkanQueue l_GraphicsQueue = l_Device.getQueue(m_GraphicsQueuePos);
-    VulkanCommandBuffer& l_GraphicsBuffer = l_Device.getCommandBuffer(m_GraphicsCmdBufferID, 0);
 
-    while (!m_Window.shouldClose())
+    while (!p_Stop.stop_requested() && !isBenchmarkFinished())
     {
-        m_Window.pollEvents();
+        {
+            ProfileScope l_Scope{ m_Profiler, "Window events" };
+            m_Window.dispatchRenderEvents();
+        }
         if (m_Window.isMinimized())
         {
             std::this_thread::sleep_for(std::chrono::milliseconds(100));
             continue;
         }
+        // Resizes and present mode changes since the last frame end up in a single recreation
+        if (m_RequestedPresentMode != m_PresentMode)
+        {
+            m_PresentMode = choosePresentMode(m_RequestedPresentMode);
+            m_RequestedPresentMode = m_PresentMode;
+            if (!m_ResizePending)
+                requestSwapchainResize(l_SwapchainExt->getSwapchain(m_SwapchainID).getExtent());
+        }
+        if (m_ResizePending)
+        {
+            ProfileScope l_Scope{ m_Profiler, "Recreate swapchain" };
+            recreateSwapchain(m_PendingExtent);
+            m_ResizePending = false;
+        }
 
-        l_InFlightFence.wait();
-        l_InFlightFence.reset();
+        FrameData& l_Frame = m_Frames[m_CurrentFrame];
+        VulkanFence& l_InFlightFence = l_Device.getFence(l_Frame.inFlightFenceID);
 
-        VulkanSwapchain& l_Swapchain = l_SwapchainExt->getSwapchain(m_SwapchainID);
-        const uint32_t l_ImageIndex = l_Swapchain.acquireNextImage();
-        if (l_ImageIndex == UINT32_MAX)
+        m_FrameBenchmark.beginFrame();
+        ProfileScope l_FrameScope{ m_Profiler, "Frame" };
+
+        if (m_Config.latencySleep)
         {
-            continue;
+            ProfileScope l_Scope{ m_Profiler, "Latency sleep" };
+            m_LatencyLimiter.sleep();
         }
 
-        Engine::drawImgui();
+        // Only wait for the GPU to be done with this slot, the other slots can still be in flight. With fewer queued frames
+        // allowed than slots, the slot submitted maxQueuedFrames ago has to be done as well
+        const auto l_BlockStart = std::chrono::steady_clock::now();
+        {
+            ProfileScope l_Scope{ m_Profiler, "Fence wait" };
+            m_FrameBenchmark.beginFenceWait();
+            l_InFlightFence.wait();
+            const uint32_t l_LimitSlot = (m_CurrentFrame + m_Config.framesInFlight - m_Config.maxQueuedFrames) % m_Config.framesInFlight;
+            if (l_LimitSlot != m_CurrentFrame)
+                l_Device.getFence(m_Frames[l_LimitSlot].inFlightFenceID).wait();
+            m_FrameBenchmark.endFenceWait();
+        }
+        const std::chrono::duration<double, std::milli> l_FenceBlockedTime = std::chrono::steady_clock::now() - l_BlockStart;
+        m_Profiler.beginFrame(m_CurrentFrame);
+        beginFrameReleases();
+
+        // Built before the acquire, a frame skipped after it would leave the slot's acquire semaphore signaled with no wait
+        {
+            ProfileScope l_Scope{ m_Profiler, "ImGui build" };
+            Engine::drawImgui();
+        }
         ImDrawData* l_ImguiDrawData = ImGui::GetDrawData();
 
         if (l_ImguiDrawData->DisplaySize.x <= 0.0f || l_ImguiDrawData->DisplaySize.y <= 0.0f)
@@ -225,63 +451,617 @@ void Engine::run()
             continue;
         }
 
-        // Recording
+        // The slot's fence was waited on, so its acquire semaphore has no pending wait left and can be signaled again
+        VulkanSwapchain& l_Swapchain = l_SwapchainExt->getSwapchain(m_SwapchainID);
+        const auto l_AcquireStart = std::chrono::steady_clock::now();
+        uint32_t l_ImageIndex;
+        {
+            ProfileScope l_Scope{ m_Profiler, "Acquire" };
+            l_ImageIndex = l_Swapchain.acquireNextImage(l_Frame.imageAvailableSemaphoreID);
+        }
+        // The ImGui build between the two waits is work, not blocking
+        const std::chrono::duration<double, std::milli> l_AcquireBlockedTime = std::chrono::steady_clock::now() - l_AcquireStart;
+        m_LatencyLimiter.endFrame((l_FenceBlockedTime + l_AcquireBlockedTime).count(), m_Config.latencySleep);
+        if (l_ImageIndex == UINT32_MAX)
         {
-            const VkExtent2D& l_Extent = l_SwapchainExt->getSwapchain(m_SwapchainID).getExtent();
-          
-            std::array<VkClearValue, 2> l_ClearValues;
-            l_ClearValues[0].color = { {0.0f, 0.0f, 0.0f, 1.0f} };
-            l_ClearValues[1].depthStencil = { 1.0f, 0 };
-
-            VkViewport l_Viewport;
-            l_Viewport.x = 0.0f;
-            l_Viewport.y = 0.0f;
-            l_Viewport.width = static_cast<float>(l_Extent.width);
-            l_Viewport.height = static_cast<float>(l_Extent.height);
-            l_Viewport.minDepth = 0.0f;
-            l_Viewport.maxDepth = 1.0f;
-
-            VkRect2D l_Scissor;
-            l_Scissor.offset = { 0, 0 };
-            l_Scissor.extent = l_Extent;
-
-            PushData l_PushData{};
-            l_PushData.modelMatrix = glm::mat4(1.0f);
-            l_PushData.viewProjMatrix = m_Camera.getVPMatrix();
-
-            l_GraphicsBuffer.reset();
-            l_GraphicsBuffer.beginRecording();
-
-            l_GraphicsBuffer.cmdBeginRenderPass(m_RenderPassID, m_FramebufferIDs[l_ImageIndex], l_Extent, l_ClearValues);
-            l_GraphicsBuffer.cmdBindVertexBuffer(m_VertexBufferID, 0);
-            l_GraphicsBuffer.cmdBindIndexBuffer(m_IndexBufferID, 0, VK_INDEX_TYPE_UINT16);
-            l_GraphicsBuffer.cmdBindPipeline(VK_PIPELINE_BIND_POINT_GRAPHICS, m_GraphicsPipelineID);
-            l_GraphicsBuffer.cmdSetViewport(l_Viewport);
-            l_GraphicsBuffer.cmdSetScissor(l_Scissor);
-            l_GraphicsBuffer.cmdPushConstant(m_GraphicsPipelineLayoutID, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushData), &l_PushData);
-            l_GraphicsBuffer.cmdDrawIndexed(3, 0, 0);
-
-            ImGui_ImplVulkan_RenderDrawData(l_ImguiDrawData, *l_GraphicsBuffer);
-
-            l_GraphicsBuffer.cmdEndRenderPass();
-            l_GraphicsBuffer.endRecording();
+            continue;
         }
 
+        // The fence is only reset once we know this slot will be submitted again, otherwise the next wait would never return
+        l_InFlightFence.reset();
+
+        m_UploadService.update();
+        m_PipelineCompiler.update();
+        l_Frame.waitSemaphores.clear();
+        // Only the attachment writes need the image, everything before them overlaps the acquire
+        l_Frame.waitSemaphores.push_back({l_Frame.imageAvailableSemaphoreID, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT});
+        recordFrame(l_Frame, l_ImageIndex, l_ImguiDrawData);
+
         // Submit
         {
-            const std::array<VulkanCommandBuffer::WaitSemaphoreData, 1> l_WaitSemaphores = {{{l_Swapchain.getImgSemaphore(), VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT}}};
+            ProfileScope l_Scope{ m_Profiler, "Submit" };
             const std::array<ResourceID, 1> l_SignalSemaphores = {m_RenderFinishedSemaphoreIDs[l_ImageIndex]};
-            l_GraphicsBuffer.submit(l_GraphicsQueue, l_WaitSemaphores, l_SignalSemaphores, m_InFlightFenceID);
+            l_Device.getCommandBuffer(l_Frame.commandBufferID, 0).submit(l_GraphicsQueue, l_Frame.waitSemaphores, l_SignalSemaphores, l_Frame.inFlightFenceID);
+            m_Profiler.markSubmitted();
         }
+        endFrameReleases();
 
         // Present
         {
+            ProfileScope l_Scope{ m_Profiler, "Present" };
             std::array<ResourceID, 1> l_Semaphores = { {m_RenderFinishedSemaphoreIDs[l_ImageIndex]} };
             l_Swapchain.present(m_PresentQueuePos, l_Semaphores);
         }
+        const std::chrono::duration<double, std::milli> l_InputLatency = std::chrono::steady_clock::now() - l_Frame.inputSampleTime;
+        m_InputLatencyStats.addSample(l_InputLatency.count());
+
+        VulkanContext::resetTransMemory();
+
+        m_CurrentFrame = (m_CurrentFrame + 1) % m_Config.framesInFlight;
+        m_FrameBenchmark.endFrame();
+
+        m_JobSystem.collectUtilization(m_ThreadUtilization);
+        m_Profiler.setThreadUtilization(m_ThreadUtilization);
+    }
+}
+
+void Engine::runHeadless()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+
+    const VulkanQueue l_GraphicsQueue = l_Device.getQueue(m_GraphicsQueuePos);
+
+    while (!isBenchmarkFinished())
+    {
+        FrameData& l_Frame = m_Frames[m_CurrentFrame];
+        VulkanFence& l_InFlightFence = l_Device.getFence(l_Frame.inFlightFenceID);
+
+        m_FrameBenchmark.beginFrame();
+        ProfileScope l_FrameScope{ m_Profiler, "Frame" };
+
+        {
+            ProfileScope l_Scope{ m_Profiler, "Fence wait" };
+            m_FrameBenchmark.beginFenceWait();
+            l_InFlightFence.wait();
+            m_FrameBenchmark.endFenceWait();
+        }
+        l_InFlightFence.reset();
+        m_Profiler.beginFrame(m_CurrentFrame);
+        beginFrameReleases();
+
+        m_UploadService.update();
+        m_PipelineCompiler.update();
+        l_Frame.waitSemaphores.clear();
+        recordFrame(l_Frame, 0, nullptr);
+        {
+            ProfileScope l_Scope{ m_Profiler, "Submit" };
+            l_Device.getCommandBuffer(l_Frame.commandBufferID, 0).submit(l_GraphicsQueue, l_Frame.waitSemaphores, {}, l_Frame.inFlightFenceID);
+            m_Profiler.markSubmitted();
+        }
+        endFrameReleases();
 
         VulkanContext::resetTransMemory();
+
+        m_CurrentFrame = (m_CurrentFrame + 1) % m_Config.framesInFlight;
+        m_FrameBenchmark.endFrame();
+
+        m_JobSystem.collectUtilization(m_ThreadUtilization);
+        m_Profiler.setThreadUtilization(m_ThreadUtilization);
+    }
+
+    for (const FrameData& l_Frame : m_Frames)
+    {
+        l_Device.getFence(l_Frame.inFlightFenceID).wait();
+    }
+
+    if (!m_Config.readbackPath.empty())
+        readbackOffscreenImage(m_Config.readbackPath);
+}
+
+bool Engine::isBenchmarkFinished() const
+{
+    if (m_Config.benchmarkFrames > 0 && m_FrameBenchmark.getFrameCount() >= m_Config.benchmarkFrames)
+        return true;
+    if (m_Config.benchmarkSeconds > 0.0f)
+    {
+        const std::chrono::duration<float> l_Elapsed = std::chrono::steady_clock::now() - m_BenchmarkStart;
+        if (l_Elapsed.count() >= m_Config.benchmarkSeconds)
+            return true;
+    }
+    return false;
+}
+
+VkExtent2D Engine::getRenderExtent() const
+{
+    if (m_Config.headless)
+        return m_Config.headlessExtent;
+    return VulkanSwapchainExtension::get(m_DeviceID)->getSwapchain(m_SwapchainID).getExtent();
+}
+
+void Engine::recordFrame(FrameData& p_Frame, const uint32_t p_ImageIndex, ImDrawData* p_ImguiDrawData)
+{
+    ProfileScope l_RecordScope{ m_Profiler, "Record" };
+    VulkanCommandBuffer& l_GraphicsBuffer = VulkanContext::getDevice(m_DeviceID).getCommandBuffer(p_Frame.commandBufferID, 0);
+    const VkExtent2D l_Extent = getRenderExtent();
+
+    p_Frame.uniforms.modelMatrix = m_MeshTransform;
+    // Sampled as late as possible so the frame shows the newest input
+    m_CameraSnapshots.update();
+    p_Frame.uniforms.viewProjMatrix = m_CameraSnapshots.getReadBuffer().viewProj;
+    p_Frame.uniforms.instanceCount = static_cast<uint32_t>(m_Instances.size());
+    p_Frame.inputSampleTime = m_CameraSnapshots.getReadBuffer().sampleTime;
+
+    // The slot's fence has been waited on, whatever it allocated last time is free again
+    m_FrameAllocator.beginFrame(m_CurrentFrame);
+    p_Frame.uniformBlock = m_FrameAllocator.pushUniform(p_Frame.uniforms);
+    if (!m_TextureHandles.empty())
+    {
+        const float l_Demand = estimateTexelDemand(p_Frame.uniforms.viewProjMatrix);
+        for (const TextureHandle l_Texture : m_TextureHandles)
+            m_TextureStreamer.setDemand(l_Texture, l_Demand);
+        m_TextureStreamer.update();
+    }
+    p_Frame.pushData.materialBuffer = m_MaterialBuffer;
+    p_Frame.bindlessSet = m_BindlessTable.beginFrame(m_CurrentFrame);
+    p_Frame.instances = m_FrameAllocator.allocateStorage(static_cast<VkDeviceSize>(m_Instances.size()) * sizeof(InstanceData));
+    {
+        ProfileScope l_InstanceScope{ m_Profiler, "Instance update" };
+        constexpr uint32_t INSTANCE_GRAIN = 16384;
+        InstanceData* l_Instances = static_cast<InstanceData*>(p_Frame.instances.data);
+        m_JobSystem.parallelFor(static_cast<uint32_t>(m_Instances.size()), INSTANCE_GRAIN, [this, l_Instances](const uint32_t p_Begin, const uint32_t p_End)
+        {
+            std::copy(m_Instances.begin() + p_Begin, m_Instances.begin() + p_End, l_Instances + p_Begin);
+        });
+    }
+
+    l_GraphicsBuffer.reset();
+    l_GraphicsBuffer.beginRecording();
+    m_Profiler.resetGpuQueries(*l_GraphicsBuffer);
+    // Ownership transfers stay outside of the graph, everything it imports already belongs to the graphics queue
+    m_UploadService.acquireOnGraphics(*l_GraphicsBuffer, p_Frame.inFlightFenceID, p_Frame.waitSemaphores);
+
+    const bool l_GeometryReady = m_UploadService.isSubmitted(m_GeometryUploadTicket) && m_UploadService.isSubmitted(m_BindlessUploadTicket) &&
+        (!m_Config.gpuCulling || m_UploadService.isSubmitted(m_CullObjectsUploadTicket));
+    const VkPipeline l_Pipeline = m_PipelineCompiler.resolve(m_GraphicsPipelines[static_cast<uint32_t>(m_VertexFormat)], VK_NULL_HANDLE);
+    const bool l_DrawGeometry = l_GeometryReady && l_Pipeline != VK_NULL_HANDLE;
+    if (l_DrawGeometry && !m_Config.gpuCulling)
+    {
+        ProfileScope l_CullScope{ m_Profiler, "Frustum culling" };
+        m_Culler.cull(Frustum::fromMatrix(p_Frame.uniforms.viewProjMatrix), m_ObjectBounds, m_VisibleObjects);
+        buildVisibleDraws();
+    }
+    const uint32_t l_DrawCount = l_DrawGeometry ? getDrawCount() : 0;
+
+    m_RenderGraph.reset();
+    const RenderGraphResource l_Color = importColorTarget(p_ImageIndex);
+    const RenderGraphResource l_Depth = m_RenderGraph.createImage(VK_FORMAT_D32_SFLOAT, l_Extent, VK_IMAGE_ASPECT_DEPTH_BIT);
+
+    const bool l_GpuCulling = m_Config.gpuCulling && l_GeometryReady;
+    RenderGraphResource l_DrawCommands = 0;
+    RenderGraphResource l_VisibleCount = 0;
+    if (l_GpuCulling)
+    {
+        // Both buffers are shared by every frame slot, last read by the previous frame's draw and readback
+        l_DrawCommands = m_RenderGraph.importBuffer(m_GpuCuller.getDrawCommandBuffer(), { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0 });
+        l_VisibleCount = m_RenderGraph.importBuffer(m_GpuCuller.getCountBuffer(), { VK_PIPELINE_STAGE_TRANSFER_BIT | VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, 0 });
+        const Frustum l_Frustum = Frustum::fromMatrix(p_Frame.uniforms.viewProjMatrix);
+        m_RenderGraph.addPass("GPU culling")
+            .write(l_DrawCommands, RenderGraphUsage::STORAGE_WRITE)
+            .write(l_VisibleCount, RenderGraphUsage::TRANSFER_DST)
+            .write(l_VisibleCount, RenderGraphUsage::STORAGE_WRITE)
+            .execute([this, l_Frustum](const RenderGraphContext& p_Context) { m_GpuCuller.recordCulling(*p_Context.cmdBuffer, l_Frustum); });
+        // Read by the host for statistics, so nothing in the graph depends on it
+        m_RenderGraph.addPass("Cull readback")
+            .read(l_VisibleCount, RenderGraphUsage::TRANSFER_SRC)
+            .sideEffects()
+            .execute([this](const RenderGraphContext& p_Context) { m_GpuCuller.recordReadback(*p_Context.cmdBuffer, m_CurrentFrame); });
+    }
+
+    RenderGraphPass& l_MainPass = m_RenderGraph.addPass("Main pass")
+        .colorAttachment(l_Color, VK_ATTACHMENT_LOAD_OP_CLEAR, { { 0.0f, 0.0f, 0.0f, 1.0f } })
+        .depthAttachment(l_Depth, VK_ATTACHMENT_LOAD_OP_CLEAR);
+    if (l_GpuCulling && l_DrawCount > 0)
+    {
+        l_MainPass.read(l_DrawCommands, RenderGraphUsage::INDIRECT);
+        if (m_GpuCuller.isCompacted())
+            l_MainPass.read(l_VisibleCount, RenderGraphUsage::INDIRECT);
+    }
+    if (m_Config.recordThreads > 0)
+        l_MainPass.secondaryContents();
+    l_MainPass.execute([this, &p_Frame, l_Pipeline, l_DrawCount, p_ImguiDrawData](const RenderGraphContext& p_Context)
+    {
+        const auto l_DrawRecordStart = std::chrono::steady_clock::now();
+        if (m_Config.recordThreads == 0)
+        {
+            if (l_DrawCount > 0)
+            {
+                GpuProfileScope l_GeometryScope{ m_Profiler, *p_Context.cmdBuffer, "Geometry" };
+                recordGeometry(p_Context.cmdBuffer, p_Frame, l_Pipeline, 0, l_DrawCount);
+            }
+
+            if (p_ImguiDrawData != nullptr)
+            {
+                GpuProfileScope l_ImguiScope{ m_Profiler, *p_Context.cmdBuffer, "ImGui" };
+                ImGui_ImplVulkan_RenderDrawData(p_ImguiDrawData, *p_Context.cmdBuffer);
+            }
+        }
+        else
+        {
+            // Nothing but secondary execution is allowed in this subpass, so there are no GPU scopes per secondary
+            recordSecondaries(p_Frame, p_Context, l_Pipeline, l_DrawCount, p_ImguiDrawData);
+            vkCmdExecuteCommands(*p_Context.cmdBuffer, static_cast<uint32_t>(p_Frame.secondaryBuffers.size()), p_Frame.secondaryBuffers.data());
+        }
+        if (l_DrawCount > 0)
+        {
+            const std::chrono::duration<double, std::milli> l_DrawRecordTime = std::chrono::steady_clock::now() - l_DrawRecordStart;
+            m_DrawRecordStats.addSample(l_DrawRecordTime.count());
+        }
+    });
+
+    m_RenderGraph.execute(l_GraphicsBuffer);
+    l_GraphicsBuffer.endRecording();
+}
+
+RenderGraphResource Engine::importColorTarget(const uint32_t p_ImageIndex)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    const VkExtent2D l_Extent = getRenderExtent();
+
+    // Cleared every frame, so what was in it before never matters. The offscreen target was last written by the
+    // previous frame, the swapchain image is only waited on through the acquire semaphore
+    if (m_Config.headless)
+    {
+        VulkanImage& l_Image = l_Device.getImage(m_OffscreenColor);
+        return m_RenderGraph.importImage(*l_Image, *l_Image.getImageView(m_OffscreenColorView), VK_FORMAT_R8G8B8A8_SRGB, l_Extent, VK_IMAGE_ASPECT_COLOR_BIT,
+            { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT }, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL);
+    }
+
+    VulkanSwapchain& l_Swapchain = VulkanSwapchainExtension::get(l_Device)->getSwapchain(m_SwapchainID);
+    VulkanImage& l_Image = l_Swapchain.getImage(p_ImageIndex);
+    return m_RenderGraph.importImage(*l_Image, *l_Image.getImageView(l_Swapchain.getImageView(p_ImageIndex)), l_Swapchain.getFormat().format, l_Extent, VK_IMAGE_ASPECT_COLOR_BIT,
+        { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, 0 }, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+}
+
+void Engine::buildVisibleDraws()
+{
+    const uint32_t l_InstanceCount = static_cast<uint32_t>(m_Instances.size());
+    m_VisibleDraws.clear();
+    // The culler returns ascending indices, so the instances of a run are consecutive in the list
+    for (const uint32_t l_Object : m_VisibleObjects)
+    {
+        const uint32_t l_Submesh = l_Object / l_InstanceCount;
+        if (!m_Config.drawPerInstance && !m_VisibleDraws.empty())
+        {
+            SubmeshDraw& l_Last = m_VisibleDraws.back();
+            if (l_Last.submesh == l_Submesh && l_Last.firstObject + l_Last.instanceCount == l_Object)
+            {
+                l_Last.instanceCount++;
+                continue;
+            }
+        }
+        m_VisibleDraws.push_back({ l_Submesh, l_Object, 1 });
+    }
+}
+
+uint32_t Engine::getDrawCount() const
+{
+    if (m_Config.gpuCulling)
+        return 1;
+    return static_cast<uint32_t>(m_VisibleDraws.size());
+}
+
+void Engine::recordGeometry(VulkanCommandBuffer& p_CmdBuffer, const FrameData& p_Frame, const VkPipeline p_Pipeline, const uint32_t p_FirstDraw, const uint32_t p_DrawCount) const
+{
+    const VkExtent2D l_Extent = getRenderExtent();
+
+    VkViewport l_Viewport;
+    l_Viewport.x = 0.0f;
+    l_Viewport.y = 0.0f;
+    l_Viewport.width = static_cast<float>(l_Extent.width);
+    l_Viewport.height = static_cast<float>(l_Extent.height);
+    l_Viewport.minDepth = 0.0f;
+    l_Viewport.maxDepth = 1.0f;
+
+    VkRect2D l_Scissor;
+    l_Scissor.offset = { 0, 0 };
+    l_Scissor.extent = l_Extent;
+
+    p_CmdBuffer.cmdBindVertexBuffer(m_VertexBufferID, 0);
+    p_CmdBuffer.cmdBindIndexBuffer(m_IndexBufferID, 0, m_IndexType);
+    vkCmdBindPipeline(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, p_Pipeline);
+    // Every resource a draw may need is in the bindless set, the frame constants and the instances sit behind the frame
+    // allocator's dynamic buffers, nothing is bound per draw
+    const VkPipelineLayout l_Layout = *VulkanContext::getDevice(m_DeviceID).getPipelineLayout(m_GraphicsPipelineLayoutID);
+    const std::array<VkDescriptorSet, 2> l_Sets = { p_Frame.bindlessSet, m_FrameAllocator.getSet() };
+    const std::array<uint32_t, 2> l_DynamicOffsets = { static_cast<uint32_t>(p_Frame.uniformBlock.offset), static_cast<uint32_t>(p_Frame.instances.offset) };
+    vkCmdBindDescriptorSets(*p_CmdBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, l_Layout, 0, static_cast<uint32_t>(l_Sets.size()), l_Sets.data(),
+        static_cast<uint32_t>(l_DynamicOffsets.size()), l_DynamicOffsets.data());
+    p_CmdBuffer.cmdSetViewport(l_Viewport);
+    p_CmdBuffer.cmdSetScissor(l_Scissor);
+    p_CmdBuffer.cmdPushConstant(m_GraphicsPipelineLayoutID, VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushData), &p_Frame.pushData);
+
+    if (m_Config.gpuCulling)
+    {
+        m_GpuCuller.recordDraw(*p_CmdBuffer);
+        return;
+    }
+
+    for (uint32_t i = p_FirstDraw; i < p_FirstDraw + p_DrawCount; i++)
+    {
+        const SubmeshDraw& l_Draw = m_VisibleDraws[i];
+        const MeshSubmesh& l_Submesh = m_Submeshes[l_Draw.submesh];
+        vkCmdDrawIndexed(*p_CmdBuffer, l_Submesh.indexCount, l_Draw.instanceCount, l_Submesh.firstIndex, l_Submesh.vertexOffset, l_Draw.firstObject);
+    }
+}
+
+void Engine::recordSecondaries(FrameData& p_Frame, const RenderGraphContext& p_Context, const VkPipeline p_Pipeline, const uint32_t p_DrawCount, ImDrawData* p_ImguiDrawData)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+
+    VkCommandBufferInheritanceInfo l_Inheritance{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_INHERITANCE_INFO };
+    l_Inheritance.renderPass = p_Context.renderPass;
+    l_Inheritance.subpass = 0;
+    l_Inheritance.framebuffer = p_Context.framebuffer;
+    VkCommandBufferBeginInfo l_BeginInfo{ VK_STRUCTURE_TYPE_COMMAND_BUFFER_BEGIN_INFO };
+    l_BeginInfo.flags = VK_COMMAND_BUFFER_USAGE_RENDER_PASS_CONTINUE_BIT | VK_COMMAND_BUFFER_USAGE_ONE_TIME_SUBMIT_BIT;
+    l_BeginInfo.pInheritanceInfo = &l_Inheritance;
+
+    // Jobs only read the device tables, nothing is created or freed until they are all done. Range i owns the
+    // command pool of thread slot i + 1, the main thread's pool holds the primaries and the ImGui secondary
+    const uint32_t l_ThreadCount = m_Config.recordThreads;
+    std::vector<VulkanCommandBuffer*> l_Buffers(l_ThreadCount + 1);
+    for (uint32_t i = 0; i < l_ThreadCount; i++)
+        l_Buffers[i] = &l_Device.getCommandBuffer(p_Frame.secondaryBufferIDs[i], i + 1);
+    l_Buffers[l_ThreadCount] = &l_Device.getCommandBuffer(p_Frame.imguiBufferID, 0);
+
+    // Contiguous ranges executed in range order keep the draw order identical to single threaded recording
+    const uint32_t l_DrawsPerThread = (p_DrawCount + l_ThreadCount - 1) / l_ThreadCount;
+    const auto l_RecordRange = [&](const uint32_t p_Thread)
+    {
+        VulkanCommandBuffer& l_CmdBuffer = *l_Buffers[p_Thread];
+        l_CmdBuffer.reset();
+        vkBeginCommandBuffer(*l_CmdBuffer, &l_BeginInfo);
+        const uint32_t l_First = std::min(p_Thread * l_DrawsPerThread, p_DrawCount);
+        const uint32_t l_Count = std::min(l_DrawsPerThread, p_DrawCount - l_First);
+        if (l_Count > 0)
+            recordGeometry(l_CmdBuffer, p_Frame, p_Pipeline, l_First, l_Count);
+        vkEndCommandBuffer(*l_CmdBuffer);
+    };
+
+    // ImGui isn't thread safe, its secondary is recorded on this thread while the ranges are in flight
+    JobCounter l_Recording{};
+    for (uint32_t i = 1; i < l_ThreadCount; i++)
+        m_JobSystem.submit([&l_RecordRange, i] { l_RecordRange(i); }, &l_Recording);
+
+    VulkanCommandBuffer& l_ImguiBuffer = *l_Buffers[l_ThreadCount];
+    l_ImguiBuffer.reset();
+    vkBeginCommandBuffer(*l_ImguiBuffer, &l_BeginInfo);
+    if (p_ImguiDrawData != nullptr)
+        ImGui_ImplVulkan_RenderDrawData(p_ImguiDrawData, *l_ImguiBuffer);
+    vkEndCommandBuffer(*l_ImguiBuffer);
+
+    l_RecordRange(0);
+    m_JobSystem.wait(l_Recording);
+
+    p_Frame.secondaryBuffers.clear();
+    for (VulkanCommandBuffer* l_Buffer : l_Buffers)
+        p_Frame.secondaryBuffers.push_back(**l_Buffer);
+}
+
+void Engine::uploadGeometry()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
+        .preferredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+
+    if (m_Config.meshPath.empty())
+    {
+        m_VertexBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {sizeof(VERTICES), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_TransferQueuePos.familyIndex});
+        m_IndexBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {sizeof(INDICES), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_TransferQueuePos.familyIndex});
+        m_IndexType = VK_INDEX_TYPE_UINT16;
+        m_VertexFormat = VertexFormat::FULL;
+        m_MeshTransform = glm::mat4(1.0f);
+        m_Submeshes = { MeshSubmesh{ 0, static_cast<uint32_t>(INDICES.size()), 0, 0, { { -0.5f, -0.5f, 0.0f }, { 0.5f, 0.5f, 0.0f } } } };
+        m_MeshVertexCount = VERTICES.size();
+        m_MeshIndexCount = INDICES.size();
+
+        m_UploadService.uploadBuffer(m_VertexBufferID, VERTICES.data(), sizeof(VERTICES));
+        m_GeometryUploadTicket = m_UploadService.uploadBuffer(m_IndexBufferID, INDICES.data(), sizeof(INDICES));
+    }
+    else
+    {
+        // The blobs are copied from the mapping straight into staging memory, the file only needs to stay mapped until the upload calls return
+        const MeshFile l_Mesh{ m_Config.meshPath };
+        const std::span<const uint8_t> l_Vertices = l_Mesh.getVertexData();
+        const std::span<const uint8_t> l_Indices = l_Mesh.getIndexData();
+        if (l_Vertices.empty() || l_Indices.empty())
+            throw std::runtime_error(m_Config.meshPath + " has no geometry");
+
+        m_VertexBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {l_Vertices.size(), VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_TransferQueuePos.familyIndex});
+        m_IndexBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {l_Indices.size(), VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_TransferQueuePos.familyIndex});
+        m_IndexType = l_Mesh.getHeader().indexSize == sizeof(uint16_t) ? VK_INDEX_TYPE_UINT16 : VK_INDEX_TYPE_UINT32;
+        m_VertexFormat = l_Mesh.getHeader().vertexFormat;
+
+        const float* l_Scale = l_Mesh.getHeader().dequantizeScale;
+        const float* l_Offset = l_Mesh.getHeader().dequantizeOffset;
+        m_MeshTransform = glm::scale(glm::translate(glm::mat4(1.0f), { l_Offset[0], l_Offset[1], l_Offset[2] }), { l_Scale[0], l_Scale[1], l_Scale[2] });
+        m_Submeshes.assign(l_Mesh.getSubmeshes().begin(), l_Mesh.getSubmeshes().end());
+        if (m_Submeshes.empty())
+            throw std::runtime_error(m_Config.meshPath + " has no submeshes");
+        m_MeshVertexCount = l_Mesh.getHeader().vertexCount;
+        m_MeshIndexCount = l_Mesh.getHeader().indexCount;
+
+        m_UploadService.uploadBuffer(m_VertexBufferID, l_Vertices.data(), l_Vertices.size());
+        m_GeometryUploadTicket = m_UploadService.uploadBuffer(m_IndexBufferID, l_Indices.data(), l_Indices.size());
+    }
+
+    // Submeshes take the textures in turn. Their bindless indices are fixed from load on, so the table is written once
+    std::vector<BindlessIndex> l_Materials(m_Submeshes.size(), BindlessTable::WHITE_TEXTURE);
+    for (size_t i = 0; i < l_Materials.size() && !m_TextureHandles.empty(); i++)
+        l_Materials[i] = m_TextureStreamer.getBindlessIndex(m_TextureHandles[i % m_TextureHandles.size()]);
+    const VkDeviceSize l_MaterialBytes = l_Materials.size() * sizeof(BindlessIndex);
+    m_MaterialBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {l_MaterialBytes, VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, m_TransferQueuePos.familyIndex});
+    m_MaterialBuffer = m_BindlessTable.registerBuffer(*l_Device.getBuffer(m_MaterialBufferID));
+    // Uploaded last, so frames waiting on its ticket wait for the mesh as well
+    m_GeometryUploadTicket = m_UploadService.uploadBuffer(m_MaterialBufferID, l_Materials.data(), l_MaterialBytes);
+
+    MeshBounds l_MeshBounds = m_Submeshes.front().bounds;
+    for (const MeshSubmesh& l_Submesh : m_Submeshes)
+    {
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            l_MeshBounds.min[i] = std::min(l_MeshBounds.min[i], l_Submesh.bounds.min[i]);
+            l_MeshBounds.max[i] = std::max(l_MeshBounds.max[i], l_Submesh.bounds.max[i]);
+        }
+    }
+    createInstances(l_MeshBounds);
+
+    // One object per instance of every submesh, so the grid is culled instance by instance
+    const size_t l_ObjectCount = m_Submeshes.size() * m_Instances.size();
+    std::vector<GpuCullObject> l_Objects{};
+    if (m_Config.gpuCulling)
+        l_Objects.reserve(l_ObjectCount);
+    else
+    {
+        m_ObjectBounds.clear();
+        m_ObjectBounds.reserve(l_ObjectCount);
+        m_VisibleObjects.reserve(l_ObjectCount);
+    }
+    m_SceneMin = glm::vec3{ FLT_MAX };
+    m_SceneMax = glm::vec3{ -FLT_MAX };
+    for (uint32_t s = 0; s < m_Submeshes.size(); s++)
+    {
+        const MeshSubmesh& l_Submesh = m_Submeshes[s];
+        const glm::vec3 l_Min{ l_Submesh.bounds.min[0], l_Submesh.bounds.min[1], l_Submesh.bounds.min[2] };
+        const glm::vec3 l_Max{ l_Submesh.bounds.max[0], l_Submesh.bounds.max[1], l_Submesh.bounds.max[2] };
+        const glm::vec3 l_Extent = (l_Max - l_Min) * 0.5f;
+        for (uint32_t i = 0; i < m_Instances.size(); i++)
+        {
+            const glm::vec3 l_Center = (l_Min + l_Max) * 0.5f + glm::vec3{ m_Instances[i].transform[3] };
+            if (m_Config.gpuCulling)
+            {
+                const uint32_t l_Object = s * static_cast<uint32_t>(m_Instances.size()) + i;
+                l_Objects.push_back({ glm::vec4{ l_Center, 0.0f }, glm::vec4{ l_Extent, 0.0f }, l_Submesh.firstIndex, l_Submesh.indexCount, l_Submesh.vertexOffset, l_Object });
+            }
+            else
+                m_ObjectBounds.push(l_Center, l_Extent);
+            m_SceneMin = glm::min(m_SceneMin, l_Center - l_Extent);
+            m_SceneMax = glm::max(m_SceneMax, l_Center + l_Extent);
+        }
+    }
+    if (m_Config.gpuCulling)
+        m_CullObjectsUploadTicket = m_GpuCuller.setObjects(m_UploadService, l_Objects);
+    m_UploadService.flush();
+}
+
+void Engine::createInstances(const MeshBounds& p_MeshBounds)
+{
+    const uint32_t l_Count = m_Config.instanceCount;
+
+    // Square grid on the XY plane centered on the origin, a single instance stays untransformed
+    const uint32_t l_Side = static_cast<uint32_t>(std::ceil(std::sqrt(static_cast<double>(l_Count))));
+    const glm::vec2 l_Spacing = glm::vec2{ p_MeshBounds.max[0] - p_MeshBounds.min[0], p_MeshBounds.max[1] - p_MeshBounds.min[1] } * 1.25f;
+    const glm::vec2 l_Origin = -l_Spacing * (static_cast<float>(l_Side - 1) * 0.5f);
+
+    m_Instances.resize(l_Count);
+    for (uint32_t i = 0; i < l_Count; i++)
+    {
+        const glm::vec2 l_Cell{ static_cast<float>(i % l_Side), static_cast<float>(i / l_Side) };
+        const glm::vec3 l_Offset{ l_Origin + l_Spacing * l_Cell, 0.0f };
+        m_Instances[i].transform = glm::translate(glm::mat4(1.0f), l_Offset);
+        m_Instances[i].color = l_Count == 1 ? glm::u8vec4{ 255 } : glm::u8vec4(128 + i * 37 % 128, 128 + i * 73 % 128, 128 + i * 109 % 128, 255);
+    }
+}
+
+float Engine::estimateTexelDemand(const glm::mat4& p_ViewProj) const
+{
+    const VkExtent2D l_Extent = getRenderExtent();
+    glm::vec2 l_Min{ FLT_MAX };
+    glm::vec2 l_Max{ -FLT_MAX };
+    for (uint32_t i = 0; i < 8; i++)
+    {
+        const glm::vec3 l_Corner{ (i & 1) ? m_SceneMax.x : m_SceneMin.x, (i & 2) ? m_SceneMax.y : m_SceneMin.y, (i & 4) ? m_SceneMax.z : m_SceneMin.z };
+        const glm::vec4 l_Clip = p_ViewProj * glm::vec4{ l_Corner, 1.0f };
+        // The camera is inside or too close to the scene to tell, ask for full resolution
+        if (l_Clip.w <= 1e-4f)
+            return FLT_MAX;
+        l_Min = glm::min(l_Min, glm::vec2{ l_Clip } / l_Clip.w);
+        l_Max = glm::max(l_Max, glm::vec2{ l_Clip } / l_Clip.w);
+    }
+
+    const glm::vec2 l_Pixels = (l_Max - l_Min) * 0.5f * glm::vec2{ static_cast<float>(l_Extent.width), static_cast<float>(l_Extent.height) };
+    const glm::vec2 l_Units = glm::max(glm::vec2{ m_SceneMax - m_SceneMin }, glm::vec2{ 1e-4f });
+    return std::max(l_Pixels.x / l_Units.x, l_Pixels.y / l_Units.y);
+}
+
+void Engine::createOffscreenTarget()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    const VkExtent2D l_Extent = getRenderExtent();
+
+    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
+        .preferredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+    m_OffscreenColor = l_Device.createAndAllocateImage(l_MemPrefs, {VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_SRGB, { l_Extent.width, l_Extent.height, 1 }, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT | VK_IMAGE_USAGE_TRANSFER_SRC_BIT, 0});
+    m_OffscreenColorView = l_Device.getImage(m_OffscreenColor).createImageView(VK_FORMAT_R8G8B8A8_SRGB, VK_IMAGE_ASPECT_COLOR_BIT);
+}
+
+void Engine::readbackOffscreenImage(const std::string_view p_Path) const
+{
+    Logger::pushContext("Offscreen readback");
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    const VkExtent2D l_Extent = getRenderExtent();
+    const VkDeviceSize l_Size = static_cast<VkDeviceSize>(l_Extent.width) * l_Extent.height * 4;
+
+    ReadbackBuffer l_Readback{};
+    l_Readback.init(m_DeviceID, l_Size, "offscreen image");
+
+    // Every frame slot is idle at this point, so the current one is reused for the copy
+    const FrameData& l_Frame = m_Frames[m_CurrentFrame];
+    VulkanFence& l_Fence = l_Device.getFence(l_Frame.inFlightFenceID);
+    VulkanCommandBuffer& l_CmdBuffer = l_Device.getCommandBuffer(l_Frame.commandBufferID, 0);
+
+    l_Fence.reset();
+    l_CmdBuffer.reset();
+    l_CmdBuffer.beginRecording();
+    {
+        VkMemoryBarrier l_ToTransfer{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        l_ToTransfer.srcAccessMask = VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT;
+        l_ToTransfer.dstAccessMask = VK_ACCESS_TRANSFER_READ_BIT;
+        vkCmdPipelineBarrier(*l_CmdBuffer, VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0, 1, &l_ToTransfer, 0, nullptr, 0, nullptr);
+
+        VkBufferImageCopy l_Region{};
+        l_Region.imageSubresource = { VK_IMAGE_ASPECT_COLOR_BIT, 0, 0, 1 };
+        l_Region.imageExtent = { l_Extent.width, l_Extent.height, 1 };
+        vkCmdCopyImageToBuffer(*l_CmdBuffer, *l_Device.getImage(m_OffscreenColor), VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, l_Readback.getBuffer(), 1, &l_Region);
+
+        VkMemoryBarrier l_ToHost{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        l_ToHost.srcAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        l_ToHost.dstAccessMask = VK_ACCESS_HOST_READ_BIT;
+        vkCmdPipelineBarrier(*l_CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_HOST_BIT, 0, 1, &l_ToHost, 0, nullptr, 0, nullptr);
+    }
+    l_CmdBuffer.endRecording();
+    l_CmdBuffer.submit(l_Device.getQueue(m_GraphicsQueuePos), {}, {}, l_Frame.inFlightFenceID);
+    l_Fence.wait();
+
+    // Binary PPM, alpha is dropped
+    std::ofstream l_File{ std::string{p_Path}, std::ios::binary };
+    if (!l_File.is_open())
+    {
+        l_Readback.free();
+        throw std::runtime_error("Failed to open readback file " + std::string{p_Path});
     }
+    l_Readback.invalidate();
+    const uint8_t* l_Pixels = static_cast<const uint8_t*>(l_Readback.getData());
+    l_File << "P6\n" << l_Extent.width << " " << l_Extent.height << "\n255\n";
+    for (VkDeviceSize i = 0; i < l_Size; i += 4)
+    {
+        l_File.write(reinterpret_cast<const char*>(l_Pixels + i), 3);
+    }
+
+    l_Readback.free();
+    Logger::popContext();
 }
 
 void Engine::createRenderPasses()
@@ -289,12 +1069,18 @@ void Engine::createRenderPasses()
     Logger::pushContext("Create RenderPass");
     VulkanRenderPassBuilder l_Builder{};
     
-    VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(m_DeviceID);
-    const VkFormat l_Format = l_SwapchainExt->getSwapchain(m_SwapchainID).getFormat().format;
+    VkFormat l_Format = VK_FORMAT_R8G8B8A8_SRGB;
+    VkImageLayout l_FinalLayout = VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL;
+    if (!m_Config.headless)
+    {
+        VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(m_DeviceID);
+        l_Format = l_SwapchainExt->getSwapchain(m_SwapchainID).getFormat().format;
+        l_FinalLayout = VK_IMAGE_LAYOUT_PRESENT_SRC_KHR;
+    }
 
     const VkAttachmentDescription l_ColorAttachment = VulkanRenderPassBuilder::createAttachment(l_Format,
         VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_STORE,
-        VK_IMAGE_LAYOUT_UNDEFINED, VK_IMAGE_LAYOUT_PRESENT_SRC_KHR);
+        VK_IMAGE_LAYOUT_UNDEFINED, l_FinalLayout);
     l_Builder.addAttachment(l_ColorAttachment);
     const VkAttachmentDescription l_DepthAttachment = VulkanRenderPassBuilder::createAttachment(VK_FORMAT_D32_SFLOAT,
         VK_ATTACHMENT_LOAD_OP_CLEAR, VK_ATTACHMENT_STORE_OP_DONT_CARE,
@@ -315,84 +1101,192 @@ void Engine::createPipelines()
     {
         std::array<VkPushConstantRange, 1> l_PushConstants{};
         l_PushConstants[0] = { VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT, 0, sizeof(PushData) };
-        m_GraphicsPipelineLayoutID = l_Device.createPipelineLayout({}, l_PushConstants);
+        const std::array<VkDescriptorSetLayout, 2> l_SetLayouts = { m_BindlessTable.getSetLayout(), m_FrameAllocator.getSetLayout() };
+        m_GraphicsPipelineLayoutID = l_Device.createPipelineLayout(l_SetLayouts, l_PushConstants);
     }
-    
-#ifndef _DEBUG
-    VulkanShader l_Shader{0, false};
-    l_Shader.enableCache("shaders/cache/shader_release.bin");
-#else
-    VulkanShader l_Shader{0, true};
-    l_Shader.enableCache("shaders/cache/shader_debug.bin");
-#endif
 
-    l_Shader.setExpectedStages(VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT);
+    // One pipeline per vertex format so every mesh can be drawn with whatever format it was imported with.
+    // The shaders compile in the background while the rest of the engine initializes
+    constexpr VkShaderStageFlags STAGES = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT;
+    m_GraphicsPipelines[static_cast<uint32_t>(VertexFormat::FULL)] = m_PipelineCompiler.submit({ "shaders/shader.slang", "shader", STAGES },
+        [this](VulkanShader& p_Shader) { return buildGraphicsPipeline(VertexFormat::FULL, p_Shader); });
+    m_GraphicsPipelines[static_cast<uint32_t>(VertexFormat::QUANTIZED)] = m_PipelineCompiler.submit({ "shaders/shader_quantized.slang", "shader_quantized", STAGES },
+        [this](VulkanShader& p_Shader) { return buildGraphicsPipeline(VertexFormat::QUANTIZED, p_Shader); });
+}
+
+VkPipeline Engine::buildGraphicsPipeline(const VertexFormat p_Format, VulkanShader& p_Shader)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    const bool l_Quantized = p_Format == VertexFormat::QUANTIZED;
+
+	const ResourceID l_VertexShader = l_Device.createShaderModule(p_Shader, VK_SHADER_STAGE_VERTEX_BIT);
+	const ResourceID l_FragmentShader = l_Device.createShaderModule(p_Shader, VK_SHADER_STAGE_FRAGMENT_BIT);
+
+    // Created directly instead of through VulkanDevice::createPipeline, which has no way to pass the pipeline cache
+    std::array<VkPipelineShaderStageCreateInfo, 2> l_Stages{};
+    l_Stages[0] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_VERTEX_BIT, *l_Device.getShaderModule(l_VertexShader), "main" };
+    l_Stages[1] = { VK_STRUCTURE_TYPE_PIPELINE_SHADER_STAGE_CREATE_INFO, nullptr, 0, VK_SHADER_STAGE_FRAGMENT_BIT, *l_Device.getShaderModule(l_FragmentShader), "main" };
+
+    // Instances are read from the frame allocator's storage buffer, only the vertices come through vertex input
+    const std::array<VkVertexInputBindingDescription, 1> l_Bindings = {{
+        { 0, l_Quantized ? static_cast<uint32_t>(sizeof(QuantizedVertex)) : static_cast<uint32_t>(sizeof(Vertex)), VK_VERTEX_INPUT_RATE_VERTEX }
+    }};
+    std::vector<VkVertexInputAttributeDescription> l_Attributes{};
+    if (l_Quantized)
+    {
+        l_Attributes.push_back({ 0, 0, VK_FORMAT_R16G16B16A16_UNORM, offsetof(QuantizedVertex, position) });
+        l_Attributes.push_back({ 1, 0, VK_FORMAT_R16G16_SNORM, offsetof(QuantizedVertex, normal) });
+        l_Attributes.push_back({ 2, 0, VK_FORMAT_R8G8B8A8_UNORM, offsetof(QuantizedVertex, color) });
+    }
+    else
+    {
+        l_Attributes.push_back({ 0, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position) });
+        l_Attributes.push_back({ 1, 0, VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, normal) });
+        l_Attributes.push_back({ 2, 0, VK_FORMAT_R8G8B8_UNORM, offsetof(Vertex, color) });
+    }
+
+    VkPipelineVertexInputStateCreateInfo l_VertexInput{ VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO };
+    l_VertexInput.vertexBindingDescriptionCount = static_cast<uint32_t>(l_Bindings.size());
+    l_VertexInput.pVertexBindingDescriptions = l_Bindings.data();
+    l_VertexInput.vertexAttributeDescriptionCount = static_cast<uint32_t>(l_Attributes.size());
+    l_VertexInput.pVertexAttributeDescriptions = l_Attributes.data();
+
+    VkPipelineInputAssemblyStateCreateInfo l_InputAssembly{ VK_STRUCTURE_TYPE_PIPELINE_INPUT_ASSEMBLY_STATE_CREATE_INFO };
+    l_InputAssembly.topology = VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST;
 
-    l_Shader.addModule("shaders/shader.slang", "main");
-    l_Shader.compile();
+    VkPipelineViewportStateCreateInfo l_ViewportState{ VK_STRUCTURE_TYPE_PIPELINE_VIEWPORT_STATE_CREATE_INFO };
+    l_ViewportState.viewportCount = 1;
+    l_ViewportState.scissorCount = 1;
 
-	const ResourceID l_VertexShader = l_Device.createShaderModule(l_Shader, VK_SHADER_STAGE_VERTEX_BIT);
-	const ResourceID l_FragmentShader = l_Device.createShaderModule(l_Shader, VK_SHADER_STAGE_FRAGMENT_BIT);
+    VkPipelineRasterizationStateCreateInfo l_Rasterization{ VK_STRUCTURE_TYPE_PIPELINE_RASTERIZATION_STATE_CREATE_INFO };
+    l_Rasterization.polygonMode = VK_POLYGON_MODE_FILL;
+    l_Rasterization.cullMode = VK_CULL_MODE_NONE;
+    l_Rasterization.frontFace = VK_FRONT_FACE_CLOCKWISE;
+    l_Rasterization.lineWidth = 1.0f;
+
+    VkPipelineMultisampleStateCreateInfo l_Multisample{ VK_STRUCTURE_TYPE_PIPELINE_MULTISAMPLE_STATE_CREATE_INFO };
+    l_Multisample.rasterizationSamples = VK_SAMPLE_COUNT_1_BIT;
+    l_Multisample.minSampleShading = 1.0f;
+
+    VkPipelineDepthStencilStateCreateInfo l_DepthStencil{ VK_STRUCTURE_TYPE_PIPELINE_DEPTH_STENCIL_STATE_CREATE_INFO };
+    l_DepthStencil.depthTestEnable = VK_TRUE;
+    l_DepthStencil.depthWriteEnable = VK_TRUE;
+    l_DepthStencil.depthCompareOp = VK_COMPARE_OP_LESS;
 
 	VkPipelineColorBlendAttachmentState l_ColorBlendAttachment{};
 	l_ColorBlendAttachment.colorWriteMask = VK_COLOR_COMPONENT_R_BIT | VK_COLOR_COMPONENT_G_BIT | VK_COLOR_COMPONENT_B_BIT | VK_COLOR_COMPONENT_A_BIT;
 	l_ColorBlendAttachment.blendEnable = VK_FALSE;
-
-    VulkanBinding l_Binding{0, VK_VERTEX_INPUT_RATE_VERTEX, sizeof(Vertex)};
-	l_Binding.addAttribDescription(VK_FORMAT_R32G32B32_SFLOAT, offsetof(Vertex, position));
-	l_Binding.addAttribDescription(VK_FORMAT_R8G8B8_UNORM, offsetof(Vertex, color));
-
-    std::array<VkDynamicState, 2> l_DynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
-
-	VulkanPipelineBuilder l_Builder{ m_DeviceID };
-    l_Builder.addVertexBinding(l_Binding, true);
-	l_Builder.setInputAssemblyState(VK_PRIMITIVE_TOPOLOGY_TRIANGLE_LIST, VK_FALSE);
-	l_Builder.setViewportState(1, 1);
-	l_Builder.setRasterizationState(VK_POLYGON_MODE_FILL, VK_CULL_MODE_NONE, VK_FRONT_FACE_CLOCKWISE);
-	l_Builder.setMultisampleState(VK_SAMPLE_COUNT_1_BIT, VK_FALSE, 1.0f);
-	l_Builder.setDepthStencilState(VK_TRUE, VK_TRUE, VK_COMPARE_OP_LESS);
-	l_Builder.addColorBlendAttachment(l_ColorBlendAttachment);
-	l_Builder.setColorBlendState(VK_FALSE, VK_LOGIC_OP_COPY, {0.0f, 0.0f, 0.0f, 0.0f});
-	l_Builder.setDynamicState(l_DynamicStates);
-    l_Builder.addShaderStage(l_VertexShader);
-    l_Builder.addShaderStage(l_FragmentShader);
-	m_GraphicsPipelineID = l_Device.createPipeline(l_Builder, m_GraphicsPipelineLayoutID, m_RenderPassID, 0);
+    VkPipelineColorBlendStateCreateInfo l_ColorBlend{ VK_STRUCTURE_TYPE_PIPELINE_COLOR_BLEND_STATE_CREATE_INFO };
+    l_ColorBlend.logicOp = VK_LOGIC_OP_COPY;
+    l_ColorBlend.attachmentCount = 1;
+    l_ColorBlend.pAttachments = &l_ColorBlendAttachment;
+
+    const std::array<VkDynamicState, 2> l_DynamicStates = { VK_DYNAMIC_STATE_VIEWPORT, VK_DYNAMIC_STATE_SCISSOR };
+    VkPipelineDynamicStateCreateInfo l_DynamicState{ VK_STRUCTURE_TYPE_PIPELINE_DYNAMIC_STATE_CREATE_INFO };
+    l_DynamicState.dynamicStateCount = static_cast<uint32_t>(l_DynamicStates.size());
+    l_DynamicState.pDynamicStates = l_DynamicStates.data();
+
+    VkGraphicsPipelineCreateInfo l_PipelineInfo{ VK_STRUCTURE_TYPE_GRAPHICS_PIPELINE_CREATE_INFO };
+    l_PipelineInfo.stageCount = static_cast<uint32_t>(l_Stages.size());
+    l_PipelineInfo.pStages = l_Stages.data();
+    l_PipelineInfo.pVertexInputState = &l_VertexInput;
+    l_PipelineInfo.pInputAssemblyState = &l_InputAssembly;
+    l_PipelineInfo.pViewportState = &l_ViewportState;
+    l_PipelineInfo.pRasterizationState = &l_Rasterization;
+    l_PipelineInfo.pMultisampleState = &l_Multisample;
+    l_PipelineInfo.pDepthStencilState = &l_DepthStencil;
+    l_PipelineInfo.pColorBlendState = &l_ColorBlend;
+    l_PipelineInfo.pDynamicState = &l_DynamicState;
+    l_PipelineInfo.layout = *l_Device.getPipelineLayout(m_GraphicsPipelineLayoutID);
+    l_PipelineInfo.renderPass = *l_Device.getRenderPass(m_RenderPassID);
+    l_PipelineInfo.subpass = 0;
+    const VkPipeline l_Pipeline = m_PipelineCache.createGraphicsPipeline(l_PipelineInfo);
 
     l_Device.freeShaderModule(l_VertexShader);
     l_Device.freeShaderModule(l_FragmentShader);
+    return l_Pipeline;
+}
+
+VkPresentModeKHR Engine::choosePresentMode(const VkPresentModeKHR p_Requested)
+{
+    if (m_SupportedPresentModes.empty())
+    {
+        const VkPhysicalDevice l_GPU = *VulkanContext::getDevice(m_DeviceID).getGPU();
+        uint32_t l_ModeCount = 0;
+        vkGetPhysicalDeviceSurfacePresentModesKHR(l_GPU, m_Window.getSurface(), &l_ModeCount, nullptr);
+        m_SupportedPresentModes.resize(l_ModeCount);
+        vkGetPhysicalDeviceSurfacePresentModesKHR(l_GPU, m_Window.getSurface(), &l_ModeCount, m_SupportedPresentModes.data());
+    }
+
+    // Each mode falls back to the closest one in latency, FIFO is the only mode every surface has to support
+    std::vector<VkPresentModeKHR> l_Candidates{ p_Requested };
+    if (p_Requested == VK_PRESENT_MODE_IMMEDIATE_KHR)
+        l_Candidates.push_back(VK_PRESENT_MODE_MAILBOX_KHR);
+    else if (p_Requested == VK_PRESENT_MODE_MAILBOX_KHR)
+        l_Candidates.push_back(VK_PRESENT_MODE_IMMEDIATE_KHR);
+    m_UnsupportedPresentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+    for (const VkPresentModeKHR l_Mode : l_Candidates)
+    {
+        if (std::ranges::find(m_SupportedPresentModes, l_Mode) != m_SupportedPresentModes.end())
+            return l_Mode;
+    }
+    m_UnsupportedPresentMode = p_Requested;
+    return VK_PRESENT_MODE_FIFO_KHR;
+}
+
+void Engine::requestSwapchainResize(const VkExtent2D p_NewSize)
+{
+    m_PendingExtent = p_NewSize;
+    m_ResizePending = true;
 }
 
 void Engine::recreateSwapchain(const VkExtent2D p_NewSize)
 {
     Logger::pushContext("Recreate Swapchain");
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
-    l_Device.waitIdle();
-
     VulkanSwapchainExtension* l_SwapchainExtension = VulkanSwapchainExtension::get(l_Device);
 
-    m_SwapchainID = l_SwapchainExtension->createSwapchain(m_Window.getSurface(), p_NewSize, l_SwapchainExtension->getSwapchain(m_SwapchainID).getFormat(), VK_PRESENT_MODE_FIFO_KHR, m_SwapchainID);
+    // Frames in flight still render into the old swapchain and its framebuffers. They are released once the last frame
+    // submitted with them is done instead of waiting for the whole device here. The render graph replaces the depth
+    // buffer by itself once it sees the new extent
+    m_DeferredRelease.release(DeferredResource::SWAPCHAIN, m_SwapchainID);
+    m_RenderGraph.releaseFramebuffers();
 
-    VulkanSwapchain& l_Swapchain = l_SwapchainExtension->getSwapchain(m_SwapchainID);
+    m_SwapchainID = l_SwapchainExtension->createSwapchain(m_Window.getSurface(), p_NewSize, l_SwapchainExtension->getSwapchain(m_SwapchainID).getFormat(), m_PresentMode, m_SwapchainID);
 
-    for (uint32_t i = 0; i < l_Swapchain.getImageCount(); ++i)
-    {
-        const VkImageView l_Color = *l_Swapchain.getImage(i).getImageView(l_Swapchain.getImageView(i));
-        const std::array<VkImageView, 2> l_Attachments = { l_Color, *l_Device.getImage(m_DepthBuffer).getImageView(m_DepthBufferView) };
-        m_FramebufferIDs[i] = VulkanContext::getDevice(m_DeviceID).createFramebuffer({ l_Swapchain.getExtent().width, l_Swapchain.getExtent().height, 1 }, m_RenderPassID, l_Attachments);
-    }
+    // Image indices of the new swapchain may go past the old image count
+    const uint32_t l_ImageCount = l_SwapchainExtension->getSwapchain(m_SwapchainID).getImageCount();
+    while (m_RenderFinishedSemaphoreIDs.size() < l_ImageCount)
+        m_RenderFinishedSemaphoreIDs.push_back(l_Device.createSemaphore());
     Logger::popContext();
 }
 
+void Engine::beginFrameReleases()
+{
+    // Slot fences are waited in submission order, once this frame's slot is free every frame but the
+    // framesInFlight - 1 most recent ones has finished
+    const uint64_t l_PendingFrames = m_Config.framesInFlight - 1;
+    m_DeferredRelease.collect(m_SubmittedFrames > l_PendingFrames ? m_SubmittedFrames - l_PendingFrames : 0);
+}
+
+void Engine::endFrameReleases()
+{
+    m_SubmittedFrames++;
+    m_DeferredRelease.setCurrentFrame(m_SubmittedFrames);
+}
+
 void Engine::configureCamera()
 {
+    m_Window.setInputCoalescing(!m_Config.rawMouseInput);
+
     Camera* l_Camera = &m_Camera;
-    m_Window.getKeyPressedSignal().connect(l_Camera, &Camera::keyPressed);
-    m_Window.getKeyReleasedSignal().connect(l_Camera, &Camera::keyReleased);
-    m_Window.getMouseMovedSignal().connect(l_Camera, &Camera::mouseMoved);
-    m_Window.getMouseButtonPressedSignal().connect(l_Camera, &Camera::mouseButtonPressed);
-    m_Window.getMouseButtonReleasedSignal().connect(l_Camera, &Camera::mouseButtonReleased);
-    m_Window.getMouseScrolledSignal().connect(l_Camera, &Camera::mouseScrolled);
-    m_Window.getEventsProcessedSignal().connect(l_Camera, &Camera::updateEvents);
+    m_Window.getKeyPressedSignal().connect<&Camera::keyPressed>(l_Camera);
+    m_Window.getKeyReleasedSignal().connect<&Camera::keyReleased>(l_Camera);
+    m_Window.getMouseMovedSignal().connect<&Camera::mouseMoved>(l_Camera);
+    m_Window.getMouseButtonPressedSignal().connect<&Camera::mouseButtonPressed>(l_Camera);
+    m_Window.getMouseButtonReleasedSignal().connect<&Camera::mouseButtonReleased>(l_Camera);
+    m_Window.getMouseScrolledSignal().connect<&Camera::mouseScrolled>(l_Camera);
+    m_Window.getEventsProcessedSignal().connect<&Camera::updateEvents>(l_Camera);
 
     if constexpr (std::is_same_v<decltype(m_Camera), FlightCamera>)
     {
@@ -400,7 +1294,15 @@ void Engine::configureCamera()
     }
 }
 
-void Engine::initImgui() const
+void Engine::publishCamera()
+{
+    CameraSnapshot& l_Snapshot = m_CameraSnapshots.getWriteBuffer();
+    l_Snapshot.viewProj = m_Camera.getVPMatrix();
+    l_Snapshot.sampleTime = std::chrono::steady_clock::now();
+    m_CameraSnapshots.publish();
+}
+
+void Engine::initImgui()
 {
     IMGUI_CHECKVERSION();
     ImGui::CreateContext();
@@ -410,21 +1312,10 @@ void Engine::initImgui() const
 
     VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
 
-    const std::array<VkDescriptorPoolSize, 11> l_PoolSizes =
-    {{
-        { VK_DESCRIPTOR_TYPE_SAMPLER, 1000 },
-        { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, 1000 },
-        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_IMAGE, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_TEXEL_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_TEXEL_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, 1000 },
-        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1000 },
-        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1000 },
-        { VK_DESCRIPTOR_TYPE_INPUT_ATTACHMENT, 1000 }
-    }};
-    const uint32_t l_ImguiPoolID = l_Device.createDescriptorPool(l_PoolSizes, 1000U * static_cast<uint32_t>(l_PoolSizes.size()), VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
+    // The ImGui backend only allocates one combined image sampler per texture, the font atlas being the only one
+    constexpr uint32_t IMGUI_TEXTURES = 16;
+    const std::array<VkDescriptorPoolSize, 1> l_PoolSizes = {{ { VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, IMGUI_TEXTURES } }};
+    const uint32_t l_ImguiPoolID = l_Device.createDescriptorPool(l_PoolSizes, IMGUI_TEXTURES, VK_DESCRIPTOR_POOL_CREATE_FREE_DESCRIPTOR_SET_BIT);
 
     VulkanSwapchainExtension* l_SwapchainExt = VulkanSwapchainExtension::get(l_Device);
     const VulkanSwapchain& l_Swapchain = l_SwapchainExt->getSwapchain(m_SwapchainID);
@@ -445,7 +1336,7 @@ void Engine::initImgui() const
     ImGui_ImplVulkan_Init(&l_InitInfo );
 }
 
-void Engine::drawImgui() const
+void Engine::drawImgui()
 {
     ImGui_ImplVulkan_NewFrame();
     m_Window.frameImgui();
@@ -454,6 +1345,64 @@ void Engine::drawImgui() const
     // ImGui here
     {
         ImGui::ShowDemoWindow();
+
+        ImGui::Begin("Frame");
+        ImGui::Text("Frames in flight: %u", m_Config.framesInFlight);
+        ImGui::Text("Frame: %.3f ms", m_FrameBenchmark.getLastFrameMs());
+        ImGui::Text("Fence wait: %.3f ms", m_FrameBenchmark.getLastFenceWaitMs());
+        ImGui::Text("CPU/GPU overlap: %.1f%%", m_FrameBenchmark.getOverlapRatio() * 100.0);
+        ImGui::Text("Mesh: %llu vertices, %llu indices, %zu submeshes", static_cast<unsigned long long>(m_MeshVertexCount),
+            static_cast<unsigned long long>(m_MeshIndexCount), m_Submeshes.size());
+        ImGui::Text("Instances: %zu", m_Instances.size());
+        ImGui::Text("Draw recording: %.3f ms, %u draws", m_DrawRecordStats.getLast(), getDrawCount());
+        ImGui::Text("Shader compile: %.1f ms over %u threads", m_PipelineCompiler.getCompileMs(), m_PipelineCompiler.getThreadCount());
+        if (m_Config.gpuCulling)
+            ImGui::Text("Visible submesh instances: %u / %u (GPU, %s)", m_GpuCuller.getVisibleCount(m_CurrentFrame), m_GpuCuller.getObjectCount(),
+                m_GpuCuller.isCompacted() ? "compacted" : "fixed slots");
+        else
+            ImGui::Text("Visible submesh instances: %zu / %u (%s)", m_VisibleObjects.size(), m_ObjectBounds.size(), FrustumCuller::getPathName(m_Culler.getPath()));
+        ImGui::Text("Staging: %.1f / %.1f MB", m_UploadService.getStagingUsed() / (1024.0 * 1024.0), m_UploadService.getStagingCapacity() / (1024.0 * 1024.0));
+        ImGui::Text("Upload throughput: %.1f MB/s (last batch %.1f MB/s)", m_UploadService.getStats().getMBps(), m_UploadService.getStats().lastBatchMBps);
+        ImGui::Text("Frame arena: %.1f / %.1f KB (peak %.1f KB)", m_FrameAllocator.getFrameUsed() / 1024.0, m_FrameAllocator.getFrameCapacity() / 1024.0, m_FrameAllocator.getPeakUsed() / 1024.0);
+        ImGui::Text("Bindless: %u / %u textures, %u / %u buffers", m_BindlessTable.getTextureCount(), m_BindlessTable.getTextureCapacity() - 1,
+            m_BindlessTable.getBufferCount(), m_BindlessTable.getBufferCapacity() - 1);
+        if (!m_TextureHandles.empty())
+        {
+            const TextureStreamStats& l_TextureStats = m_TextureStreamer.getStats();
+            ImGui::Text("Textures: %.1f / %.1f MB resident (%.1f MB wanted), %u transfers in flight", l_TextureStats.residentBytes / (1024.0 * 1024.0),
+                m_TextureStreamer.getBudget() / (1024.0 * 1024.0), l_TextureStats.requestedBytes / (1024.0 * 1024.0), l_TextureStats.transfersInFlight);
+            if (l_TextureStats.failedTextures > 0)
+                ImGui::Text("Texture decode failures: %u, last: %s", l_TextureStats.failedTextures, l_TextureStats.lastError.c_str());
+        }
+        const RenderGraphStats& l_GraphStats = m_RenderGraph.getStats();
+        ImGui::Text("Render graph: %u passes (%u culled), %u barriers, %u transients in %.1f MB (%.1f MB unaliased)", l_GraphStats.passCount, l_GraphStats.culledPasses,
+            l_GraphStats.barrierCount, l_GraphStats.transientImages, l_GraphStats.transientBytes / (1024.0 * 1024.0), l_GraphStats.unaliasedBytes / (1024.0 * 1024.0));
+        ImGui::Text("Deferred releases: %zu pending, %llu released", m_DeferredRelease.getPendingCount(), static_cast<unsigned long long>(m_DeferredRelease.getReleasedCount()));
+        ImGui::End();
+
+        ImGui::Begin("Latency");
+        if (ImGui::BeginCombo("Present mode", getPresentModeName(m_PresentMode)))
+        {
+            for (const VkPresentModeKHR l_Mode : PRESENT_MODES)
+            {
+                const bool l_Supported = std::ranges::find(m_SupportedPresentModes, l_Mode) != m_SupportedPresentModes.end();
+                ImGui::BeginDisabled(!l_Supported);
+                if (ImGui::Selectable(getPresentModeName(l_Mode), l_Mode == m_PresentMode))
+                    m_RequestedPresentMode = l_Mode;
+                ImGui::EndDisabled();
+            }
+            ImGui::EndCombo();
+        }
+        if (m_UnsupportedPresentMode != VK_PRESENT_MODE_MAX_ENUM_KHR)
+            ImGui::Text("%s isn't supported, using FIFO", getPresentModeName(m_UnsupportedPresentMode));
+        constexpr uint32_t MIN_QUEUED_FRAMES = 1;
+        ImGui::SliderScalar("Max queued frames", ImGuiDataType_U32, &m_Config.maxQueuedFrames, &MIN_QUEUED_FRAMES, &m_Config.framesInFlight);
+        ImGui::Checkbox("Sleep before acquire", &m_Config.latencySleep);
+        ImGui::Text("Latency sleep: %.2f ms", m_LatencyLimiter.getSleepMs());
+        ImGui::Text("Input to present: %.2f ms (avg %.2f, p95 %.2f)", m_InputLatencyStats.getLast(), m_InputLatencyStats.getAverage(), m_InputLatencyStats.getPercentile(0.95));
+        ImGui::End();
+
+        m_Profiler.drawImgui();
     }
 
     ImGui::Render();
@@ -1,4 +1,8 @@
 #pragma once
+#include <array>
+#include <chrono>
+#include <stop_token>
+#include <string>
 #include <utils/identifiable.hpp>
 
 #include "sdl_window.hpp"
@@ -6,32 +10,177 @@
 #include "camera/arcball_camera.hpp"
 #include "camera/flight_camera.hpp"
 #include "camera/ortho_controller_camera.hpp"
+#include "frame_benchmark.hpp"
+#include "latency_limiter.hpp"
+#include "concurrency/triple_buffer.hpp"
+#include "jobs/job_system.hpp"
+#include "pipeline/pipeline_cache.hpp"
+#include "pipeline/pipeline_compiler.hpp"
+#include "culling/frustum_culler.hpp"
+#include "culling/gpu_culler.hpp"
+#include "profiling/profiler.hpp"
+#include "rendering/render_graph.hpp"
+#include "resources/bindless_table.hpp"
+#include "resources/deferred_release_queue.hpp"
+#include "resources/frame_allocator.hpp"
+#include "textures/texture_streamer.hpp"
+#include "mesh/mesh_file.hpp"
+#include "upload/upload_service.hpp"
 
-struct PushData
+struct ImDrawData;
+
+// Matches FrameUniforms in the shaders, pushed into the frame allocator once per frame and bound with a dynamic offset
+struct FrameUniforms
 {
     alignas(16) glm::mat4 modelMatrix;
     alignas(16) glm::mat4 viewProjMatrix;
+    // Draws are instanced over objects, the vertex shader splits the object index into submesh and instance with it
+    uint32_t instanceCount;
+};
+
+struct PushData
+{
+    // Bindless buffer holding the texture index of every submesh
+    uint32_t materialBuffer = BindlessTable::ZERO_BUFFER;
+};
+
+// Every device guarantees 128 bytes of push constants, anything larger belongs in FrameUniforms
+static_assert(sizeof(PushData) <= 128, "PushData must fit the guaranteed push constant size");
+
+// Camera state the render thread needs, published by the event loop after every poll
+struct CameraSnapshot
+{
+    glm::mat4 viewProj{ 1.0f };
+    std::chrono::steady_clock::time_point sampleTime{};
+};
+
+struct EngineConfig
+{
+    uint32_t framesInFlight = 2;
+    uint32_t benchmarkFrames = 0;
+    float benchmarkSeconds = 0.0f;
+
+    // Renders into an offscreen color/depth pair instead of a window swapchain
+    bool headless = false;
+    VkExtent2D headlessExtent{ 1920, 1080 };
+    std::string readbackPath{};
+
+    // Chrome trace JSON written when run() returns, empty disables the capture
+    std::string tracePath{};
+
+    // Staging ring for the upload service, chunkCount chunks of chunkSize bytes can be in flight at once
+    VkDeviceSize uploadChunkSize = 8LL * 1024 * 1024;
+    uint32_t uploadChunkCount = 4;
+
+    // Binary mesh file to render, the built-in triangle is used when empty
+    std::string meshPath{};
+
+    // Culls submeshes in a compute pass and draws them indirectly instead of culling on the CPU
+    bool gpuCulling = false;
+
+    // Copies of the mesh laid out on a grid, all of them are drawn with a single instanced draw per submesh
+    uint32_t instanceCount = 1;
+    // Stress scene, every instance gets its own draw call instead of one instanced draw per submesh
+    bool drawPerInstance = false;
+
+    // Ranges of draws recorded into secondary command buffers as jobs, 0 records everything inline on the main thread
+    uint32_t recordThreads = 0;
+
+    // Per frame ring for instances and other transient GPU data, grown to fit the instances when smaller
+    VkDeviceSize frameArenaSize = 4LL * 1024 * 1024;
+
+    // KTX2 textures streamed in the background, submeshes take them in turn. Resident mips are kept within the budget
+    std::vector<std::string> texturePaths{};
+    VkDeviceSize textureBudget = 256LL * 1024 * 1024;
+
+    // Job system workers next to the main thread, 0 starts one per remaining hardware thread
+    uint32_t jobThreads = 0;
+
+    // Mouse motion reaches the camera once per event instead of once per poll
+    bool rawMouseInput = false;
+
+    // Falls back to the closest supported mode, then FIFO. Can be changed at runtime from the latency window
+    VkPresentModeKHR presentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // Frames submitted but not finished on the GPU when a new one starts, 0 allows every frame in flight
+    uint32_t maxQueuedFrames = 0;
+    // Sleeps away the time the render thread would block on the GPU and swapchain, before input is sampled
+    bool latencySleep = false;
 };
 
 class Engine
 {
 public:
-    Engine();
+    explicit Engine(const EngineConfig& p_Config = {});
     ~Engine();
     void run();
 
 private:
     void createRenderPasses();
     void createPipelines();
+    [[nodiscard]] VkPipeline buildGraphicsPipeline(VertexFormat p_Format, VulkanShader& p_Shader);
+    void createOffscreenTarget();
+    void uploadGeometry();
+    void createInstances(const MeshBounds& p_MeshBounds);
+
+    void runWindowed();
+    void renderWindowed(const std::stop_token& p_Stop);
+    void runHeadless();
+
+    [[nodiscard]] bool isBenchmarkFinished() const;
+    [[nodiscard]] VkExtent2D getRenderExtent() const;
+    // Screen pixels one world unit of the scene's XY extent covers, textures are projected over that extent
+    [[nodiscard]] float estimateTexelDemand(const glm::mat4& p_ViewProj) const;
 
+    void readbackOffscreenImage(std::string_view p_Path) const;
+
+    void requestSwapchainResize(VkExtent2D p_NewSize);
     void recreateSwapchain(VkExtent2D p_NewSize);
+    void beginFrameReleases();
+    void endFrameReleases();
+    [[nodiscard]] VkPresentModeKHR choosePresentMode(VkPresentModeKHR p_Requested);
 
     void configureCamera();
+    void publishCamera();
+
+    struct FrameData
+    {
+        ResourceID commandBufferID;
+        ResourceID inFlightFenceID;
+        // Windowed only, signaled by the acquire of the swapchain image this slot renders into
+        ResourceID imageAvailableSemaphoreID = UINT32_MAX;
+        FrameUniforms uniforms{};
+        FrameAllocation uniformBlock{};
+        PushData pushData{};
+        FrameAllocation instances{};
+        VkDescriptorSet bindlessSet = VK_NULL_HANDLE;
+        std::chrono::steady_clock::time_point inputSampleTime{};
+        std::vector<VulkanCommandBuffer::WaitSemaphoreData> waitSemaphores{};
+
+        // One secondary per recorded range followed by the ImGui one, executed in that order
+        std::vector<ResourceID> secondaryBufferIDs{};
+        ResourceID imguiBufferID;
+        std::vector<VkCommandBuffer> secondaryBuffers{};
+    };
+
+    void recordFrame(FrameData& p_Frame, uint32_t p_ImageIndex, ImDrawData* p_ImguiDrawData);
+    // Offscreen target or the acquired swapchain image, presented or read back once the graph is done with it
+    [[nodiscard]] RenderGraphResource importColorTarget(uint32_t p_ImageIndex);
+    // Turns the visible objects into draws, runs of consecutive instances of a submesh share one draw unless every instance draws on its own
+    void buildVisibleDraws();
+    [[nodiscard]] uint32_t getDrawCount() const;
+    void recordGeometry(VulkanCommandBuffer& p_CmdBuffer, const FrameData& p_Frame, VkPipeline p_Pipeline, uint32_t p_FirstDraw, uint32_t p_DrawCount) const;
+    void recordSecondaries(FrameData& p_Frame, const RenderGraphContext& p_Context, VkPipeline p_Pipeline, uint32_t p_DrawCount, ImDrawData* p_ImguiDrawData);
+
+    EngineConfig m_Config;
+    JobSystem m_JobSystem{};
+    std::vector<float> m_ThreadUtilization{};
 
     SDLWindow m_Window;
     ArcballCamera m_Camera{glm::vec3{}, 10.f};
     //OrthoControllerCamera m_Camera{glm::vec3{ 0.0f, 0.0f, -1.0f }, glm::vec3{0.0f, 0.0f, 1.0f}, glm::vec3{0.0f, 1.0f, 0.0f}, {-5.f, 5.f}, {-5.f, 5.f}};
     //FlightCamera m_Camera{glm::vec3{ 0.0f, 0.0f, -5.0f }, glm::vec3{ 0.0f, 0.0f, 1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f }};
+    // The camera belongs to the event loop thread, frames only ever read the latest snapshot of it
+    TripleBuffer<CameraSnapshot> m_CameraSnapshots{};
 
     QueueSelection m_GraphicsQueuePos;
     QueueSelection m_PresentQueuePos;
@@ -40,24 +189,89 @@ private:
     ResourceID m_DeviceID;
 
     ResourceID m_SwapchainID;
+    std::vector<VkPresentModeKHR> m_SupportedPresentModes{};
+    VkPresentModeKHR m_PresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // Set from ImGui, the swapchain is recreated at the start of the next frame
+    VkPresentModeKHR m_RequestedPresentMode = VK_PRESENT_MODE_FIFO_KHR;
+    // Last mode that had to fall back to FIFO, MAX_ENUM when the last choice was honored
+    VkPresentModeKHR m_UnsupportedPresentMode = VK_PRESENT_MODE_MAX_ENUM_KHR;
+    LatencyLimiter m_LatencyLimiter{};
 
-    ResourceID m_GraphicsCmdBufferID;
+    // Resize storms only keep the last size, the swapchain is recreated once at the start of the next frame
+    bool m_ResizePending = false;
+    VkExtent2D m_PendingExtent{};
+    uint64_t m_SubmittedFrames = 0;
+    DeferredReleaseQueue m_DeferredRelease{};
+    FrameAllocator m_FrameAllocator{};
+    ScopeStats m_InputLatencyStats{};
 
-    ResourceID m_DepthBuffer;
-    ResourceID m_DepthBufferView;
-	std::vector<ResourceID> m_FramebufferIDs{};
+    ResourceID m_OffscreenColor;
+    ResourceID m_OffscreenColorView;
 
+    std::vector<FrameData> m_Frames{};
+    uint32_t m_CurrentFrame = 0;
+
+    // Pipelines and ImGui are built against this one, the render graph begins compatible render passes of its own
     ResourceID m_RenderPassID;
+    // Rebuilt every frame, owns the depth buffer and every framebuffer
+    RenderGraph m_RenderGraph{};
+    PipelineCache m_PipelineCache{};
+
+    UploadService m_UploadService;
+    UploadTicket m_GeometryUploadTicket = UploadService::INVALID_TICKET;
+    BindlessTable m_BindlessTable{};
+    UploadTicket m_BindlessUploadTicket = UploadService::INVALID_TICKET;
+    TextureStreamer m_TextureStreamer{};
+    std::vector<TextureHandle> m_TextureHandles{};
 
     ResourceID m_VertexBufferID;
     ResourceID m_IndexBufferID;
-    ResourceID m_GraphicsPipelineID;
+    // Bindless texture index per submesh, read by the fragment shader through the bindless buffer array
+    ResourceID m_MaterialBufferID = UINT32_MAX;
+    BindlessIndex m_MaterialBuffer = BindlessTable::INVALID_INDEX;
+    VkIndexType m_IndexType = VK_INDEX_TYPE_UINT16;
+    VertexFormat m_VertexFormat = VertexFormat::FULL;
+    glm::mat4 m_MeshTransform{ 1.0f };
+    std::vector<MeshSubmesh> m_Submeshes{};
+    uint64_t m_MeshVertexCount = 0;
+    uint64_t m_MeshIndexCount = 0;
+
+    // Written into the frame slot's instance buffer every frame, placement only translates
+    std::vector<InstanceData> m_Instances{};
+    // Every instance of every submesh, in the space textures are projected in
+    glm::vec3 m_SceneMin{ 0.0f };
+    glm::vec3 m_SceneMax{ 0.0f };
+
+    // Consecutive visible instances of one submesh, recorded as a single draw instanced over their object indices
+    struct SubmeshDraw
+    {
+        uint32_t submesh;
+        uint32_t firstObject;
+        uint32_t instanceCount;
+    };
+
+    // Culled objects are submesh instances, submesh major: object i is instance i % instance count of submesh
+    // i / instance count, its box is the submesh bounds translated by the instance's placement. Both culling paths draw
+    // with the object index as the instance index, so the shaders see the same submesh and instance either way
+    AabbSoA m_ObjectBounds{};
+    FrustumCuller m_Culler{};
+    std::vector<uint32_t> m_VisibleObjects{};
+    std::vector<SubmeshDraw> m_VisibleDraws{};
+    ScopeStats m_DrawRecordStats{};
+    GpuCuller m_GpuCuller{};
+    UploadTicket m_CullObjectsUploadTicket = UploadService::INVALID_TICKET;
+    // Resolved by the pipeline compiler as their shaders finish, geometry isn't drawn until the mesh's format is ready
+    PipelineCompiler m_PipelineCompiler{};
+    std::array<PipelineCompiler::Handle, VERTEX_FORMAT_COUNT> m_GraphicsPipelines{};
     ResourceID m_GraphicsPipelineLayoutID;
 
     std::vector<ResourceID> m_RenderFinishedSemaphoreIDs;
-    ResourceID m_InFlightFenceID;
+
+    FrameBenchmark m_FrameBenchmark;
+    Profiler m_Profiler;
+    std::chrono::steady_clock::time_point m_BenchmarkStart{};
 
 private:
-    void initImgui() const;
-    void drawImgui() const;
+    void initImgui();
+    void drawImgui();
 };
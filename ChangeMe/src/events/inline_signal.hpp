@@ -0,0 +1,91 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <new>
+#include <stdexcept>
+#include <type_traits>
+#include <utility>
+
+// Signal whose slots live inline in a fixed array, connecting and emitting never touch the heap. Callables are copied
+// into a small buffer per slot so they have to be trivially copyable, which every lambda capturing pointers or references is.
+// connect<&Type::method>(object) binds the method at compile time and its call inlines into the slot's thunk
+template<typename... Args>
+class InlineSignal
+{
+public:
+    static constexpr uint32_t CAPACITY = 8;
+    static constexpr size_t STORAGE_SIZE = 4 * sizeof(void*);
+
+    template<auto Method, typename T>
+    void connect(T* p_Object)
+    {
+        Slot& l_Slot = addSlot();
+        std::memcpy(l_Slot.storage, &p_Object, sizeof(p_Object));
+        l_Slot.invoke = [](void* p_Storage, Args... p_Args)
+        {
+            T* l_Object;
+            std::memcpy(&l_Object, p_Storage, sizeof(l_Object));
+            (l_Object->*Method)(p_Args...);
+        };
+    }
+
+    template<auto Func>
+    void connect()
+    {
+        addSlot().invoke = [](void*, Args... p_Args) { Func(p_Args...); };
+    }
+
+    template<typename T, typename Base>
+    void connect(T* p_Object, void (Base::*p_Method)(Args...))
+    {
+        connectCallable([p_Object, p_Method](Args... p_Args) { (p_Object->*p_Method)(p_Args...); });
+    }
+
+    template<typename Func>
+    void connect(Func&& p_Func)
+    {
+        connectCallable(std::forward<Func>(p_Func));
+    }
+
+    void emit(Args... p_Args)
+    {
+        for (uint32_t i = 0; i < m_SlotCount; i++)
+            m_Slots[i].invoke(m_Slots[i].storage, p_Args...);
+    }
+
+    void disconnectAll() { m_SlotCount = 0; }
+    [[nodiscard]] uint32_t getSlotCount() const { return m_SlotCount; }
+
+private:
+    struct Slot
+    {
+        void (*invoke)(void*, Args...);
+        alignas(std::max_align_t) std::byte storage[STORAGE_SIZE];
+    };
+
+    template<typename Func>
+    void connectCallable(Func&& p_Func)
+    {
+        using Callable = std::decay_t<Func>;
+        static_assert(sizeof(Callable) <= STORAGE_SIZE, "Callable is too big for the inline slot storage");
+        static_assert(alignof(Callable) <= alignof(std::max_align_t), "Callable is over-aligned for the inline slot storage");
+        static_assert(std::is_trivially_copyable_v<Callable> && std::is_trivially_destructible_v<Callable>, "Slots are never destroyed, callables must be trivially copyable");
+
+        Slot& l_Slot = addSlot();
+        ::new (l_Slot.storage) Callable(std::forward<Func>(p_Func));
+        l_Slot.invoke = [](void* p_Storage, Args... p_Args) { (*std::launder(static_cast<Callable*>(p_Storage)))(p_Args...); };
+    }
+
+    Slot& addSlot()
+    {
+        if (m_SlotCount == CAPACITY)
+            throw std::runtime_error("Signal has no free slot left");
+        return m_Slots[m_SlotCount++];
+    }
+
+    std::array<Slot, CAPACITY> m_Slots{};
+    uint32_t m_SlotCount = 0;
+};
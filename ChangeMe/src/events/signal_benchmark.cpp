@@ -0,0 +1,72 @@
+#include "signal_benchmark.hpp"
+
+#include <array>
+#include <chrono>
+#include <iomanip>
+
+#include "utils/signal.hpp"
+#include "events/inline_signal.hpp"
+
+static constexpr uint32_t RECEIVER_COUNT = 4;
+
+namespace
+{
+    struct Receiver
+    {
+        float sum = 0.0f;
+
+        void mouseMoved(const float p_RelX, const float p_RelY) { sum += p_RelX + p_RelY; }
+    };
+}
+
+template<typename SignalType, typename ConnectFunc>
+static void benchmarkSignal(const char* p_Name, const ConnectFunc& p_Connect, const uint32_t p_EmitCount, std::ostream& p_Stream)
+{
+    std::array<Receiver, RECEIVER_COUNT> l_Receivers{};
+    SignalType l_Signal{};
+    for (Receiver& l_Receiver : l_Receivers)
+        p_Connect(l_Signal, l_Receiver);
+
+    // Warm up so the first emit's cache misses don't end up in the numbers
+    l_Signal.emit(0.0f, 0.0f);
+
+    const std::chrono::steady_clock::time_point l_Start = std::chrono::steady_clock::now();
+    for (uint32_t i = 0; i < p_EmitCount; i++)
+        l_Signal.emit(static_cast<float>(i & 7), 1.0f);
+    const double l_Ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - l_Start).count() / p_EmitCount;
+
+    float l_Checksum = 0.0f;
+    for (const Receiver& l_Receiver : l_Receivers)
+        l_Checksum += l_Receiver.sum;
+
+    p_Stream << std::fixed << std::setprecision(2)
+        << p_Name << " | " << l_Ns << " ns/emit"
+        << " | checksum: " << l_Checksum << "\n";
+}
+
+void runSignalBenchmark(const uint32_t p_EmitCount, std::ostream& p_Stream)
+{
+    p_Stream << "Signals: " << p_EmitCount << " emits into " << RECEIVER_COUNT << " receivers\n";
+
+    benchmarkSignal<Signal<float, float>>("Signal, member", [](Signal<float, float>& p_Signal, Receiver& p_Receiver)
+    {
+        p_Signal.connect(&p_Receiver, &Receiver::mouseMoved);
+    }, p_EmitCount, p_Stream);
+    benchmarkSignal<Signal<float, float>>("Signal, lambda", [](Signal<float, float>& p_Signal, Receiver& p_Receiver)
+    {
+        p_Signal.connect([&p_Receiver](const float p_RelX, const float p_RelY) { p_Receiver.mouseMoved(p_RelX, p_RelY); });
+    }, p_EmitCount, p_Stream);
+
+    benchmarkSignal<InlineSignal<float, float>>("InlineSignal, member", [](InlineSignal<float, float>& p_Signal, Receiver& p_Receiver)
+    {
+        p_Signal.connect(&p_Receiver, &Receiver::mouseMoved);
+    }, p_EmitCount, p_Stream);
+    benchmarkSignal<InlineSignal<float, float>>("InlineSignal, lambda", [](InlineSignal<float, float>& p_Signal, Receiver& p_Receiver)
+    {
+        p_Signal.connect([&p_Receiver](const float p_RelX, const float p_RelY) { p_Receiver.mouseMoved(p_RelX, p_RelY); });
+    }, p_EmitCount, p_Stream);
+    benchmarkSignal<InlineSignal<float, float>>("InlineSignal, bound", [](InlineSignal<float, float>& p_Signal, Receiver& p_Receiver)
+    {
+        p_Signal.connect<&Receiver::mouseMoved>(&p_Receiver);
+    }, p_EmitCount, p_Stream);
+}
@@ -0,0 +1,7 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Emits p_EmitCount times into a few receivers through the library Signal and InlineSignal with every connection kind
+void runSignalBenchmark(uint32_t p_EmitCount, std::ostream& p_Stream);
@@ -0,0 +1,67 @@
+#include "frame_benchmark.hpp"
+
+#include <iomanip>
+
+static double toMs(const std::chrono::steady_clock::duration p_Duration)
+{
+    return std::chrono::duration<double, std::milli>(p_Duration).count();
+}
+
+void FrameBenchmark::beginFrame()
+{
+    m_FrameStart = Clock::now();
+    m_LastFenceWaitMs = 0.0;
+}
+
+void FrameBenchmark::beginFenceWait()
+{
+    m_WaitStart = Clock::now();
+}
+
+void FrameBenchmark::endFenceWait()
+{
+    m_LastFenceWaitMs += toMs(Clock::now() - m_WaitStart);
+}
+
+void FrameBenchmark::endFrame()
+{
+    m_LastFrameMs = toMs(Clock::now() - m_FrameStart);
+    m_TotalFrameMs += m_LastFrameMs;
+    m_TotalFenceWaitMs += m_LastFenceWaitMs;
+    m_FrameCount++;
+}
+
+void FrameBenchmark::reset()
+{
+    m_FrameCount = 0;
+    m_TotalFrameMs = 0.0;
+    m_TotalFenceWaitMs = 0.0;
+}
+
+double FrameBenchmark::getAverageFrameMs() const
+{
+    return m_FrameCount > 0 ? m_TotalFrameMs / static_cast<double>(m_FrameCount) : 0.0;
+}
+
+double FrameBenchmark::getAverageFenceWaitMs() const
+{
+    return m_FrameCount > 0 ? m_TotalFenceWaitMs / static_cast<double>(m_FrameCount) : 0.0;
+}
+
+double FrameBenchmark::getOverlapRatio() const
+{
+    if (m_TotalFrameMs <= 0.0)
+        return 0.0;
+    return 1.0 - m_TotalFenceWaitMs / m_TotalFrameMs;
+}
+
+void FrameBenchmark::report(std::ostream& p_Stream, const uint32_t p_FramesInFlight) const
+{
+    const double l_AvgFrame = getAverageFrameMs();
+    p_Stream << std::fixed << std::setprecision(3)
+        << "Frames in flight: " << p_FramesInFlight
+        << " | frames: " << m_FrameCount
+        << " | avg frame: " << l_AvgFrame << " ms (" << (l_AvgFrame > 0.0 ? 1000.0 / l_AvgFrame : 0.0) << " fps)"
+        << " | avg fence wait: " << getAverageFenceWaitMs() << " ms"
+        << " | CPU/GPU overlap: " << getOverlapRatio() * 100.0 << "%\n";
+}
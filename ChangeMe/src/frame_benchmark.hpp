@@ -0,0 +1,40 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+
+class FrameBenchmark
+{
+public:
+    void beginFrame();
+    void beginFenceWait();
+    void endFenceWait();
+    void endFrame();
+
+    void reset();
+
+    [[nodiscard]] uint64_t getFrameCount() const { return m_FrameCount; }
+    [[nodiscard]] double getAverageFrameMs() const;
+    [[nodiscard]] double getAverageFenceWaitMs() const;
+    [[nodiscard]] double getLastFrameMs() const { return m_LastFrameMs; }
+    [[nodiscard]] double getLastFenceWaitMs() const { return m_LastFenceWaitMs; }
+
+    // Fraction of the frame the CPU spent doing useful work instead of waiting on the GPU
+    [[nodiscard]] double getOverlapRatio() const;
+
+    void report(std::ostream& p_Stream, uint32_t p_FramesInFlight) const;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    Clock::time_point m_FrameStart{};
+    Clock::time_point m_WaitStart{};
+
+    uint64_t m_FrameCount = 0;
+    double m_TotalFrameMs = 0.0;
+    double m_TotalFenceWaitMs = 0.0;
+
+    double m_LastFrameMs = 0.0;
+    double m_LastFenceWaitMs = 0.0;
+};
@@ -0,0 +1,77 @@
+#include "input_benchmark.hpp"
+
+#include <chrono>
+#include <iomanip>
+#include <random>
+#include <span>
+#include <vector>
+#include <SDL3/SDL_mouse.h>
+
+#include "sdl_window.hpp"
+#include "camera/arcball_camera.hpp"
+#include "camera/flight_camera.hpp"
+
+static constexpr uint32_t BENCHMARK_FRAMES = 2000;
+
+static void benchmarkConfiguration(const char* p_Name, Camera& p_Camera, const bool p_Coalesce, const std::span<const SDL_Event> p_Events, const uint32_t p_EventsPerFrame, std::ostream& p_Stream)
+{
+    SDLWindow l_Window{};
+    l_Window.setInputCoalescing(p_Coalesce);
+
+    uint64_t l_CameraUpdates = 0;
+    l_Window.getMouseMovedSignal().connect<&Camera::mouseMoved>(&p_Camera);
+    l_Window.getMouseMovedSignal().connect([&l_CameraUpdates](const float, const float) { l_CameraUpdates++; });
+    l_Window.getMouseButtonPressedSignal().connect<&Camera::mouseButtonPressed>(&p_Camera);
+    l_Window.getEventsProcessedSignal().connect<&Camera::updateEvents>(&p_Camera);
+
+    // The arcball only rotates while the left button is held
+    SDL_Event l_Press{};
+    l_Press.type = SDL_EVENT_MOUSE_BUTTON_DOWN;
+    l_Press.button.button = SDL_BUTTON_LEFT;
+    l_Window.processEvent(l_Press);
+    l_Window.finishEvents();
+    l_CameraUpdates = 0;
+
+    // Every frame ends like the event loop's, with the view-projection matrix the render thread gets published
+    glm::mat4 l_Sink{ 0.0f };
+    const std::chrono::steady_clock::time_point l_Start = std::chrono::steady_clock::now();
+    for (uint32_t l_Frame = 0; l_Frame < BENCHMARK_FRAMES; l_Frame++)
+    {
+        for (uint32_t i = 0; i < p_EventsPerFrame; i++)
+            l_Window.processEvent(p_Events[(static_cast<size_t>(l_Frame) * p_EventsPerFrame + i) % p_Events.size()]);
+        l_Window.finishEvents();
+        l_Sink += p_Camera.getVPMatrix();
+    }
+    const double l_Us = std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - l_Start).count() / BENCHMARK_FRAMES;
+
+    p_Stream << std::fixed << std::setprecision(3)
+        << p_Name << (p_Coalesce ? " coalesced" : " per event")
+        << " | " << l_Us << " us/frame"
+        << " | camera updates/frame: " << static_cast<double>(l_CameraUpdates) / BENCHMARK_FRAMES
+        << " | checksum: " << l_Sink[3][3] << "\n";
+}
+
+void runInputBenchmark(const uint32_t p_EventsPerFrame, std::ostream& p_Stream)
+{
+    std::mt19937 l_Rng{ 1234 };
+    std::uniform_real_distribution<float> l_Rel{ -4.0f, 4.0f };
+
+    std::vector<SDL_Event> l_Events(4096);
+    for (SDL_Event& l_Event : l_Events)
+    {
+        l_Event = {};
+        l_Event.type = SDL_EVENT_MOUSE_MOTION;
+        l_Event.motion.xrel = l_Rel(l_Rng);
+        l_Event.motion.yrel = l_Rel(l_Rng);
+    }
+
+    p_Stream << "Input: " << p_EventsPerFrame << " motion events per frame, " << BENCHMARK_FRAMES << " frames\n";
+    for (const bool l_Coalesce : { false, true })
+    {
+        ArcballCamera l_Arcball{ glm::vec3{}, 10.f };
+        benchmarkConfiguration("Arcball", l_Arcball, l_Coalesce, l_Events, p_EventsPerFrame, p_Stream);
+
+        FlightCamera l_Flight{ glm::vec3{ 0.0f, 0.0f, -5.0f }, glm::vec3{ 0.0f, 0.0f, 1.0f }, glm::vec3{ 0.0f, 1.0f, 0.0f } };
+        benchmarkConfiguration("Flight", l_Flight, l_Coalesce, l_Events, p_EventsPerFrame, p_Stream);
+    }
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+
+// Replays p_EventsPerFrame synthetic mouse motion events per frame through the window's event path into each camera,
+// once per event and coalesced, and reports the event processing cost per frame
+void runInputBenchmark(uint32_t p_EventsPerFrame, std::ostream& p_Stream);
@@ -0,0 +1,217 @@
+#include "job_system.hpp"
+
+#include <algorithm>
+
+// Which system and queue the current thread belongs to, threads that weren't started by a system use queue 0
+static thread_local const JobSystem* t_System = nullptr;
+static thread_local uint32_t t_ThreadIndex = 0;
+// Jobs run while waiting inside another job are already part of that job's busy time
+static thread_local bool t_InJob = false;
+
+void JobSystem::init(const uint32_t p_WorkerCount)
+{
+    const uint32_t l_WorkerCount = p_WorkerCount != 0 ? p_WorkerCount : std::max(std::thread::hardware_concurrency(), 2U) - 1;
+
+    m_Queues.resize(l_WorkerCount + 1);
+    for (std::unique_ptr<ThreadQueue>& l_Queue : m_Queues)
+        l_Queue = std::make_unique<ThreadQueue>();
+    t_System = this;
+    t_ThreadIndex = 0;
+    m_LastCollect = std::chrono::steady_clock::now();
+
+    m_Workers.reserve(l_WorkerCount);
+    for (uint32_t i = 1; i <= l_WorkerCount; i++)
+        m_Workers.emplace_back([this, i](const std::stop_token& p_Stop) { workerLoop(i, p_Stop); });
+}
+
+void JobSystem::free()
+{
+    for (std::jthread& l_Worker : m_Workers)
+        l_Worker.request_stop();
+    m_JobQueued.notify_all();
+    m_Workers.clear();
+    m_Queues.clear();
+    if (t_System == this)
+        t_System = nullptr;
+}
+
+void JobSystem::submit(JobFunc p_Job, JobCounter* p_Counter)
+{
+    if (p_Counter != nullptr)
+        p_Counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+    push({ std::move(p_Job), p_Counter });
+}
+
+void JobSystem::submitAfter(JobCounter& p_Dependency, JobFunc p_Job, JobCounter* p_Counter)
+{
+    if (p_Counter != nullptr)
+        p_Counter->m_Value.fetch_add(1, std::memory_order_relaxed);
+
+    // The lock orders this against the job that brings the dependency to zero, so the continuation is either
+    // queued here or picked up by that job, never lost in between
+    {
+        std::scoped_lock l_Lock{ p_Dependency.m_Mutex };
+        if (!p_Dependency.isDone())
+        {
+            p_Dependency.m_Continuations.push_back({ std::move(p_Job), p_Counter });
+            return;
+        }
+    }
+    push({ std::move(p_Job), p_Counter });
+}
+
+void JobSystem::wait(const JobCounter& p_Counter)
+{
+    const uint32_t l_ThreadIndex = getCurrentThreadIndex();
+    while (!p_Counter.isDone())
+    {
+        if (!tryRunOne(l_ThreadIndex))
+            std::this_thread::yield();
+    }
+
+    // The last job still holds the counter's lock while it collects continuations, the counter can only go away after
+    std::scoped_lock l_Lock{ p_Counter.m_Mutex };
+}
+
+void JobSystem::parallelFor(const uint32_t p_Count, const uint32_t p_Grain, const std::function<void(uint32_t, uint32_t)>& p_Func)
+{
+    if (p_Count == 0)
+        return;
+
+    const uint32_t l_Grain = std::max(p_Grain, 1U);
+    JobCounter l_Counter{};
+    for (uint32_t l_Begin = l_Grain; l_Begin < p_Count; l_Begin += l_Grain)
+    {
+        const uint32_t l_End = std::min(p_Count, l_Begin + l_Grain);
+        submit([&p_Func, l_Begin, l_End] { p_Func(l_Begin, l_End); }, &l_Counter);
+    }
+
+    const bool l_Outermost = !t_InJob;
+    t_InJob = true;
+    const auto l_Start = std::chrono::steady_clock::now();
+    p_Func(0, std::min(p_Count, l_Grain));
+    const std::chrono::nanoseconds l_Elapsed = std::chrono::steady_clock::now() - l_Start;
+    t_InJob = !l_Outermost;
+    if (l_Outermost)
+        m_Queues[getCurrentThreadIndex()]->busyNs.fetch_add(l_Elapsed.count(), std::memory_order_relaxed);
+
+    wait(l_Counter);
+}
+
+void JobSystem::collectUtilization(std::vector<float>& p_Utilization)
+{
+    const auto l_Now = std::chrono::steady_clock::now();
+    const std::chrono::nanoseconds l_Wall = l_Now - m_LastCollect;
+    m_LastCollect = l_Now;
+
+    p_Utilization.resize(m_Queues.size());
+    for (uint32_t i = 0; i < m_Queues.size(); i++)
+    {
+        const uint64_t l_Busy = m_Queues[i]->busyNs.load(std::memory_order_relaxed);
+        const uint64_t l_Delta = l_Busy - m_Queues[i]->collectedBusyNs;
+        m_Queues[i]->collectedBusyNs = l_Busy;
+        p_Utilization[i] = l_Wall.count() > 0 ? std::min(1.0f, static_cast<float>(static_cast<double>(l_Delta) / static_cast<double>(l_Wall.count()))) : 0.0f;
+    }
+}
+
+void JobSystem::push(Job p_Job)
+{
+    // Counted before it becomes visible so a thief can never take the count below zero. The sleep lock closes the
+    // window between a worker checking the count and going to sleep
+    {
+        std::scoped_lock l_Lock{ m_SleepMutex };
+        m_QueuedJobs.fetch_add(1, std::memory_order_release);
+    }
+    ThreadQueue& l_Queue = *m_Queues[getCurrentThreadIndex()];
+    {
+        std::scoped_lock l_Lock{ l_Queue.mutex };
+        l_Queue.jobs.push_back(std::move(p_Job));
+    }
+    m_JobQueued.notify_one();
+}
+
+bool JobSystem::tryRunOne(const uint32_t p_ThreadIndex)
+{
+    Job l_Job{};
+    bool l_Found = false;
+    {
+        // Newest first from our own queue, it is the most likely to still be in cache
+        ThreadQueue& l_Own = *m_Queues[p_ThreadIndex];
+        std::scoped_lock l_Lock{ l_Own.mutex };
+        if (!l_Own.jobs.empty())
+        {
+            l_Job = std::move(l_Own.jobs.back());
+            l_Own.jobs.pop_back();
+            l_Found = true;
+        }
+    }
+
+    // Oldest first from the others, older jobs tend to be the bigger chunks of work
+    const uint32_t l_QueueCount = static_cast<uint32_t>(m_Queues.size());
+    for (uint32_t i = 1; i < l_QueueCount && !l_Found; i++)
+    {
+        ThreadQueue& l_Victim = *m_Queues[(p_ThreadIndex + i) % l_QueueCount];
+        std::scoped_lock l_Lock{ l_Victim.mutex };
+        if (!l_Victim.jobs.empty())
+        {
+            l_Job = std::move(l_Victim.jobs.front());
+            l_Victim.jobs.pop_front();
+            l_Found = true;
+        }
+    }
+
+    if (!l_Found)
+        return false;
+    m_QueuedJobs.fetch_sub(1, std::memory_order_relaxed);
+    execute(p_ThreadIndex, l_Job);
+    return true;
+}
+
+void JobSystem::execute(const uint32_t p_ThreadIndex, Job& p_Job)
+{
+    const bool l_Outermost = !t_InJob;
+    t_InJob = true;
+    const auto l_Start = std::chrono::steady_clock::now();
+    p_Job.func();
+    const std::chrono::nanoseconds l_Elapsed = std::chrono::steady_clock::now() - l_Start;
+    t_InJob = !l_Outermost;
+    if (l_Outermost)
+        m_Queues[p_ThreadIndex]->busyNs.fetch_add(l_Elapsed.count(), std::memory_order_relaxed);
+    finish(p_Job.counter);
+}
+
+void JobSystem::finish(JobCounter* p_Counter)
+{
+    if (p_Counter == nullptr)
+        return;
+
+    std::vector<JobCounter::Continuation> l_Ready{};
+    {
+        std::scoped_lock l_Lock{ p_Counter->m_Mutex };
+        if (p_Counter->m_Value.fetch_sub(1, std::memory_order_acq_rel) != 1)
+            return;
+        l_Ready.swap(p_Counter->m_Continuations);
+    }
+    // The waiter may destroy the counter from here on, only the moved out continuations are touched
+    for (JobCounter::Continuation& l_Continuation : l_Ready)
+        push({ std::move(l_Continuation.func), l_Continuation.counter });
+}
+
+void JobSystem::workerLoop(const uint32_t p_ThreadIndex, const std::stop_token& p_Stop)
+{
+    t_System = this;
+    t_ThreadIndex = p_ThreadIndex;
+    while (!p_Stop.stop_requested())
+    {
+        if (tryRunOne(p_ThreadIndex))
+            continue;
+
+        std::unique_lock l_Lock{ m_SleepMutex };
+        m_JobQueued.wait(l_Lock, p_Stop, [this] { return m_QueuedJobs.load(std::memory_order_acquire) > 0; });
+    }
+}
+
+uint32_t JobSystem::getCurrentThreadIndex() const
+{
+    return t_System == this ? t_ThreadIndex : 0;
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+using JobFunc = std::function<void()>;
+
+// Counts the unfinished jobs submitted with it. Jobs submitted after a counter start once it drops back to zero
+class JobCounter
+{
+public:
+    [[nodiscard]] bool isDone() const { return m_Value.load(std::memory_order_acquire) == 0; }
+
+private:
+    struct Continuation
+    {
+        JobFunc func;
+        JobCounter* counter;
+    };
+
+    std::atomic<uint32_t> m_Value{ 0 };
+    mutable std::mutex m_Mutex;
+    std::vector<Continuation> m_Continuations{};
+
+    friend class JobSystem;
+};
+
+// Every thread owns a deque, it pushes and pops at the back while idle threads steal from the front of the others.
+// Threads the system didn't start, like the one that called init or the render thread, share thread 0's deque and take
+// part whenever they wait. Jobs must not throw
+class JobSystem
+{
+public:
+    // 0 starts one worker per hardware thread but the calling one
+    void init(uint32_t p_WorkerCount = 0);
+    void free();
+
+    void submit(JobFunc p_Job, JobCounter* p_Counter = nullptr);
+    void submitAfter(JobCounter& p_Dependency, JobFunc p_Job, JobCounter* p_Counter = nullptr);
+
+    // Runs other jobs until the counter reaches zero, so waiting never leaves a thread idle
+    void wait(const JobCounter& p_Counter);
+
+    // Calls p_Func(begin, end) over [0, p_Count) in batches of at most p_Grain and waits for all of them.
+    // The first batch runs on the calling thread
+    void parallelFor(uint32_t p_Count, uint32_t p_Grain, const std::function<void(uint32_t, uint32_t)>& p_Func);
+
+    // Including the thread that called init
+    [[nodiscard]] uint32_t getThreadCount() const { return static_cast<uint32_t>(m_Queues.size()); }
+
+    // Fraction of the wall time each thread spent running jobs since the previous call, thread 0 first
+    void collectUtilization(std::vector<float>& p_Utilization);
+
+private:
+    struct Job
+    {
+        JobFunc func;
+        JobCounter* counter;
+    };
+
+    struct ThreadQueue
+    {
+        std::mutex mutex;
+        std::deque<Job> jobs{};
+        std::atomic<uint64_t> busyNs{ 0 };
+        uint64_t collectedBusyNs = 0;
+    };
+
+    void push(Job p_Job);
+    [[nodiscard]] bool tryRunOne(uint32_t p_ThreadIndex);
+    void execute(uint32_t p_ThreadIndex, Job& p_Job);
+    void finish(JobCounter* p_Counter);
+    void workerLoop(uint32_t p_ThreadIndex, const std::stop_token& p_Stop);
+    [[nodiscard]] uint32_t getCurrentThreadIndex() const;
+
+    std::vector<std::unique_ptr<ThreadQueue>> m_Queues{};
+    std::vector<std::jthread> m_Workers{};
+
+    std::atomic<uint32_t> m_QueuedJobs{ 0 };
+    std::mutex m_SleepMutex;
+    std::condition_variable_any m_JobQueued;
+
+    std::chrono::steady_clock::time_point m_LastCollect{};
+};
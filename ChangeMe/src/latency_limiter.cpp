@@ -0,0 +1,27 @@
+#include "latency_limiter.hpp"
+
+#include <algorithm>
+#include <thread>
+
+void LatencyLimiter::sleep()
+{
+    if (m_SleepMs <= 0.0)
+        return;
+
+    using Clock = std::chrono::steady_clock;
+    const Clock::time_point l_Deadline = Clock::now() + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double, std::milli>(m_SleepMs));
+    if (l_Deadline - Clock::now() > SPIN_MARGIN)
+        std::this_thread::sleep_until(l_Deadline - SPIN_MARGIN);
+    while (Clock::now() < l_Deadline)
+        std::this_thread::yield();
+}
+
+void LatencyLimiter::endFrame(const double p_BlockedMs, const bool p_Enabled)
+{
+    if (!p_Enabled)
+    {
+        m_SleepMs = 0.0;
+        return;
+    }
+    m_SleepMs = std::clamp(m_SleepMs + GAIN * (p_BlockedMs - TARGET_BLOCKED_MS), 0.0, MAX_SLEEP_MS);
+}
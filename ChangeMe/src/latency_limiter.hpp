@@ -0,0 +1,25 @@
+#pragma once
+
+#include <chrono>
+
+// Moves the time the render thread would spend blocked on the GPU or the swapchain to a sleep before the frame starts,
+// so input is sampled as late as possible. The sleep is steered until the remaining blocked time settles on a small margin
+class LatencyLimiter
+{
+public:
+    // Call right before the frame fence wait and acquire
+    void sleep();
+    // Time the frame spent blocked in the fence wait and acquire, p_Enabled turns the sleep on or off from the next frame
+    void endFrame(double p_BlockedMs, bool p_Enabled);
+
+    [[nodiscard]] double getSleepMs() const { return m_SleepMs; }
+
+private:
+    static constexpr double TARGET_BLOCKED_MS = 0.5;
+    static constexpr double GAIN = 0.25;
+    static constexpr double MAX_SLEEP_MS = 50.0;
+    // OS sleeps overshoot, the last stretch is spun
+    static constexpr std::chrono::microseconds SPIN_MARGIN{ 1000 };
+
+    double m_SleepMs = 0.0;
+};
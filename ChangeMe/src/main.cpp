@@ -1,7 +1,242 @@
 #include "engine.hpp"
+#include "culling/culling_benchmark.hpp"
+#include "events/signal_benchmark.hpp"
+#include "input_benchmark.hpp"
+#include "mesh/mesh_optimizer.hpp"
+#include "mesh/obj_importer.hpp"
 
-int main(int argc, char* argv[])
+#include <charconv>
+#include <cstring>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+static VkPresentModeKHR parsePresentMode(const std::string_view p_Name)
+{
+    if (p_Name == "fifo")
+        return VK_PRESENT_MODE_FIFO_KHR;
+    if (p_Name == "fifo-relaxed")
+        return VK_PRESENT_MODE_FIFO_RELAXED_KHR;
+    if (p_Name == "mailbox")
+        return VK_PRESENT_MODE_MAILBOX_KHR;
+    if (p_Name == "immediate")
+        return VK_PRESENT_MODE_IMMEDIATE_KHR;
+    throw std::invalid_argument("Unknown present mode " + std::string{ p_Name } + ", expected fifo, fifo-relaxed, mailbox or immediate");
+}
+
+static constexpr const char* USAGE =
+    "Usage: ChangeMe [--headless] [--width <pixels>] [--height <pixels>] [--readback <path>] [--trace <path>]\n"
+    "                [--frames-in-flight <count>] [--benchmark-frames <count>] [--benchmark-seconds <seconds>]\n"
+    "                [--upload-chunk-kb <kb>] [--upload-chunks <count>] [--frame-arena-kb <kb>]\n"
+    "                [--texture <path>]... [--texture-budget-mb <mb>] [--mesh <path>] [--gpu-culling]\n"
+    "                [--instances <count>] [--stress-draws <count>] [--record-threads <count>] [--job-threads <count>]\n"
+    "                [--raw-mouse] [--present-mode <fifo|fifo-relaxed|mailbox|immediate>] [--max-queued-frames <count>]\n"
+    "                [--latency-sleep]\n"
+    "       ChangeMe --convert-mesh <source.obj|source.mesh> <destination.mesh> <full|quantized> [--optimize]\n"
+    "       ChangeMe --cull-benchmark <count> | --signal-benchmark <count> | --input-benchmark <count>";
+
+// std::stoul accepts trailing garbage and negative numbers and reports nothing useful, so numbers are parsed strictly
+static uint64_t parseUnsigned(const std::string_view p_Flag, const std::string_view p_Value)
+{
+    uint64_t l_Value = 0;
+    const auto [l_End, l_Error] = std::from_chars(p_Value.data(), p_Value.data() + p_Value.size(), l_Value);
+    if (p_Value.empty() || l_Error != std::errc{} || l_End != p_Value.data() + p_Value.size())
+        throw std::invalid_argument(std::string{ p_Flag } + " expects a whole number, got \"" + std::string{ p_Value } + "\"");
+    return l_Value;
+}
+
+static uint32_t parseCount(const std::string_view p_Flag, const std::string_view p_Value)
+{
+    const uint64_t l_Value = parseUnsigned(p_Flag, p_Value);
+    if (l_Value > UINT32_MAX)
+        throw std::invalid_argument(std::string{ p_Flag } + " is out of range");
+    return static_cast<uint32_t>(l_Value);
+}
+
+static uint64_t parseSize(const std::string_view p_Flag, const std::string_view p_Value, const uint64_t p_Unit)
+{
+    const uint64_t l_Value = parseUnsigned(p_Flag, p_Value);
+    if (l_Value > UINT64_MAX / p_Unit)
+        throw std::invalid_argument(std::string{ p_Flag } + " is out of range");
+    return l_Value * p_Unit;
+}
+
+static float parseSeconds(const std::string_view p_Flag, const std::string_view p_Value)
+{
+    float l_Value = 0.0f;
+    const auto [l_End, l_Error] = std::from_chars(p_Value.data(), p_Value.data() + p_Value.size(), l_Value);
+    if (p_Value.empty() || l_Error != std::errc{} || l_End != p_Value.data() + p_Value.size() || !(l_Value >= 0.0f))
+        throw std::invalid_argument(std::string{ p_Flag } + " expects a non negative number, got \"" + std::string{ p_Value } + "\"");
+    return l_Value;
+}
+
+// Throws std::invalid_argument on unknown flags, missing values and malformed numbers, main prints the usage for those
+static EngineConfig parseArguments(const int argc, char* argv[])
+{
+    EngineConfig l_Config{};
+    for (int i = 1; i < argc; i++)
+    {
+        const std::string_view l_Flag = argv[i];
+        const auto l_Value = [&]() -> std::string_view
+        {
+            if (i + 1 >= argc)
+                throw std::invalid_argument(std::string{ l_Flag } + " expects a value");
+            return argv[++i];
+        };
+
+        if (l_Flag == "--frames-in-flight")
+            l_Config.framesInFlight = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--benchmark-frames")
+            l_Config.benchmarkFrames = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--benchmark-seconds")
+            l_Config.benchmarkSeconds = parseSeconds(l_Flag, l_Value());
+        else if (l_Flag == "--headless")
+            l_Config.headless = true;
+        else if (l_Flag == "--width")
+            l_Config.headlessExtent.width = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--height")
+            l_Config.headlessExtent.height = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--readback")
+            l_Config.readbackPath = l_Value();
+        else if (l_Flag == "--trace")
+            l_Config.tracePath = l_Value();
+        else if (l_Flag == "--upload-chunk-kb")
+            l_Config.uploadChunkSize = parseSize(l_Flag, l_Value(), 1024);
+        else if (l_Flag == "--upload-chunks")
+            l_Config.uploadChunkCount = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--frame-arena-kb")
+            l_Config.frameArenaSize = parseSize(l_Flag, l_Value(), 1024);
+        else if (l_Flag == "--texture")
+            l_Config.texturePaths.emplace_back(l_Value());
+        else if (l_Flag == "--texture-budget-mb")
+            l_Config.textureBudget = parseSize(l_Flag, l_Value(), 1024 * 1024);
+        else if (l_Flag == "--mesh")
+            l_Config.meshPath = l_Value();
+        else if (l_Flag == "--gpu-culling")
+            l_Config.gpuCulling = true;
+        else if (l_Flag == "--instances")
+            l_Config.instanceCount = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--stress-draws")
+        {
+            l_Config.instanceCount = parseCount(l_Flag, l_Value());
+            l_Config.drawPerInstance = true;
+        }
+        else if (l_Flag == "--record-threads")
+            l_Config.recordThreads = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--job-threads")
+            l_Config.jobThreads = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--raw-mouse")
+            l_Config.rawMouseInput = true;
+        else if (l_Flag == "--present-mode")
+            l_Config.presentMode = parsePresentMode(l_Value());
+        else if (l_Flag == "--max-queued-frames")
+            l_Config.maxQueuedFrames = parseCount(l_Flag, l_Value());
+        else if (l_Flag == "--latency-sleep")
+            l_Config.latencySleep = true;
+        else
+            throw std::invalid_argument("Unknown argument " + std::string{ l_Flag });
+    }
+    return l_Config;
+}
+
+// Reads a full precision mesh file back into the form MeshFile::write takes
+static ImportedMesh readMeshFile(const std::string_view p_Path)
+{
+    const MeshFile l_Source{ p_Path };
+    if (l_Source.getHeader().vertexFormat != VertexFormat::FULL)
+        throw std::runtime_error("Only full precision meshes can be converted");
+
+    ImportedMesh l_Mesh{};
+    const std::span<const uint8_t> l_VertexData = l_Source.getVertexData();
+    const Vertex* l_FirstVertex = reinterpret_cast<const Vertex*>(l_VertexData.data());
+    l_Mesh.vertices.assign(l_FirstVertex, l_FirstVertex + l_VertexData.size() / sizeof(Vertex));
+    l_Mesh.submeshes.assign(l_Source.getSubmeshes().begin(), l_Source.getSubmeshes().end());
+
+    l_Mesh.indices.resize(l_Source.getHeader().indexCount);
+    const std::span<const uint8_t> l_IndexData = l_Source.getIndexData();
+    for (size_t i = 0; i < l_Mesh.indices.size(); i++)
+    {
+        if (l_Source.getHeader().indexSize == sizeof(uint16_t))
+            l_Mesh.indices[i] = reinterpret_cast<const uint16_t*>(l_IndexData.data())[i];
+        else
+            l_Mesh.indices[i] = reinterpret_cast<const uint32_t*>(l_IndexData.data())[i];
+    }
+    return l_Mesh;
+}
+
+// Imports an OBJ file, or re-encodes a full precision mesh file, with the given vertex format. This is the import step
+// where the format is picked and where the optional cache/overdraw/fetch optimization runs
+static void convertMesh(const std::string_view p_Source, const std::string_view p_Destination, const std::string_view p_Format, const bool p_Optimize)
 {
-    Engine l_Engine{};
+    const bool l_IsObj = p_Source.size() >= 4 && p_Source.substr(p_Source.size() - 4) == ".obj";
+    ImportedMesh l_Mesh = l_IsObj ? importObj(p_Source) : readMeshFile(p_Source);
+    std::vector<Vertex>& l_Vertices = l_Mesh.vertices;
+    std::vector<uint32_t>& l_Indices = l_Mesh.indices;
+    std::vector<MeshSubmesh>& l_Submeshes = l_Mesh.submeshes;
+
+    if (p_Format != "full" && p_Format != "quantized")
+        throw std::invalid_argument("Unknown vertex format " + std::string{ p_Format } + ", expected full or quantized");
+    const VertexFormat l_Format = p_Format == "quantized" ? VertexFormat::QUANTIZED : VertexFormat::FULL;
+
+    if (p_Optimize)
+    {
+        const MeshOptimizeSettings l_Settings{};
+        const VertexCacheStats l_Before = analyzeVertexCache(l_Indices, l_Submeshes, l_Settings.cacheSize);
+        optimizeMesh(l_Vertices, l_Indices, l_Submeshes, l_Settings);
+        const VertexCacheStats l_After = analyzeVertexCache(l_Indices, l_Submeshes, l_Settings.cacheSize);
+        std::cout << "ACMR " << l_Before.acmr << " -> " << l_After.acmr << " | ATVR " << l_Before.atvr << " -> " << l_After.atvr
+            << " (FIFO " << l_Settings.cacheSize << ")\n";
+    }
+
+    MeshFile::write(p_Destination, l_Vertices, l_Indices, l_Submeshes, l_Format);
+    std::cout << "Wrote " << p_Destination << " (" << p_Format << ")\n";
+}
+
+static int runCommand(const int argc, char* argv[])
+{
+    if (argc >= 2 && std::strcmp(argv[1], "--convert-mesh") == 0)
+    {
+        if (argc < 5 || argc > 6 || (argc == 6 && std::strcmp(argv[5], "--optimize") != 0))
+            throw std::invalid_argument("--convert-mesh expects <source> <destination> <format> [--optimize]");
+        convertMesh(argv[2], argv[3], argv[4], argc == 6);
+        return 0;
+    }
+    if (argc == 3 && std::strcmp(argv[1], "--cull-benchmark") == 0)
+    {
+        runCullingBenchmark(parseCount(argv[1], argv[2]), std::cout);
+        return 0;
+    }
+    if (argc == 3 && std::strcmp(argv[1], "--signal-benchmark") == 0)
+    {
+        runSignalBenchmark(parseCount(argv[1], argv[2]), std::cout);
+        return 0;
+    }
+    if (argc == 3 && std::strcmp(argv[1], "--input-benchmark") == 0)
+    {
+        runInputBenchmark(parseCount(argv[1], argv[2]), std::cout);
+        return 0;
+    }
+
+    Engine l_Engine{parseArguments(argc, argv)};
     l_Engine.run();
+    return 0;
+}
+
+int main(int argc, char* argv[])
+{
+    // Argument errors are reported together with the usage, everything else that escapes is reported as is
+    try
+    {
+        return runCommand(argc, argv);
+    }
+    catch (const std::invalid_argument& e)
+    {
+        std::cerr << e.what() << "\n" << USAGE << "\n";
+    }
+    catch (const std::exception& e)
+    {
+        std::cerr << e.what() << "\n";
+    }
+    return 1;
 }
@@ -0,0 +1,114 @@
+#include "mapped_file.hpp"
+
+#include <stdexcept>
+#include <string>
+#include <utility>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+MappedFile::MappedFile(const std::string_view p_Path)
+{
+    const std::string l_Path{ p_Path };
+#ifdef _WIN32
+    m_File = CreateFileA(l_Path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (m_File == INVALID_HANDLE_VALUE)
+    {
+        m_File = nullptr;
+        throw std::runtime_error("Could not open " + l_Path);
+    }
+
+    LARGE_INTEGER l_Size{};
+    GetFileSizeEx(m_File, &l_Size);
+    m_Size = static_cast<size_t>(l_Size.QuadPart);
+    if (m_Size == 0)
+    {
+        close();
+        throw std::runtime_error("Empty file " + l_Path);
+    }
+
+    m_Mapping = CreateFileMappingA(m_File, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    if (m_Mapping != nullptr)
+        m_Data = static_cast<const uint8_t*>(MapViewOfFile(m_Mapping, FILE_MAP_READ, 0, 0, 0));
+#else
+    const int l_File = open(l_Path.c_str(), O_RDONLY);
+    if (l_File < 0)
+        throw std::runtime_error("Could not open " + l_Path);
+
+    struct stat l_Stat{};
+    fstat(l_File, &l_Stat);
+    m_Size = static_cast<size_t>(l_Stat.st_size);
+    if (m_Size == 0)
+    {
+        ::close(l_File);
+        throw std::runtime_error("Empty file " + l_Path);
+    }
+
+    // The mapping keeps its own reference to the file, the descriptor is not needed past this point
+    void* l_Data = mmap(nullptr, m_Size, PROT_READ, MAP_PRIVATE, l_File, 0);
+    ::close(l_File);
+    if (l_Data != MAP_FAILED)
+    {
+        m_Data = static_cast<const uint8_t*>(l_Data);
+        madvise(l_Data, m_Size, MADV_SEQUENTIAL);
+    }
+#endif
+
+    if (m_Data == nullptr)
+    {
+        close();
+        throw std::runtime_error("Could not map " + l_Path);
+    }
+}
+
+MappedFile::~MappedFile()
+{
+    close();
+}
+
+MappedFile::MappedFile(MappedFile&& p_Other) noexcept
+{
+    *this = std::move(p_Other);
+}
+
+MappedFile& MappedFile::operator=(MappedFile&& p_Other) noexcept
+{
+    if (this == &p_Other)
+        return *this;
+
+    close();
+    m_Data = std::exchange(p_Other.m_Data, nullptr);
+    m_Size = std::exchange(p_Other.m_Size, 0);
+#ifdef _WIN32
+    m_File = std::exchange(p_Other.m_File, nullptr);
+    m_Mapping = std::exchange(p_Other.m_Mapping, nullptr);
+#endif
+    return *this;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+    if (m_Data != nullptr)
+        UnmapViewOfFile(m_Data);
+    if (m_Mapping != nullptr)
+        CloseHandle(m_Mapping);
+    if (m_File != nullptr)
+        CloseHandle(m_File);
+    m_Mapping = nullptr;
+    m_File = nullptr;
+#else
+    if (m_Data != nullptr)
+        munmap(const_cast<uint8_t*>(m_Data), m_Size);
+#endif
+    m_Data = nullptr;
+    m_Size = 0;
+}
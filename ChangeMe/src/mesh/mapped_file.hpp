@@ -0,0 +1,33 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Read only view of a whole file through the OS page cache, pages are only faulted in once they are touched
+class MappedFile
+{
+public:
+    MappedFile() = default;
+    explicit MappedFile(std::string_view p_Path);
+    ~MappedFile();
+
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+    MappedFile(MappedFile&& p_Other) noexcept;
+    MappedFile& operator=(MappedFile&& p_Other) noexcept;
+
+    void close();
+
+    [[nodiscard]] const uint8_t* getData() const { return m_Data; }
+    [[nodiscard]] size_t getSize() const { return m_Size; }
+    [[nodiscard]] bool isOpen() const { return m_Data != nullptr; }
+
+private:
+    const uint8_t* m_Data = nullptr;
+    size_t m_Size = 0;
+#ifdef _WIN32
+    void* m_File = nullptr;
+    void* m_Mapping = nullptr;
+#endif
+};
@@ -0,0 +1,179 @@
+#include "mesh_file.hpp"
+
+#include <algorithm>
+#include <cfloat>
+#include <cstddef>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#include "mesh/vertex_quantization.hpp"
+
+static uint64_t alignUp(const uint64_t p_Value, const uint64_t p_Alignment)
+{
+    return (p_Value + p_Alignment - 1) / p_Alignment * p_Alignment;
+}
+
+static constexpr MeshBounds EMPTY_BOUNDS = { { FLT_MAX, FLT_MAX, FLT_MAX }, { -FLT_MAX, -FLT_MAX, -FLT_MAX } };
+
+static void growBounds(MeshBounds& p_Bounds, const glm::vec3& p_Position)
+{
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        p_Bounds.min[i] = std::min(p_Bounds.min[i], p_Position[i]);
+        p_Bounds.max[i] = std::max(p_Bounds.max[i], p_Position[i]);
+    }
+}
+
+static bool matchesLayout(const MeshFileHeader& p_Header)
+{
+    switch (p_Header.vertexFormat)
+    {
+    case VertexFormat::FULL:
+        return p_Header.vertexStride == sizeof(Vertex) && p_Header.positionOffset == offsetof(Vertex, position) &&
+            p_Header.normalOffset == offsetof(Vertex, normal) && p_Header.colorOffset == offsetof(Vertex, color);
+    case VertexFormat::QUANTIZED:
+        return p_Header.vertexStride == sizeof(QuantizedVertex) && p_Header.positionOffset == offsetof(QuantizedVertex, position) &&
+            p_Header.normalOffset == offsetof(QuantizedVertex, normal) && p_Header.colorOffset == offsetof(QuantizedVertex, color);
+    }
+    return false;
+}
+
+MeshFile::MeshFile(const std::string_view p_Path)
+    : m_File(p_Path)
+{
+    const std::string l_Path{ p_Path };
+    const uint8_t* l_Data = m_File.getData();
+    const uint64_t l_Size = m_File.getSize();
+
+    if (l_Size < sizeof(MeshFileHeader))
+        throw std::runtime_error(l_Path + " is too small to be a mesh file");
+
+    m_Header = reinterpret_cast<const MeshFileHeader*>(l_Data);
+    if (m_Header->magic != MESH_FILE_MAGIC)
+        throw std::runtime_error(l_Path + " is not a mesh file");
+    if (m_Header->version != MESH_FILE_VERSION)
+        throw std::runtime_error(l_Path + " has mesh version " + std::to_string(m_Header->version) + ", expected " + std::to_string(MESH_FILE_VERSION));
+    if (!matchesLayout(*m_Header))
+        throw std::runtime_error(l_Path + " was written with a different vertex layout");
+    if (m_Header->indexSize != sizeof(uint16_t) && m_Header->indexSize != sizeof(uint32_t))
+        throw std::runtime_error(l_Path + " has an unsupported index size");
+
+    if (m_Header->submeshCount == 0)
+        throw std::runtime_error(l_Path + " has no submeshes");
+
+    // Every range is checked against the file size before any of it is exposed. Counts are checked before they are
+    // multiplied, so a huge count can't wrap its byte size around to something that fits
+    const auto l_Fits = [l_Size](const uint64_t p_Offset, const uint64_t p_Count, const uint64_t p_Stride)
+    {
+        return p_Offset <= l_Size && p_Count <= (l_Size - p_Offset) / p_Stride;
+    };
+    if (!l_Fits(m_Header->submeshTableOffset, m_Header->submeshCount, sizeof(MeshSubmesh)) || !l_Fits(m_Header->vertexDataOffset, m_Header->vertexCount, m_Header->vertexStride) ||
+        !l_Fits(m_Header->indexDataOffset, m_Header->indexCount, m_Header->indexSize))
+        throw std::runtime_error(l_Path + " is truncated");
+    const uint64_t l_VertexBytes = m_Header->vertexCount * m_Header->vertexStride;
+    const uint64_t l_IndexBytes = m_Header->indexCount * m_Header->indexSize;
+    if (m_Header->submeshTableOffset % alignof(MeshSubmesh) != 0 || m_Header->vertexDataOffset % MESH_BLOB_ALIGNMENT != 0 || m_Header->indexDataOffset % MESH_BLOB_ALIGNMENT != 0)
+        throw std::runtime_error(l_Path + " has misaligned data blocks");
+
+    m_Submeshes = { reinterpret_cast<const MeshSubmesh*>(l_Data + m_Header->submeshTableOffset), m_Header->submeshCount };
+    m_VertexData = { l_Data + m_Header->vertexDataOffset, static_cast<size_t>(l_VertexBytes) };
+    m_IndexData = { l_Data + m_Header->indexDataOffset, static_cast<size_t>(l_IndexBytes) };
+
+    for (const MeshSubmesh& l_Submesh : m_Submeshes)
+    {
+        if (static_cast<uint64_t>(l_Submesh.firstIndex) + l_Submesh.indexCount > m_Header->indexCount)
+            throw std::runtime_error(l_Path + " has a submesh outside of its index data");
+    }
+}
+
+void MeshFile::write(const std::string_view p_Path, const std::span<const Vertex> p_Vertices, const std::span<const uint32_t> p_Indices, const std::span<const MeshSubmesh> p_Submeshes, const VertexFormat p_Format)
+{
+    const std::string l_Path{ p_Path };
+    std::ofstream l_File{ l_Path, std::ios::binary };
+    if (!l_File.is_open())
+        throw std::runtime_error("Could not open " + l_Path + " for writing");
+
+    MeshFileHeader l_Header{};
+    l_Header.magic = MESH_FILE_MAGIC;
+    l_Header.version = MESH_FILE_VERSION;
+
+    // 16 bit indices halve the index fetch whenever every submesh fits, indices are relative to the submesh vertex offset
+    const bool l_NarrowIndices = std::ranges::all_of(p_Indices, [](const uint32_t p_Index) { return p_Index <= UINT16_MAX; });
+    std::vector<uint16_t> l_NarrowedIndices{};
+    std::span<const uint8_t> l_IndexBytes{ reinterpret_cast<const uint8_t*>(p_Indices.data()), p_Indices.size_bytes() };
+    if (l_NarrowIndices)
+    {
+        l_NarrowedIndices.assign(p_Indices.begin(), p_Indices.end());
+        l_IndexBytes = { reinterpret_cast<const uint8_t*>(l_NarrowedIndices.data()), l_NarrowedIndices.size() * sizeof(uint16_t) };
+    }
+    l_Header.indexSize = l_NarrowIndices ? sizeof(uint16_t) : sizeof(uint32_t);
+    l_Header.submeshCount = static_cast<uint32_t>(p_Submeshes.size());
+    l_Header.vertexCount = p_Vertices.size();
+    l_Header.indexCount = p_Indices.size();
+    l_Header.submeshTableOffset = sizeof(MeshFileHeader);
+    l_Header.vertexDataOffset = alignUp(l_Header.submeshTableOffset + p_Submeshes.size_bytes(), MESH_BLOB_ALIGNMENT);
+
+    l_Header.bounds = EMPTY_BOUNDS;
+    for (const Vertex& l_Vertex : p_Vertices)
+        growBounds(l_Header.bounds, l_Vertex.position);
+
+    // Submesh bounds are always recomputed from the full precision positions, they are what culling tests against
+    std::vector<MeshSubmesh> l_Submeshes{ p_Submeshes.begin(), p_Submeshes.end() };
+    for (MeshSubmesh& l_Submesh : l_Submeshes)
+    {
+        l_Submesh.bounds = EMPTY_BOUNDS;
+        for (uint32_t i = 0; i < l_Submesh.indexCount; i++)
+            growBounds(l_Submesh.bounds, p_Vertices[p_Indices[l_Submesh.firstIndex + i] + l_Submesh.vertexOffset].position);
+    }
+
+    std::vector<QuantizedVertex> l_Quantized{};
+    std::span<const uint8_t> l_VertexBytes{ reinterpret_cast<const uint8_t*>(p_Vertices.data()), p_Vertices.size_bytes() };
+    l_Header.vertexFormat = p_Format;
+    if (p_Format == VertexFormat::QUANTIZED)
+    {
+        l_Quantized.reserve(p_Vertices.size());
+        for (const Vertex& l_Vertex : p_Vertices)
+            l_Quantized.push_back(quantizeVertex(l_Vertex, l_Header.bounds));
+        l_VertexBytes = { reinterpret_cast<const uint8_t*>(l_Quantized.data()), l_Quantized.size() * sizeof(QuantizedVertex) };
+
+        l_Header.vertexStride = sizeof(QuantizedVertex);
+        l_Header.positionOffset = offsetof(QuantizedVertex, position);
+        l_Header.normalOffset = offsetof(QuantizedVertex, normal);
+        l_Header.colorOffset = offsetof(QuantizedVertex, color);
+        const glm::vec3 l_Scale = getDequantizeScale(l_Header.bounds);
+        const glm::vec3 l_Offset = getDequantizeOffset(l_Header.bounds);
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            l_Header.dequantizeScale[i] = l_Scale[i];
+            l_Header.dequantizeOffset[i] = l_Offset[i];
+        }
+    }
+    else
+    {
+        l_Header.vertexStride = sizeof(Vertex);
+        l_Header.positionOffset = offsetof(Vertex, position);
+        l_Header.normalOffset = offsetof(Vertex, normal);
+        l_Header.colorOffset = offsetof(Vertex, color);
+        for (uint32_t i = 0; i < 3; i++)
+        {
+            l_Header.dequantizeScale[i] = 1.0f;
+            l_Header.dequantizeOffset[i] = 0.0f;
+        }
+    }
+    l_Header.indexDataOffset = alignUp(l_Header.vertexDataOffset + l_VertexBytes.size(), MESH_BLOB_ALIGNMENT);
+
+    const auto l_Pad = [&l_File](const uint64_t p_Offset)
+    {
+        static constexpr char l_Zeros[MESH_BLOB_ALIGNMENT]{};
+        l_File.write(l_Zeros, static_cast<std::streamsize>(p_Offset - static_cast<uint64_t>(l_File.tellp())));
+    };
+
+    l_File.write(reinterpret_cast<const char*>(&l_Header), sizeof(l_Header));
+    l_File.write(reinterpret_cast<const char*>(l_Submeshes.data()), static_cast<std::streamsize>(p_Submeshes.size_bytes()));
+    l_Pad(l_Header.vertexDataOffset);
+    l_File.write(reinterpret_cast<const char*>(l_VertexBytes.data()), static_cast<std::streamsize>(l_VertexBytes.size()));
+    l_Pad(l_Header.indexDataOffset);
+    l_File.write(reinterpret_cast<const char*>(l_IndexBytes.data()), static_cast<std::streamsize>(l_IndexBytes.size()));
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <string_view>
+
+#include "vertex.hpp"
+#include "mesh/mapped_file.hpp"
+
+// On disk layout, little endian. The header is followed by the submesh table and then by the vertex and index blobs,
+// each blob starts at a multiple of MESH_BLOB_ALIGNMENT so it can be copied out of the mapping as is
+constexpr uint32_t MESH_FILE_MAGIC = 0x4D504B56; // "VKPM"
+constexpr uint32_t MESH_FILE_VERSION = 2;
+constexpr uint64_t MESH_BLOB_ALIGNMENT = 16;
+
+struct MeshBounds
+{
+    float min[3];
+    float max[3];
+};
+
+struct MeshFileHeader
+{
+    uint32_t magic;
+    uint32_t version;
+
+    // Vertex layout the blob was written with, has to match the struct of vertexFormat to be usable without conversion
+    VertexFormat vertexFormat;
+    uint32_t vertexStride;
+    uint32_t positionOffset;
+    uint32_t normalOffset;
+    uint32_t colorOffset;
+    uint32_t indexSize;
+
+    uint32_t submeshCount;
+    uint32_t reserved;
+    uint64_t vertexCount;
+    uint64_t indexCount;
+
+    uint64_t submeshTableOffset;
+    uint64_t vertexDataOffset;
+    uint64_t indexDataOffset;
+
+    MeshBounds bounds;
+
+    // Object space position = decoded position * dequantizeScale + dequantizeOffset, identity for full precision vertices
+    float dequantizeScale[3];
+    float dequantizeOffset[3];
+};
+
+struct MeshSubmesh
+{
+    uint32_t firstIndex;
+    uint32_t indexCount;
+    int32_t vertexOffset;
+    uint32_t reserved;
+    MeshBounds bounds;
+};
+
+static_assert(sizeof(MeshFileHeader) == 128 && sizeof(MeshSubmesh) == 40, "Mesh file structs must not pick up padding");
+
+class MeshFile
+{
+public:
+    // Throws if the file can't be mapped or its header doesn't describe the current vertex layout
+    explicit MeshFile(std::string_view p_Path);
+
+    [[nodiscard]] const MeshFileHeader& getHeader() const { return *m_Header; }
+    [[nodiscard]] std::span<const MeshSubmesh> getSubmeshes() const { return m_Submeshes; }
+
+    // Point straight into the mapping, valid while the MeshFile is alive
+    [[nodiscard]] std::span<const uint8_t> getVertexData() const { return m_VertexData; }
+    [[nodiscard]] std::span<const uint8_t> getIndexData() const { return m_IndexData; }
+
+    // The vertex format is picked here, at import, full precision vertices are quantized on the way out if requested.
+    // Indices are stored as 16 bit whenever they all fit
+    static void write(std::string_view p_Path, std::span<const Vertex> p_Vertices, std::span<const uint32_t> p_Indices, std::span<const MeshSubmesh> p_Submeshes, VertexFormat p_Format = VertexFormat::FULL);
+
+private:
+    MappedFile m_File;
+
+    const MeshFileHeader* m_Header = nullptr;
+    std::span<const MeshSubmesh> m_Submeshes{};
+    std::span<const uint8_t> m_VertexData{};
+    std::span<const uint8_t> m_IndexData{};
+};
@@ -0,0 +1,362 @@
+#include "mesh_optimizer.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <numeric>
+#include <stdexcept>
+
+// FIFO post transform cache model. A vertex is cached while fewer than cacheSize misses happened since it was last loaded
+class CacheSimulator
+{
+public:
+    CacheSimulator(const uint32_t p_VertexCount, const uint32_t p_CacheSize)
+        : m_Timestamps(p_VertexCount, 0), m_CacheSize(p_CacheSize), m_Time(p_CacheSize + 1) {}
+
+    bool access(const uint32_t p_Vertex)
+    {
+        if (m_Time - m_Timestamps[p_Vertex] <= m_CacheSize)
+            return false;
+        m_Timestamps[p_Vertex] = m_Time++;
+        return true;
+    }
+
+    uint32_t accessTriangle(const uint32_t* p_Triangle)
+    {
+        return static_cast<uint32_t>(access(p_Triangle[0])) + access(p_Triangle[1]) + access(p_Triangle[2]);
+    }
+
+    void flush() { m_Time += m_CacheSize + 1; }
+
+private:
+    std::vector<uint32_t> m_Timestamps;
+    uint32_t m_CacheSize;
+    uint32_t m_Time;
+};
+
+static uint32_t getVertexCount(const std::span<const uint32_t> p_Indices)
+{
+    return p_Indices.empty() ? 0 : *std::ranges::max_element(p_Indices) + 1;
+}
+
+static std::span<uint32_t> getSubmeshIndices(std::vector<uint32_t>& p_Indices, const MeshSubmesh& p_Submesh)
+{
+    if (static_cast<uint64_t>(p_Submesh.firstIndex) + p_Submesh.indexCount > p_Indices.size() || p_Submesh.indexCount % 3 != 0)
+        throw std::runtime_error("Submesh index range is not a valid triangle list");
+    return { p_Indices.data() + p_Submesh.firstIndex, p_Submesh.indexCount };
+}
+
+VertexCacheStats analyzeVertexCache(const std::span<const uint32_t> p_Indices, const std::span<const MeshSubmesh> p_Submeshes, const uint32_t p_CacheSize)
+{
+    uint32_t l_VertexCount = 0;
+    for (const MeshSubmesh& l_Submesh : p_Submeshes)
+        l_VertexCount = std::max(l_VertexCount, l_Submesh.vertexOffset + getVertexCount(p_Indices.subspan(l_Submesh.firstIndex, l_Submesh.indexCount)));
+
+    CacheSimulator l_Cache{ l_VertexCount, p_CacheSize };
+    std::vector<bool> l_Referenced(l_VertexCount, false);
+    uint64_t l_Misses = 0;
+    uint64_t l_Triangles = 0;
+    uint64_t l_Unique = 0;
+    for (const MeshSubmesh& l_Submesh : p_Submeshes)
+    {
+        for (uint32_t i = 0; i < l_Submesh.indexCount; i++)
+        {
+            const uint32_t l_Vertex = p_Indices[l_Submesh.firstIndex + i] + l_Submesh.vertexOffset;
+            l_Misses += l_Cache.access(l_Vertex);
+            if (!l_Referenced[l_Vertex])
+            {
+                l_Referenced[l_Vertex] = true;
+                l_Unique++;
+            }
+        }
+        l_Triangles += l_Submesh.indexCount / 3;
+    }
+
+    VertexCacheStats l_Stats{};
+    l_Stats.acmr = l_Triangles > 0 ? static_cast<double>(l_Misses) / static_cast<double>(l_Triangles) : 0.0;
+    l_Stats.atvr = l_Unique > 0 ? static_cast<double>(l_Misses) / static_cast<double>(l_Unique) : 0.0;
+    return l_Stats;
+}
+
+void optimizeMesh(std::vector<Vertex>& p_Vertices, std::vector<uint32_t>& p_Indices, std::vector<MeshSubmesh>& p_Submeshes, const MeshOptimizeSettings& p_Settings)
+{
+    for (const MeshSubmesh& l_Submesh : p_Submeshes)
+    {
+        const std::span<uint32_t> l_Indices = getSubmeshIndices(p_Indices, l_Submesh);
+        const uint32_t l_VertexCount = getVertexCount(l_Indices);
+        if (l_Submesh.vertexOffset < 0 || static_cast<uint64_t>(l_Submesh.vertexOffset) + l_VertexCount > p_Vertices.size())
+            throw std::runtime_error("Submesh references vertices outside of the vertex buffer");
+
+        optimizeVertexCache(l_Indices, l_VertexCount);
+        optimizeOverdraw(l_Indices, std::span<const Vertex>{ p_Vertices }.subspan(l_Submesh.vertexOffset, l_VertexCount), p_Settings.cacheSize, p_Settings.overdrawThreshold);
+    }
+    optimizeVertexFetch(p_Vertices, p_Indices, p_Submeshes);
+}
+
+// Tom Forsyth's linear speed vertex cache optimization. Triangles are greedily emitted by the score of their vertices, which
+// rewards vertices recently used and vertices with few triangles left so that no vertex is left behind for long
+static constexpr uint32_t FORSYTH_CACHE_SIZE = 32;
+
+static float getForsythScore(const int32_t p_CachePosition, const uint32_t p_Valence)
+{
+    if (p_Valence == 0)
+        return -1.0f;
+
+    float l_Score = 0.0f;
+    if (p_CachePosition >= 0)
+    {
+        // The last triangle's vertices get a fixed score so the next triangle doesn't just reuse the same edge
+        if (p_CachePosition < 3)
+            l_Score = 0.75f;
+        else
+            l_Score = std::pow(1.0f - static_cast<float>(p_CachePosition - 3) / (FORSYTH_CACHE_SIZE - 3), 1.5f);
+    }
+    return l_Score + 2.0f / std::sqrt(static_cast<float>(p_Valence));
+}
+
+void optimizeVertexCache(const std::span<uint32_t> p_Indices, const uint32_t p_VertexCount)
+{
+    const uint32_t l_TriangleCount = static_cast<uint32_t>(p_Indices.size() / 3);
+    if (l_TriangleCount < 2)
+        return;
+
+    // Triangles adjacent to every vertex, the first valence entries of each list are the triangles not emitted yet
+    std::vector<uint32_t> l_Valence(p_VertexCount, 0);
+    for (const uint32_t l_Index : p_Indices)
+        l_Valence[l_Index]++;
+    std::vector<uint32_t> l_Offsets(p_VertexCount + 1, 0);
+    std::inclusive_scan(l_Valence.begin(), l_Valence.end(), l_Offsets.begin() + 1);
+    std::vector<uint32_t> l_Adjacency(p_Indices.size());
+    {
+        std::vector<uint32_t> l_Cursor{ l_Offsets.begin(), l_Offsets.end() - 1 };
+        for (uint32_t i = 0; i < p_Indices.size(); i++)
+            l_Adjacency[l_Cursor[p_Indices[i]]++] = i / 3;
+    }
+
+    std::vector<int32_t> l_CachePosition(p_VertexCount, -1);
+    std::vector<float> l_VertexScore(p_VertexCount);
+    for (uint32_t i = 0; i < p_VertexCount; i++)
+        l_VertexScore[i] = getForsythScore(-1, l_Valence[i]);
+
+    std::vector<float> l_TriangleScore(l_TriangleCount);
+    for (uint32_t i = 0; i < l_TriangleCount; i++)
+        l_TriangleScore[i] = l_VertexScore[p_Indices[i * 3]] + l_VertexScore[p_Indices[i * 3 + 1]] + l_VertexScore[p_Indices[i * 3 + 2]];
+
+    std::vector<bool> l_Emitted(l_TriangleCount, false);
+    std::vector<uint32_t> l_Output{};
+    l_Output.reserve(p_Indices.size());
+
+    // The cache keeps three extra slots so the vertices pushed out by the last triangle get their score lowered too
+    std::array<uint32_t, FORSYTH_CACHE_SIZE + 3> l_Cache{};
+    std::array<uint32_t, FORSYTH_CACHE_SIZE + 3> l_NewCache{};
+    uint32_t l_CacheCount = 0;
+
+    uint32_t l_Best = static_cast<uint32_t>(std::ranges::max_element(l_TriangleScore) - l_TriangleScore.begin());
+    uint32_t l_Cursor = 0;
+    for (uint32_t l_Emit = 0; l_Emit < l_TriangleCount; l_Emit++)
+    {
+        // Nothing adjacent to the cache is left, continue with the next triangle in input order
+        if (l_Best == UINT32_MAX)
+        {
+            while (l_Emitted[l_Cursor])
+                l_Cursor++;
+            l_Best = l_Cursor;
+        }
+
+        const uint32_t* l_Triangle = &p_Indices[l_Best * 3];
+        l_Output.insert(l_Output.end(), l_Triangle, l_Triangle + 3);
+        l_Emitted[l_Best] = true;
+
+        uint32_t l_NewCount = 0;
+        for (uint32_t k = 0; k < 3; k++)
+        {
+            const uint32_t l_Vertex = l_Triangle[k];
+            uint32_t* l_List = &l_Adjacency[l_Offsets[l_Vertex]];
+            uint32_t* l_Last = l_List + l_Valence[l_Vertex] - 1;
+            std::iter_swap(std::find(l_List, l_Last, l_Best), l_Last);
+            l_Valence[l_Vertex]--;
+
+            if (std::find(l_NewCache.begin(), l_NewCache.begin() + l_NewCount, l_Vertex) == l_NewCache.begin() + l_NewCount)
+                l_NewCache[l_NewCount++] = l_Vertex;
+        }
+        for (uint32_t i = 0; i < l_CacheCount && l_NewCount < l_NewCache.size(); i++)
+        {
+            const uint32_t l_Vertex = l_Cache[i];
+            if (l_Vertex != l_Triangle[0] && l_Vertex != l_Triangle[1] && l_Vertex != l_Triangle[2])
+                l_NewCache[l_NewCount++] = l_Vertex;
+        }
+        for (uint32_t i = 0; i < l_CacheCount; i++)
+            l_CachePosition[l_Cache[i]] = -1;
+
+        std::copy_n(l_NewCache.begin(), l_NewCount, l_Cache.begin());
+        l_CacheCount = l_NewCount;
+        for (uint32_t i = 0; i < l_CacheCount; i++)
+        {
+            const uint32_t l_Vertex = l_Cache[i];
+            l_CachePosition[l_Vertex] = i < FORSYTH_CACHE_SIZE ? static_cast<int32_t>(i) : -1;
+            l_VertexScore[l_Vertex] = getForsythScore(l_CachePosition[l_Vertex], l_Valence[l_Vertex]);
+        }
+
+        l_Best = UINT32_MAX;
+        float l_BestScore = -1.0f;
+        for (uint32_t i = 0; i < l_CacheCount; i++)
+        {
+            const uint32_t l_Vertex = l_Cache[i];
+            for (uint32_t j = 0; j < l_Valence[l_Vertex]; j++)
+            {
+                const uint32_t l_Candidate = l_Adjacency[l_Offsets[l_Vertex] + j];
+                const float l_Score = l_VertexScore[p_Indices[l_Candidate * 3]] + l_VertexScore[p_Indices[l_Candidate * 3 + 1]] + l_VertexScore[p_Indices[l_Candidate * 3 + 2]];
+                l_TriangleScore[l_Candidate] = l_Score;
+                if (l_Score > l_BestScore)
+                {
+                    l_BestScore = l_Score;
+                    l_Best = l_Candidate;
+                }
+            }
+        }
+        l_CacheCount = std::min(l_CacheCount, FORSYTH_CACHE_SIZE);
+    }
+
+    std::ranges::copy(l_Output, p_Indices.begin());
+}
+
+// Sander et al. "Fast triangle reordering for vertex locality and reduced overdraw". The cache optimized order is cut in
+// clusters, which are then sorted so the ones facing away from the mesh center, likely occluders, are drawn first
+void optimizeOverdraw(const std::span<uint32_t> p_Indices, const std::span<const Vertex> p_Vertices, const uint32_t p_CacheSize, const float p_Threshold)
+{
+    const uint32_t l_TriangleCount = static_cast<uint32_t>(p_Indices.size() / 3);
+    if (l_TriangleCount < 2)
+        return;
+
+    // Hard boundaries are the points where the cache optimized order already restarts with three misses
+    std::vector<uint32_t> l_HardClusters{};
+    {
+        CacheSimulator l_Cache{ static_cast<uint32_t>(p_Vertices.size()), p_CacheSize };
+        for (uint32_t i = 0; i < l_TriangleCount; i++)
+        {
+            if (l_Cache.accessTriangle(&p_Indices[i * 3]) == 3)
+                l_HardClusters.push_back(i);
+        }
+        if (l_HardClusters.empty() || l_HardClusters.front() != 0)
+            l_HardClusters.insert(l_HardClusters.begin(), 0);
+    }
+
+    // Soft boundaries split a hard cluster again as soon as starting over with a cold cache costs at most p_Threshold
+    // times the ACMR of the whole hard cluster
+    std::vector<uint32_t> l_Clusters{};
+    {
+        CacheSimulator l_Cache{ static_cast<uint32_t>(p_Vertices.size()), p_CacheSize };
+        for (size_t c = 0; c < l_HardClusters.size(); c++)
+        {
+            const uint32_t l_Start = l_HardClusters[c];
+            const uint32_t l_End = c + 1 < l_HardClusters.size() ? l_HardClusters[c + 1] : l_TriangleCount;
+
+            l_Cache.flush();
+            uint32_t l_ClusterMisses = 0;
+            for (uint32_t i = l_Start; i < l_End; i++)
+                l_ClusterMisses += l_Cache.accessTriangle(&p_Indices[i * 3]);
+            const double l_TargetAcmr = static_cast<double>(l_ClusterMisses) / (l_End - l_Start) * p_Threshold;
+
+            l_Cache.flush();
+            l_Clusters.push_back(l_Start);
+            uint32_t l_Misses = 0;
+            uint32_t l_Count = 0;
+            for (uint32_t i = l_Start; i < l_End; i++)
+            {
+                l_Misses += l_Cache.accessTriangle(&p_Indices[i * 3]);
+                l_Count++;
+                if (i + 1 < l_End && static_cast<double>(l_Misses) / l_Count <= l_TargetAcmr)
+                {
+                    l_Cache.flush();
+                    l_Clusters.push_back(i + 1);
+                    l_Misses = 0;
+                    l_Count = 0;
+                }
+            }
+        }
+    }
+
+    struct ClusterInfo
+    {
+        uint32_t start;
+        uint32_t end;
+        glm::vec3 centroid;
+        glm::vec3 normal;
+        float sortKey;
+    };
+    std::vector<ClusterInfo> l_Infos(l_Clusters.size());
+
+    glm::vec3 l_MeshCentroid{ 0.0f };
+    float l_MeshArea = 0.0f;
+    for (size_t c = 0; c < l_Clusters.size(); c++)
+    {
+        ClusterInfo& l_Info = l_Infos[c];
+        l_Info.start = l_Clusters[c];
+        l_Info.end = c + 1 < l_Clusters.size() ? l_Clusters[c + 1] : l_TriangleCount;
+        l_Info.centroid = glm::vec3{ 0.0f };
+        l_Info.normal = glm::vec3{ 0.0f };
+
+        float l_Area = 0.0f;
+        for (uint32_t i = l_Info.start; i < l_Info.end; i++)
+        {
+            const glm::vec3 l_A = p_Vertices[p_Indices[i * 3]].position;
+            const glm::vec3 l_B = p_Vertices[p_Indices[i * 3 + 1]].position;
+            const glm::vec3 l_C = p_Vertices[p_Indices[i * 3 + 2]].position;
+            const glm::vec3 l_Cross = glm::cross(l_B - l_A, l_C - l_A);
+            const float l_TriangleArea = glm::length(l_Cross);
+
+            l_Info.centroid += (l_A + l_B + l_C) * (l_TriangleArea / 3.0f);
+            l_Info.normal += l_Cross;
+            l_Area += l_TriangleArea;
+        }
+        l_MeshCentroid += l_Info.centroid;
+        l_MeshArea += l_Area;
+
+        l_Info.centroid = l_Area > 0.0f ? l_Info.centroid / l_Area : l_Info.centroid;
+        const float l_NormalLength = glm::length(l_Info.normal);
+        l_Info.normal = l_NormalLength > 0.0f ? l_Info.normal / l_NormalLength : l_Info.normal;
+    }
+    l_MeshCentroid = l_MeshArea > 0.0f ? l_MeshCentroid / l_MeshArea : l_MeshCentroid;
+
+    for (ClusterInfo& l_Info : l_Infos)
+        l_Info.sortKey = glm::dot(l_Info.centroid - l_MeshCentroid, l_Info.normal);
+    std::ranges::stable_sort(l_Infos, [](const ClusterInfo& p_A, const ClusterInfo& p_B) { return p_A.sortKey > p_B.sortKey; });
+
+    std::vector<uint32_t> l_Output{};
+    l_Output.reserve(p_Indices.size());
+    for (const ClusterInfo& l_Info : l_Infos)
+        l_Output.insert(l_Output.end(), p_Indices.begin() + l_Info.start * 3, p_Indices.begin() + l_Info.end * 3);
+    std::ranges::copy(l_Output, p_Indices.begin());
+}
+
+void optimizeVertexFetch(std::vector<Vertex>& p_Vertices, std::vector<uint32_t>& p_Indices, std::vector<MeshSubmesh>& p_Submeshes)
+{
+    std::vector<uint32_t> l_Remap(p_Vertices.size(), UINT32_MAX);
+    std::vector<Vertex> l_Output{};
+    l_Output.reserve(p_Vertices.size());
+
+    // Vertices are laid out in the order the index buffer first touches them. Submeshes are walked in order, so each one
+    // keeps a contiguous range of its own unless it shares vertices with an earlier one
+    for (MeshSubmesh& l_Submesh : p_Submeshes)
+    {
+        const std::span<uint32_t> l_Indices = getSubmeshIndices(p_Indices, l_Submesh);
+        uint32_t l_NewOffset = UINT32_MAX;
+        for (uint32_t& l_Index : l_Indices)
+        {
+            const uint32_t l_Vertex = l_Index + l_Submesh.vertexOffset;
+            if (l_Remap[l_Vertex] == UINT32_MAX)
+            {
+                l_Remap[l_Vertex] = static_cast<uint32_t>(l_Output.size());
+                l_Output.push_back(p_Vertices[l_Vertex]);
+            }
+            l_Index = l_Remap[l_Vertex];
+            l_NewOffset = std::min(l_NewOffset, l_Index);
+        }
+
+        l_NewOffset = l_Indices.empty() ? 0 : l_NewOffset;
+        for (uint32_t& l_Index : l_Indices)
+            l_Index -= l_NewOffset;
+        l_Submesh.vertexOffset = static_cast<int32_t>(l_NewOffset);
+    }
+    p_Vertices = std::move(l_Output);
+}
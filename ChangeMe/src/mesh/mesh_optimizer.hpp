@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+#include <vector>
+
+#include "vertex.hpp"
+#include "mesh/mesh_file.hpp"
+
+// Import time processing, indices are relative to the vertexOffset of their submesh like in the mesh file
+struct VertexCacheStats
+{
+    // Average cache miss ratio, misses per triangle, 0.5 is the best possible on a regular grid and 3 the worst
+    double acmr = 0.0;
+    // Average transformed vertex ratio, misses per referenced vertex, 1 means every vertex is transformed once
+    double atvr = 0.0;
+};
+
+struct MeshOptimizeSettings
+{
+    uint32_t cacheSize = 16;
+    // How much ACMR the overdraw pass may give back to get smaller triangle clusters to sort
+    float overdrawThreshold = 1.05f;
+};
+
+[[nodiscard]] VertexCacheStats analyzeVertexCache(std::span<const uint32_t> p_Indices, std::span<const MeshSubmesh> p_Submeshes, uint32_t p_CacheSize);
+
+// Runs, per submesh, the vertex cache ordering, then the overdraw cluster sort, then reorders the vertex buffer in first use
+// order. Vertices no triangle references are dropped
+void optimizeMesh(std::vector<Vertex>& p_Vertices, std::vector<uint32_t>& p_Indices, std::vector<MeshSubmesh>& p_Submeshes, const MeshOptimizeSettings& p_Settings = {});
+
+void optimizeVertexCache(std::span<uint32_t> p_Indices, uint32_t p_VertexCount);
+void optimizeOverdraw(std::span<uint32_t> p_Indices, std::span<const Vertex> p_Vertices, uint32_t p_CacheSize, float p_Threshold);
+void optimizeVertexFetch(std::vector<Vertex>& p_Vertices, std::vector<uint32_t>& p_Indices, std::vector<MeshSubmesh>& p_Submeshes);
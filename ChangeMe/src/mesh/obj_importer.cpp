@@ -0,0 +1,223 @@
+#include "obj_importer.hpp"
+
+#include <algorithm>
+#include <charconv>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+
+#include "mesh/mapped_file.hpp"
+
+// 1 based position index in the high half, 1 based normal index or 0 in the low half
+using ObjVertexKey = uint64_t;
+
+struct ObjParseState
+{
+    std::string path;
+    uint32_t lineNumber = 0;
+
+    std::vector<glm::vec3> positions{};
+    std::vector<glm::u8vec3> colors{};
+    std::vector<glm::vec3> normals{};
+
+    ImportedMesh mesh{};
+    // Vertices are deduplicated per submesh, so every submesh owns a contiguous vertex range
+    std::unordered_map<ObjVertexKey, uint32_t> submeshVertices{};
+    std::vector<bool> needsNormal{};
+    std::vector<uint32_t> polygon{};
+};
+
+[[noreturn]] static void fail(const ObjParseState& p_State, const std::string& p_Message)
+{
+    throw std::runtime_error(p_State.path + ":" + std::to_string(p_State.lineNumber) + ": " + p_Message);
+}
+
+static std::string_view nextToken(std::string_view& p_Line)
+{
+    const size_t l_Start = p_Line.find_first_not_of(" \t");
+    if (l_Start == std::string_view::npos)
+    {
+        p_Line = {};
+        return {};
+    }
+    p_Line.remove_prefix(l_Start);
+    const size_t l_End = std::min(p_Line.find_first_of(" \t"), p_Line.size());
+    const std::string_view l_Token = p_Line.substr(0, l_End);
+    p_Line.remove_prefix(l_End);
+    return l_Token;
+}
+
+static float parseFloat(const ObjParseState& p_State, const std::string_view p_Token)
+{
+    const std::string_view l_Digits = !p_Token.empty() && p_Token.front() == '+' ? p_Token.substr(1) : p_Token;
+    float l_Value = 0.0f;
+    const auto [l_End, l_Error] = std::from_chars(l_Digits.data(), l_Digits.data() + l_Digits.size(), l_Value);
+    if (l_Digits.empty() || l_Error != std::errc{} || l_End != l_Digits.data() + l_Digits.size())
+        fail(p_State, "Expected a number, got \"" + std::string{ p_Token } + "\"");
+    return l_Value;
+}
+
+// OBJ indices are 1 based, negative ones count back from the last element read so far
+static uint32_t resolveIndex(const ObjParseState& p_State, const std::string_view p_Token, const size_t p_Count)
+{
+    int64_t l_Index = 0;
+    const auto [l_End, l_Error] = std::from_chars(p_Token.data(), p_Token.data() + p_Token.size(), l_Index);
+    if (p_Token.empty() || l_Error != std::errc{} || l_End != p_Token.data() + p_Token.size())
+        fail(p_State, "Expected an index, got \"" + std::string{ p_Token } + "\"");
+
+    const int64_t l_Resolved = l_Index < 0 ? static_cast<int64_t>(p_Count) + l_Index : l_Index - 1;
+    if (l_Index == 0 || l_Resolved < 0 || l_Resolved >= static_cast<int64_t>(p_Count))
+        fail(p_State, "Index " + std::string{ p_Token } + " is out of range");
+    return static_cast<uint32_t>(l_Resolved);
+}
+
+// Submeshes without faces are dropped, groups are often declared before anything is put in them
+static void endSubmesh(ObjParseState& p_State)
+{
+    if (!p_State.mesh.submeshes.empty() && p_State.mesh.submeshes.back().indexCount == 0)
+        p_State.mesh.submeshes.pop_back();
+}
+
+static void beginSubmesh(ObjParseState& p_State)
+{
+    endSubmesh(p_State);
+    MeshSubmesh& l_Submesh = p_State.mesh.submeshes.emplace_back();
+    l_Submesh.firstIndex = static_cast<uint32_t>(p_State.mesh.indices.size());
+    l_Submesh.vertexOffset = static_cast<int32_t>(p_State.mesh.vertices.size());
+    p_State.submeshVertices.clear();
+}
+
+// Returns the index of the vertex relative to the current submesh, p, p/t, p//n and p/t/n are accepted
+static uint32_t getVertex(ObjParseState& p_State, const std::string_view p_Token)
+{
+    const size_t l_FirstSlash = p_Token.find('/');
+    const uint32_t l_Position = resolveIndex(p_State, p_Token.substr(0, l_FirstSlash), p_State.positions.size());
+    uint32_t l_Normal = UINT32_MAX;
+    if (l_FirstSlash != std::string_view::npos)
+    {
+        const size_t l_SecondSlash = p_Token.find('/', l_FirstSlash + 1);
+        if (l_SecondSlash != std::string_view::npos && l_SecondSlash + 1 < p_Token.size())
+            l_Normal = resolveIndex(p_State, p_Token.substr(l_SecondSlash + 1), p_State.normals.size());
+    }
+
+    const ObjVertexKey l_Key = static_cast<ObjVertexKey>(l_Position + 1) << 32 | (l_Normal == UINT32_MAX ? 0 : l_Normal + 1);
+    const uint32_t l_VertexOffset = static_cast<uint32_t>(p_State.mesh.submeshes.back().vertexOffset);
+    const auto [l_It, l_Inserted] = p_State.submeshVertices.try_emplace(l_Key, static_cast<uint32_t>(p_State.mesh.vertices.size()) - l_VertexOffset);
+    if (l_Inserted)
+    {
+        const glm::vec3 l_VertexNormal = l_Normal == UINT32_MAX ? glm::vec3{ 0.0f } : p_State.normals[l_Normal];
+        p_State.mesh.vertices.push_back({ p_State.positions[l_Position], l_VertexNormal, p_State.colors[l_Position] });
+        p_State.needsNormal.push_back(l_Normal == UINT32_MAX);
+    }
+    return l_It->second;
+}
+
+static void parseFace(ObjParseState& p_State, std::string_view p_Line)
+{
+    if (p_State.mesh.submeshes.empty())
+        beginSubmesh(p_State);
+
+    p_State.polygon.clear();
+    for (std::string_view l_Token = nextToken(p_Line); !l_Token.empty(); l_Token = nextToken(p_Line))
+        p_State.polygon.push_back(getVertex(p_State, l_Token));
+    if (p_State.polygon.size() < 3)
+        fail(p_State, "Face needs at least 3 vertices");
+
+    const std::vector<uint32_t>& l_Polygon = p_State.polygon;
+    for (size_t i = 2; i < l_Polygon.size(); i++)
+        p_State.mesh.indices.insert(p_State.mesh.indices.end(), { l_Polygon[0], l_Polygon[i - 1], l_Polygon[i] });
+    p_State.mesh.submeshes.back().indexCount += static_cast<uint32_t>(l_Polygon.size() - 2) * 3;
+}
+
+static void parseLine(ObjParseState& p_State, std::string_view p_Line)
+{
+    p_State.lineNumber++;
+    if (const size_t l_Comment = p_Line.find('#'); l_Comment != std::string_view::npos)
+        p_Line = p_Line.substr(0, l_Comment);
+    if (!p_Line.empty() && p_Line.back() == '\r')
+        p_Line.remove_suffix(1);
+
+    const std::string_view l_Keyword = nextToken(p_Line);
+    if (l_Keyword == "v")
+    {
+        glm::vec3 l_Position{};
+        for (uint32_t i = 0; i < 3; i++)
+            l_Position[i] = parseFloat(p_State, nextToken(p_Line));
+        p_State.positions.push_back(l_Position);
+
+        // Optional color, either in 0..1 or already in 0..255
+        glm::u8vec3 l_Color{ 255 };
+        if (const std::string_view l_Red = nextToken(p_Line); !l_Red.empty())
+        {
+            glm::vec3 l_Rgb{ parseFloat(p_State, l_Red), 0.0f, 0.0f };
+            l_Rgb.g = parseFloat(p_State, nextToken(p_Line));
+            l_Rgb.b = parseFloat(p_State, nextToken(p_Line));
+            const float l_Scale = l_Rgb.r > 1.0f || l_Rgb.g > 1.0f || l_Rgb.b > 1.0f ? 1.0f : 255.0f;
+            l_Color = glm::u8vec3{ glm::clamp(l_Rgb * l_Scale + 0.5f, 0.0f, 255.0f) };
+        }
+        p_State.colors.push_back(l_Color);
+    }
+    else if (l_Keyword == "vn")
+    {
+        glm::vec3 l_Normal{};
+        for (uint32_t i = 0; i < 3; i++)
+            l_Normal[i] = parseFloat(p_State, nextToken(p_Line));
+        p_State.normals.push_back(l_Normal);
+    }
+    else if (l_Keyword == "f")
+        parseFace(p_State, p_Line);
+    else if (l_Keyword == "o" || l_Keyword == "g" || l_Keyword == "usemtl")
+        beginSubmesh(p_State);
+}
+
+static void generateNormals(ObjParseState& p_State)
+{
+    ImportedMesh& l_Mesh = p_State.mesh;
+    for (const MeshSubmesh& l_Submesh : l_Mesh.submeshes)
+    {
+        for (uint32_t i = 0; i < l_Submesh.indexCount; i += 3)
+        {
+            const uint32_t* l_Triangle = &l_Mesh.indices[l_Submesh.firstIndex + i];
+            const glm::vec3 l_A = l_Mesh.vertices[l_Submesh.vertexOffset + l_Triangle[0]].position;
+            const glm::vec3 l_B = l_Mesh.vertices[l_Submesh.vertexOffset + l_Triangle[1]].position;
+            const glm::vec3 l_C = l_Mesh.vertices[l_Submesh.vertexOffset + l_Triangle[2]].position;
+            // Left unnormalized, larger faces weigh more
+            const glm::vec3 l_FaceNormal = glm::cross(l_B - l_A, l_C - l_A);
+            for (uint32_t j = 0; j < 3; j++)
+            {
+                const size_t l_Vertex = l_Submesh.vertexOffset + l_Triangle[j];
+                if (p_State.needsNormal[l_Vertex])
+                    l_Mesh.vertices[l_Vertex].normal += l_FaceNormal;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < l_Mesh.vertices.size(); i++)
+    {
+        if (!p_State.needsNormal[i])
+            continue;
+        const float l_Length = glm::length(l_Mesh.vertices[i].normal);
+        l_Mesh.vertices[i].normal = l_Length > 0.0f ? l_Mesh.vertices[i].normal / l_Length : glm::vec3{ 0.0f, 1.0f, 0.0f };
+    }
+}
+
+ImportedMesh importObj(const std::string_view p_Path)
+{
+    const MappedFile l_File{ p_Path };
+    const std::string_view l_Text{ reinterpret_cast<const char*>(l_File.getData()), l_File.getSize() };
+
+    ObjParseState l_State{};
+    l_State.path = p_Path;
+    for (size_t l_Start = 0; l_Start < l_Text.size();)
+    {
+        const size_t l_End = std::min(l_Text.find('\n', l_Start), l_Text.size());
+        parseLine(l_State, l_Text.substr(l_Start, l_End - l_Start));
+        l_Start = l_End + 1;
+    }
+
+    endSubmesh(l_State);
+    if (l_State.mesh.submeshes.empty())
+        throw std::runtime_error(l_State.path + " has no faces");
+    generateNormals(l_State);
+    return std::move(l_State.mesh);
+}
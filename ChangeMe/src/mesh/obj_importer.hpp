@@ -0,0 +1,21 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "vertex.hpp"
+#include "mesh/mesh_file.hpp"
+
+// Full precision geometry ready for MeshFile::write, indices are relative to the vertexOffset of their submesh
+struct ImportedMesh
+{
+    std::vector<Vertex> vertices{};
+    std::vector<uint32_t> indices{};
+    std::vector<MeshSubmesh> submeshes{};
+};
+
+// Wavefront OBJ. Every o, g or usemtl statement starts a new submesh, polygons are fan triangulated and texture
+// coordinates are ignored. Vertex colors are read from the common "v x y z r g b" extension, white otherwise, and
+// vertices without a normal get the area weighted average of the faces around them. Throws on malformed input
+[[nodiscard]] ImportedMesh importObj(std::string_view p_Path);
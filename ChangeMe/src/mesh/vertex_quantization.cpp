@@ -0,0 +1,59 @@
+#include "vertex_quantization.hpp"
+
+#include <algorithm>
+#include <cmath>
+
+static int16_t toSnorm16(const float p_Value)
+{
+    return static_cast<int16_t>(std::lround(std::clamp(p_Value, -1.0f, 1.0f) * 32767.0f));
+}
+
+static uint16_t toUnorm16(const float p_Value)
+{
+    return static_cast<uint16_t>(std::lround(std::clamp(p_Value, 0.0f, 1.0f) * 65535.0f));
+}
+
+glm::i16vec2 encodeOctahedral(const glm::vec3 p_Normal)
+{
+    const float l_L1 = std::abs(p_Normal.x) + std::abs(p_Normal.y) + std::abs(p_Normal.z);
+    if (l_L1 == 0.0f)
+        return { 0, 0 };
+
+    glm::vec2 l_Oct{ p_Normal.x / l_L1, p_Normal.y / l_L1 };
+    // The lower hemisphere is folded over the diagonals of the square
+    if (p_Normal.z < 0.0f)
+    {
+        l_Oct = {
+            (1.0f - std::abs(l_Oct.y)) * (l_Oct.x >= 0.0f ? 1.0f : -1.0f),
+            (1.0f - std::abs(l_Oct.x)) * (l_Oct.y >= 0.0f ? 1.0f : -1.0f)
+        };
+    }
+    return { toSnorm16(l_Oct.x), toSnorm16(l_Oct.y) };
+}
+
+glm::vec3 getDequantizeScale(const MeshBounds& p_Bounds)
+{
+    glm::vec3 l_Scale{};
+    for (uint32_t i = 0; i < 3; i++)
+    {
+        const float l_Extent = p_Bounds.max[i] - p_Bounds.min[i];
+        l_Scale[i] = l_Extent > 0.0f ? l_Extent : 1.0f;
+    }
+    return l_Scale;
+}
+
+glm::vec3 getDequantizeOffset(const MeshBounds& p_Bounds)
+{
+    return { p_Bounds.min[0], p_Bounds.min[1], p_Bounds.min[2] };
+}
+
+QuantizedVertex quantizeVertex(const Vertex& p_Vertex, const MeshBounds& p_Bounds)
+{
+    const glm::vec3 l_Normalized = (p_Vertex.position - getDequantizeOffset(p_Bounds)) / getDequantizeScale(p_Bounds);
+
+    QuantizedVertex l_Vertex{};
+    l_Vertex.position = { toUnorm16(l_Normalized.x), toUnorm16(l_Normalized.y), toUnorm16(l_Normalized.z), 0 };
+    l_Vertex.normal = encodeOctahedral(p_Vertex.normal);
+    l_Vertex.color = { p_Vertex.color, 255 };
+    return l_Vertex;
+}
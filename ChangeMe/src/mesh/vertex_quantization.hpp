@@ -0,0 +1,11 @@
+#pragma once
+
+#include "vertex.hpp"
+#include "mesh/mesh_file.hpp"
+
+[[nodiscard]] glm::i16vec2 encodeOctahedral(glm::vec3 p_Normal);
+
+// Positions are normalized inside p_Bounds, the inverse mapping is getDequantizeScale/Offset
+[[nodiscard]] QuantizedVertex quantizeVertex(const Vertex& p_Vertex, const MeshBounds& p_Bounds);
+[[nodiscard]] glm::vec3 getDequantizeScale(const MeshBounds& p_Bounds);
+[[nodiscard]] glm::vec3 getDequantizeOffset(const MeshBounds& p_Bounds);
@@ -0,0 +1,180 @@
+#include "pipeline_cache.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+void PipelineCache::init(const ResourceID p_DeviceID, const std::string_view p_Path)
+{
+    m_DeviceID = p_DeviceID;
+    m_Path = p_Path;
+    m_Stats = {};
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    m_Properties = l_Device.getGPU().getProperties();
+
+    // A missing or foreign file is not an error, the cache just starts cold
+    std::vector<char> l_Data{};
+    std::ifstream l_File{ m_Path, std::ios::binary | std::ios::ate };
+    const std::streamoff l_FileSize = l_File.is_open() ? static_cast<std::streamoff>(l_File.tellg()) : 0;
+    l_File.seekg(0);
+    FileHeader l_Header{};
+    if (l_File.is_open() && l_File.read(reinterpret_cast<char*>(&l_Header), sizeof(l_Header)))
+    {
+        // The size field is only trusted once it matches what the file actually holds, a truncated or corrupted
+        // file would otherwise ask for an arbitrarily large allocation
+        const uint64_t l_Remaining = static_cast<uint64_t>(l_FileSize) - sizeof(l_Header);
+        if (!matchesDevice(l_Header) || l_Header.dataSize != l_Remaining)
+        {
+            m_Stats.rejected = true;
+        }
+        else
+        {
+            l_Data.resize(l_Header.dataSize);
+            if (!l_File.read(l_Data.data(), static_cast<std::streamsize>(l_Data.size())))
+                l_Data.clear();
+        }
+    }
+
+    // The driver validates its own header again, but checking it here means a corrupted file is never handed over
+    if (l_Data.size() >= sizeof(VkPipelineCacheHeaderVersionOne))
+    {
+        VkPipelineCacheHeaderVersionOne l_DriverHeader;
+        std::memcpy(&l_DriverHeader, l_Data.data(), sizeof(l_DriverHeader));
+        if (l_DriverHeader.headerVersion != VK_PIPELINE_CACHE_HEADER_VERSION_ONE || l_DriverHeader.vendorID != m_Properties.vendorID ||
+            l_DriverHeader.deviceID != m_Properties.deviceID || std::memcmp(l_DriverHeader.pipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE) != 0)
+        {
+            l_Data.clear();
+            m_Stats.rejected = true;
+        }
+    }
+    else
+    {
+        l_Data.clear();
+    }
+    m_Stats.loadedBytes = l_Data.size();
+
+    VkPipelineCacheCreateInfo l_CacheInfo{ VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+    l_CacheInfo.initialDataSize = l_Data.size();
+    l_CacheInfo.pInitialData = l_Data.empty() ? nullptr : l_Data.data();
+    if (vkCreatePipelineCache(*l_Device, &l_CacheInfo, nullptr, &m_Cache) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create pipeline cache");
+}
+
+void PipelineCache::save() const
+{
+    if (m_Cache == VK_NULL_HANDLE)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    size_t l_Size = 0;
+    if (vkGetPipelineCacheData(*l_Device, m_Cache, &l_Size, nullptr) != VK_SUCCESS || l_Size == 0)
+        return;
+    std::vector<char> l_Data(l_Size);
+    if (vkGetPipelineCacheData(*l_Device, m_Cache, &l_Size, l_Data.data()) != VK_SUCCESS)
+        return;
+
+    FileHeader l_Header{};
+    l_Header.magic = FILE_MAGIC;
+    l_Header.version = FILE_VERSION;
+    l_Header.vendorID = m_Properties.vendorID;
+    l_Header.deviceID = m_Properties.deviceID;
+    l_Header.driverVersion = m_Properties.driverVersion;
+    std::memcpy(l_Header.pipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE);
+    l_Header.dataSize = l_Size;
+
+    // Written to a temporary first so an interrupted save never leaves a truncated cache behind
+    const std::string l_TempPath = m_Path + ".tmp";
+    {
+        std::ofstream l_File{ l_TempPath, std::ios::binary | std::ios::trunc };
+        if (!l_File.is_open())
+            return;
+        l_File.write(reinterpret_cast<const char*>(&l_Header), sizeof(l_Header));
+        l_File.write(l_Data.data(), static_cast<std::streamsize>(l_Size));
+        if (!l_File)
+            return;
+    }
+    std::remove(m_Path.c_str());
+    std::rename(l_TempPath.c_str(), m_Path.c_str());
+}
+
+void PipelineCache::free()
+{
+    if (m_Cache == VK_NULL_HANDLE)
+        return;
+
+    vkDestroyPipelineCache(*VulkanContext::getDevice(m_DeviceID), m_Cache, nullptr);
+    m_Cache = VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineCache::createComputePipeline(const VkComputePipelineCreateInfo& p_Info)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+
+    VkPipelineCreationFeedback l_Feedback{};
+    VkPipelineCreationFeedbackCreateInfo l_FeedbackInfo{ VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO };
+    l_FeedbackInfo.pNext = p_Info.pNext;
+    l_FeedbackInfo.pPipelineCreationFeedback = &l_Feedback;
+    VkComputePipelineCreateInfo l_Info = p_Info;
+    l_Info.pNext = &l_FeedbackInfo;
+
+    VkPipeline l_Pipeline = VK_NULL_HANDLE;
+    const auto l_Start = std::chrono::steady_clock::now();
+    if (vkCreateComputePipelines(*l_Device, m_Cache, 1, &l_Info, nullptr, &l_Pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create compute pipeline");
+    const std::chrono::duration<double, std::milli> l_Elapsed = std::chrono::steady_clock::now() - l_Start;
+
+    recordCreation(l_Feedback, l_Elapsed.count());
+    return l_Pipeline;
+}
+
+VkPipeline PipelineCache::createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& p_Info)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+
+    VkPipelineCreationFeedback l_Feedback{};
+    VkPipelineCreationFeedbackCreateInfo l_FeedbackInfo{ VK_STRUCTURE_TYPE_PIPELINE_CREATION_FEEDBACK_CREATE_INFO };
+    l_FeedbackInfo.pNext = p_Info.pNext;
+    l_FeedbackInfo.pPipelineCreationFeedback = &l_Feedback;
+    VkGraphicsPipelineCreateInfo l_Info = p_Info;
+    l_Info.pNext = &l_FeedbackInfo;
+
+    VkPipeline l_Pipeline = VK_NULL_HANDLE;
+    const auto l_Start = std::chrono::steady_clock::now();
+    if (vkCreateGraphicsPipelines(*l_Device, m_Cache, 1, &l_Info, nullptr, &l_Pipeline) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create graphics pipeline");
+    const std::chrono::duration<double, std::milli> l_Elapsed = std::chrono::steady_clock::now() - l_Start;
+
+    recordCreation(l_Feedback, l_Elapsed.count());
+    return l_Pipeline;
+}
+
+bool PipelineCache::matchesDevice(const FileHeader& p_Header) const
+{
+    return p_Header.magic == FILE_MAGIC && p_Header.version == FILE_VERSION && p_Header.vendorID == m_Properties.vendorID &&
+        p_Header.deviceID == m_Properties.deviceID && p_Header.driverVersion == m_Properties.driverVersion &&
+        std::memcmp(p_Header.pipelineCacheUUID, m_Properties.pipelineCacheUUID, VK_UUID_SIZE) == 0;
+}
+
+void PipelineCache::recordCreation(const VkPipelineCreationFeedback& p_Feedback, const double p_Ms)
+{
+    // Drivers that don't fill the feedback are counted as misses, that is the pessimistic reading
+    const bool l_Valid = (p_Feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_VALID_BIT) != 0;
+    if (l_Valid && (p_Feedback.flags & VK_PIPELINE_CREATION_FEEDBACK_APPLICATION_PIPELINE_CACHE_HIT_BIT) != 0)
+    {
+        m_Stats.hits++;
+        m_Stats.hitMs += p_Ms;
+    }
+    else
+    {
+        m_Stats.misses++;
+        m_Stats.missMs += p_Ms;
+    }
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+struct PipelineCacheStats
+{
+    uint32_t hits = 0;
+    uint32_t misses = 0;
+    double hitMs = 0.0;
+    double missMs = 0.0;
+
+    // Set when a cache file was found but written by a different GPU or driver
+    bool rejected = false;
+    size_t loadedBytes = 0;
+};
+
+// VkPipelineCache persisted next to the shader cache. The file is only trusted when it was written by the same
+// vendor, device, driver version and pipelineCacheUUID, anything else starts from an empty cache
+class PipelineCache
+{
+public:
+    void init(ResourceID p_DeviceID, std::string_view p_Path);
+    void save() const;
+    void free();
+
+    // Creation goes through here so every pipeline is timed and classified with pipeline creation feedback
+    [[nodiscard]] VkPipeline createComputePipeline(const VkComputePipelineCreateInfo& p_Info);
+    [[nodiscard]] VkPipeline createGraphicsPipeline(const VkGraphicsPipelineCreateInfo& p_Info);
+
+    [[nodiscard]] VkPipelineCache getHandle() const { return m_Cache; }
+    [[nodiscard]] const PipelineCacheStats& getStats() const { return m_Stats; }
+
+private:
+    static constexpr uint32_t FILE_MAGIC = 0x43504B56;
+    static constexpr uint32_t FILE_VERSION = 1;
+
+    struct FileHeader
+    {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t vendorID;
+        uint32_t deviceID;
+        uint32_t driverVersion;
+        uint8_t pipelineCacheUUID[VK_UUID_SIZE];
+        uint64_t dataSize;
+    };
+
+    [[nodiscard]] bool matchesDevice(const FileHeader& p_Header) const;
+    void recordCreation(const VkPipelineCreationFeedback& p_Feedback, double p_Ms);
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    std::string m_Path{};
+    VkPhysicalDeviceProperties m_Properties{};
+    VkPipelineCache m_Cache = VK_NULL_HANDLE;
+    PipelineCacheStats m_Stats{};
+};
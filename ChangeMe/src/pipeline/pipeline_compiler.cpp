@@ -0,0 +1,130 @@
+#include "pipeline_compiler.hpp"
+
+#include <algorithm>
+#include <chrono>
+
+#include "vulkan_device.hpp"
+#include "vulkan_pipeline.hpp"
+
+void PipelineCompiler::init(JobSystem& p_JobSystem)
+{
+    m_JobSystem = &p_JobSystem;
+}
+
+void PipelineCompiler::free()
+{
+    if (m_JobSystem != nullptr)
+        m_JobSystem->wait(m_Compiling);
+    m_JobSystem = nullptr;
+
+    m_Jobs.clear();
+    m_Compiled.clear();
+}
+
+PipelineCompiler::Handle PipelineCompiler::submit(const ShaderCompileDesc& p_Desc, PipelineBuildFunc p_Build)
+{
+    Handle l_Handle;
+    {
+        std::scoped_lock l_Lock{ m_Mutex };
+        l_Handle = static_cast<Handle>(m_Jobs.size());
+        Job& l_Job = m_Jobs.emplace_back();
+        l_Job.desc = p_Desc;
+        l_Job.build = std::move(p_Build);
+    }
+    m_JobSystem->submit([this, l_Handle] { compile(l_Handle); }, &m_Compiling);
+    return l_Handle;
+}
+
+void PipelineCompiler::update()
+{
+    std::unique_lock l_Lock{ m_Mutex };
+    buildFinished(l_Lock);
+}
+
+void PipelineCompiler::wait(const Handle p_Handle)
+{
+    std::unique_lock l_Lock{ m_Mutex };
+    m_JobCompiled.wait(l_Lock, [this, p_Handle] { return m_Jobs[p_Handle].compiled; });
+    buildFinished(l_Lock);
+}
+
+void PipelineCompiler::waitAll()
+{
+    std::unique_lock l_Lock{ m_Mutex };
+    m_JobCompiled.wait(l_Lock, [this] { return std::ranges::all_of(m_Jobs, [](const Job& p_Job) { return p_Job.compiled; }); });
+    buildFinished(l_Lock);
+}
+
+bool PipelineCompiler::isReady(const Handle p_Handle) const
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    return p_Handle < m_Jobs.size() && m_Jobs[p_Handle].pipeline != VK_NULL_HANDLE;
+}
+
+VkPipeline PipelineCompiler::resolve(const Handle p_Handle, const VkPipeline p_Fallback) const
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    if (p_Handle >= m_Jobs.size() || m_Jobs[p_Handle].pipeline == VK_NULL_HANDLE)
+        return p_Fallback;
+    return m_Jobs[p_Handle].pipeline;
+}
+
+void PipelineCompiler::compile(const Handle p_Handle)
+{
+    Job* l_Job;
+    {
+        std::scoped_lock l_Lock{ m_Mutex };
+        l_Job = &m_Jobs[p_Handle];
+    }
+
+    const auto l_Start = std::chrono::steady_clock::now();
+    std::unique_ptr<VulkanShader> l_Shader{};
+    std::exception_ptr l_Error{};
+    try
+    {
+#ifndef _DEBUG
+        l_Shader = std::make_unique<VulkanShader>(0, false);
+        l_Shader->enableCache("shaders/cache/" + l_Job->desc.cacheName + "_release.bin");
+#else
+        l_Shader = std::make_unique<VulkanShader>(0, true);
+        l_Shader->enableCache("shaders/cache/" + l_Job->desc.cacheName + "_debug.bin");
+#endif
+        l_Shader->setExpectedStages(l_Job->desc.stages);
+        l_Shader->addModule(l_Job->desc.modulePath, "main");
+        l_Shader->compile();
+    }
+    catch (...)
+    {
+        l_Error = std::current_exception();
+    }
+    const std::chrono::duration<double, std::milli> l_Elapsed = std::chrono::steady_clock::now() - l_Start;
+
+    {
+        std::scoped_lock l_Lock{ m_Mutex };
+        l_Job->shader = std::move(l_Shader);
+        l_Job->error = l_Error;
+        l_Job->compileMs = l_Elapsed.count();
+        l_Job->compiled = true;
+        m_Compiled.push_back(p_Handle);
+    }
+    m_JobCompiled.notify_all();
+}
+
+void PipelineCompiler::buildFinished(std::unique_lock<std::mutex>& p_Lock)
+{
+    while (!m_Compiled.empty())
+    {
+        Job& l_Job = m_Jobs[m_Compiled.back()];
+        m_Compiled.pop_back();
+        m_CompileMs += l_Job.compileMs;
+        if (l_Job.error)
+            std::rethrow_exception(l_Job.error);
+
+        // Building touches the device, the lock is dropped so workers can keep compiling meanwhile
+        std::unique_ptr<VulkanShader> l_Shader = std::move(l_Job.shader);
+        p_Lock.unlock();
+        const VkPipeline l_Pipeline = l_Job.build(*l_Shader);
+        p_Lock.lock();
+        l_Job.pipeline = l_Pipeline;
+    }
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+#include "jobs/job_system.hpp"
+
+class VulkanShader;
+
+struct ShaderCompileDesc
+{
+    std::string modulePath;
+    // Cache file name without directory or suffix, the build configuration picks the final name
+    std::string cacheName;
+    VkShaderStageFlags stages;
+};
+
+// Turns a compiled shader into a pipeline, always called on the thread that calls update(). The pipeline belongs to
+// whoever submitted it
+using PipelineBuildFunc = std::function<VkPipeline(VulkanShader&)>;
+
+// Slang compilation is the expensive part of pipeline creation and runs as jobs. Shader modules and pipelines are
+// still created on the owning thread since the device resource tables aren't thread safe
+class PipelineCompiler
+{
+public:
+    using Handle = uint32_t;
+    static constexpr Handle INVALID_HANDLE = UINT32_MAX;
+
+    void init(JobSystem& p_JobSystem);
+    // Waits for the compiles still running, their results are dropped
+    void free();
+
+    [[nodiscard]] Handle submit(const ShaderCompileDesc& p_Desc, PipelineBuildFunc p_Build);
+
+    // Builds the pipelines whose shaders finished compiling, compile errors are rethrown here. Never blocks
+    void update();
+    void wait(Handle p_Handle);
+    void waitAll();
+
+    [[nodiscard]] bool isReady(Handle p_Handle) const;
+    // The pipeline once it has been built, p_Fallback until then
+    [[nodiscard]] VkPipeline resolve(Handle p_Handle, VkPipeline p_Fallback) const;
+
+    [[nodiscard]] uint32_t getThreadCount() const { return m_JobSystem != nullptr ? m_JobSystem->getThreadCount() : 0; }
+    [[nodiscard]] double getCompileMs() const { return m_CompileMs; }
+
+private:
+    struct Job
+    {
+        ShaderCompileDesc desc;
+        PipelineBuildFunc build;
+        std::unique_ptr<VulkanShader> shader{};
+        std::exception_ptr error{};
+        double compileMs = 0.0;
+        bool compiled = false;
+        VkPipeline pipeline = VK_NULL_HANDLE;
+    };
+
+    void compile(Handle p_Handle);
+    void buildFinished(std::unique_lock<std::mutex>& p_Lock);
+
+    JobSystem* m_JobSystem = nullptr;
+    JobCounter m_Compiling{};
+
+    // Jobs are never removed, a deque keeps their addresses stable while compile jobs hold on to them
+    std::deque<Job> m_Jobs{};
+    std::vector<Handle> m_Compiled{};
+
+    mutable std::mutex m_Mutex;
+    std::condition_variable m_JobCompiled;
+    double m_CompileMs = 0.0;
+};
@@ -0,0 +1,357 @@
+#include "profiler.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <stdexcept>
+#include <imgui.h>
+
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+void ScopeStats::addSample(const double p_Ms)
+{
+    m_Samples[m_Next] = p_Ms;
+    m_Next = (m_Next + 1) % WINDOW_SIZE;
+    m_Count = std::min(m_Count + 1, WINDOW_SIZE);
+}
+
+double ScopeStats::getAverage() const
+{
+    if (m_Count == 0)
+        return 0.0;
+    double l_Sum = 0.0;
+    for (uint32_t i = 0; i < m_Count; i++)
+        l_Sum += m_Samples[i];
+    return l_Sum / m_Count;
+}
+
+double ScopeStats::getPercentile(const double p_Percentile) const
+{
+    if (m_Count == 0)
+        return 0.0;
+    std::array<double, WINDOW_SIZE> l_Sorted;
+    std::copy_n(m_Samples.begin(), m_Count, l_Sorted.begin());
+    const uint32_t l_Index = std::min(static_cast<uint32_t>(p_Percentile * m_Count), m_Count - 1);
+    std::nth_element(l_Sorted.begin(), l_Sorted.begin() + l_Index, l_Sorted.begin() + m_Count);
+    return l_Sorted[l_Index];
+}
+
+double ScopeStats::getLast() const
+{
+    if (m_Count == 0)
+        return 0.0;
+    return m_Samples[(m_Next + WINDOW_SIZE - 1) % WINDOW_SIZE];
+}
+
+void Profiler::init(const ResourceID p_DeviceID, const uint32_t p_QueueFamilyIndex, const uint32_t p_FramesInFlight)
+{
+    m_DeviceID = p_DeviceID;
+    m_Epoch = std::chrono::steady_clock::now();
+    m_FrameSlots.resize(p_FramesInFlight);
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    const VkPhysicalDevice l_PhysicalDevice = *l_Device.getGPU();
+
+    uint32_t l_FamilyCount = 0;
+    vkGetPhysicalDeviceQueueFamilyProperties(l_PhysicalDevice, &l_FamilyCount, nullptr);
+    std::vector<VkQueueFamilyProperties> l_Families{ l_FamilyCount };
+    vkGetPhysicalDeviceQueueFamilyProperties(l_PhysicalDevice, &l_FamilyCount, l_Families.data());
+
+    const uint32_t l_ValidBits = p_QueueFamilyIndex < l_FamilyCount ? l_Families[p_QueueFamilyIndex].timestampValidBits : 0;
+    m_GpuEnabled = l_ValidBits > 0;
+    if (!m_GpuEnabled)
+        return;
+
+    m_TimestampMask = l_ValidBits >= 64 ? ~0ULL : (1ULL << l_ValidBits) - 1;
+    m_TimestampPeriodNs = l_Device.getGPU().getProperties().limits.timestampPeriod;
+
+    VkQueryPoolCreateInfo l_PoolInfo{ VK_STRUCTURE_TYPE_QUERY_POOL_CREATE_INFO };
+    l_PoolInfo.queryType = VK_QUERY_TYPE_TIMESTAMP;
+    l_PoolInfo.queryCount = MAX_GPU_SCOPES * 2;
+    for (FrameSlot& l_Slot : m_FrameSlots)
+    {
+        if (vkCreateQueryPool(*l_Device, &l_PoolInfo, nullptr, &l_Slot.queryPool) != VK_SUCCESS)
+            throw std::runtime_error("Failed to create timestamp query pool");
+        l_Slot.scopes.reserve(MAX_GPU_SCOPES);
+        l_Slot.openScopes.reserve(MAX_GPU_SCOPES);
+    }
+}
+
+void Profiler::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    for (FrameSlot& l_Slot : m_FrameSlots)
+    {
+        if (l_Slot.queryPool != VK_NULL_HANDLE)
+            vkDestroyQueryPool(*l_Device, l_Slot.queryPool, nullptr);
+        l_Slot.queryPool = VK_NULL_HANDLE;
+    }
+    m_FrameSlots.clear();
+    m_DeviceID = UINT32_MAX;
+}
+
+void Profiler::beginFrame(const uint32_t p_FrameSlot)
+{
+    m_CurrentSlot = p_FrameSlot;
+    FrameSlot& l_Slot = m_FrameSlots[p_FrameSlot];
+    if (!m_GpuEnabled || l_Slot.queryCount == 0)
+    {
+        l_Slot.scopes.clear();
+        return;
+    }
+
+    std::array<uint64_t, MAX_GPU_SCOPES * 2> l_Timestamps{};
+    const VkResult l_Result = vkGetQueryPoolResults(*VulkanContext::getDevice(m_DeviceID), l_Slot.queryPool, 0, l_Slot.queryCount,
+        l_Slot.queryCount * sizeof(uint64_t), l_Timestamps.data(), sizeof(uint64_t), VK_QUERY_RESULT_64_BIT);
+
+    if (l_Result == VK_SUCCESS)
+    {
+        // There is no calibrated clock, so the GPU work of a frame is anchored at the CPU time it was submitted
+        const uint64_t l_FrameBegin = l_Timestamps[l_Slot.scopes.front().beginQuery] & m_TimestampMask;
+        const double l_AnchorUs = std::max(l_Slot.submitUs, m_LastGpuEndUs);
+        for (const GpuScope& l_Scope : l_Slot.scopes)
+        {
+            const uint64_t l_Begin = l_Timestamps[l_Scope.beginQuery] & m_TimestampMask;
+            const uint64_t l_End = l_Timestamps[l_Scope.endQuery] & m_TimestampMask;
+            const double l_DurationUs = static_cast<double>((l_End - l_Begin) & m_TimestampMask) * m_TimestampPeriodNs * 0.001;
+            const double l_OffsetUs = static_cast<double>((l_Begin - l_FrameBegin) & m_TimestampMask) * m_TimestampPeriodNs * 0.001;
+
+            findStats(m_GpuScopes, l_Scope.name).addSample(l_DurationUs * 0.001);
+            recordTraceEvent(l_Scope.name, l_AnchorUs + l_OffsetUs, l_DurationUs, true);
+            m_LastGpuEndUs = std::max(m_LastGpuEndUs, l_AnchorUs + l_OffsetUs + l_DurationUs);
+        }
+    }
+
+    l_Slot.scopes.clear();
+    l_Slot.queryCount = 0;
+}
+
+void Profiler::markSubmitted()
+{
+    if (!m_FrameSlots.empty())
+        m_FrameSlots[m_CurrentSlot].submitUs = nowUs();
+}
+
+void Profiler::beginCpuScope(const char* p_Name)
+{
+    if (m_CpuDepth >= MAX_CPU_DEPTH)
+        throw std::runtime_error("CPU profiler scopes nested too deeply");
+    m_CpuStack[m_CpuDepth++] = { p_Name, nowUs() };
+}
+
+void Profiler::endCpuScope()
+{
+    if (m_CpuDepth == 0)
+        return;
+    const OpenCpuScope& l_Scope = m_CpuStack[--m_CpuDepth];
+    const double l_DurationUs = nowUs() - l_Scope.startUs;
+    findStats(m_CpuScopes, l_Scope.name).addSample(l_DurationUs * 0.001);
+    recordTraceEvent(l_Scope.name, l_Scope.startUs, l_DurationUs, false);
+}
+
+void Profiler::resetGpuQueries(const VkCommandBuffer p_CmdBuffer)
+{
+    if (!m_GpuEnabled)
+        return;
+    vkCmdResetQueryPool(p_CmdBuffer, m_FrameSlots[m_CurrentSlot].queryPool, 0, MAX_GPU_SCOPES * 2);
+}
+
+void Profiler::beginGpuScope(const VkCommandBuffer p_CmdBuffer, const char* p_Name)
+{
+    if (!m_GpuEnabled)
+        return;
+    FrameSlot& l_Slot = m_FrameSlots[m_CurrentSlot];
+    if (l_Slot.scopes.size() >= MAX_GPU_SCOPES)
+        throw std::runtime_error("Too many GPU profiler scopes in a single frame");
+
+    const uint32_t l_Query = l_Slot.queryCount++;
+    vkCmdWriteTimestamp(p_CmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, l_Slot.queryPool, l_Query);
+    l_Slot.openScopes.push_back(static_cast<uint32_t>(l_Slot.scopes.size()));
+    l_Slot.scopes.push_back({ p_Name, l_Query, l_Query });
+}
+
+void Profiler::endGpuScope(const VkCommandBuffer p_CmdBuffer)
+{
+    if (!m_GpuEnabled)
+        return;
+    FrameSlot& l_Slot = m_FrameSlots[m_CurrentSlot];
+    if (l_Slot.openScopes.empty())
+        return;
+
+    const uint32_t l_Query = l_Slot.queryCount++;
+    vkCmdWriteTimestamp(p_CmdBuffer, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, l_Slot.queryPool, l_Query);
+    l_Slot.scopes[l_Slot.openScopes.back()].endQuery = l_Query;
+    l_Slot.openScopes.pop_back();
+}
+
+void Profiler::startCapture()
+{
+    m_TraceEvents.clear();
+    m_Capturing = true;
+}
+
+void Profiler::stopCapture(const std::string_view p_Path)
+{
+    if (!m_Capturing)
+        return;
+    m_Capturing = false;
+    writeChromeTrace(p_Path);
+    m_TraceEvents.clear();
+}
+
+void Profiler::setThreadUtilization(const std::span<const float> p_Utilization)
+{
+    m_ThreadUtilization.resize(p_Utilization.size());
+    for (size_t i = 0; i < p_Utilization.size(); i++)
+        m_ThreadUtilization[i].addSample(p_Utilization[i] * 100.0);
+}
+
+void Profiler::drawImgui()
+{
+    ImGui::Begin("Profiler");
+
+    drawStatsTable("CPU", m_CpuScopes);
+    if (m_GpuEnabled)
+        drawStatsTable("GPU", m_GpuScopes);
+    else
+        ImGui::TextUnformatted("GPU timestamps are not supported on the graphics queue");
+
+    if (!m_ThreadUtilization.empty())
+    {
+        ImGui::SeparatorText("Job threads");
+        if (ImGui::BeginTable("Job threads", 3, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        {
+            ImGui::TableSetupColumn("Thread");
+            ImGui::TableSetupColumn("Busy avg (%)");
+            ImGui::TableSetupColumn("Last");
+            ImGui::TableHeadersRow();
+            for (size_t i = 0; i < m_ThreadUtilization.size(); i++)
+            {
+                ImGui::TableNextRow();
+                ImGui::TableNextColumn();
+                if (i == 0)
+                    ImGui::TextUnformatted("Main");
+                else
+                    ImGui::Text("Worker %zu", i);
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", m_ThreadUtilization[i].getAverage());
+                ImGui::TableNextColumn();
+                ImGui::Text("%.1f", m_ThreadUtilization[i].getLast());
+            }
+            ImGui::EndTable();
+        }
+    }
+
+    ImGui::Separator();
+    if (!m_Capturing)
+    {
+        if (ImGui::Button("Start trace capture"))
+            startCapture();
+    }
+    else
+    {
+        ImGui::Text("Capturing: %zu events", m_TraceEvents.size());
+        if (ImGui::Button("Stop and save"))
+            stopCapture(m_CapturePath);
+    }
+    ImGui::SameLine();
+    ImGui::TextUnformatted(m_CapturePath.c_str());
+
+    ImGui::End();
+}
+
+double Profiler::nowUs() const
+{
+    return std::chrono::duration<double, std::micro>(std::chrono::steady_clock::now() - m_Epoch).count();
+}
+
+ScopeStats& Profiler::findStats(std::vector<Scope>& p_Scopes, const char* p_Name)
+{
+    for (Scope& l_Scope : p_Scopes)
+    {
+        if (l_Scope.name == p_Name || std::strcmp(l_Scope.name, p_Name) == 0)
+            return l_Scope.stats;
+    }
+    return p_Scopes.emplace_back(Scope{ p_Name, {} }).stats;
+}
+
+void Profiler::recordTraceEvent(const char* p_Name, const double p_StartUs, const double p_DurationUs, const bool p_IsGpu)
+{
+    if (!m_Capturing || m_TraceEvents.size() >= MAX_TRACE_EVENTS)
+        return;
+    m_TraceEvents.push_back({ p_Name, p_StartUs, p_DurationUs, p_IsGpu });
+}
+
+void Profiler::writeChromeTrace(const std::string_view p_Path) const
+{
+    std::ofstream l_File{ std::string{p_Path} };
+    if (!l_File.is_open())
+        throw std::runtime_error("Failed to open trace file " + std::string{p_Path});
+
+    l_File << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    l_File << R"({"name":"thread_name","ph":"M","pid":1,"tid":1,"args":{"name":"CPU"}},)" << "\n";
+    l_File << R"({"name":"thread_name","ph":"M","pid":1,"tid":2,"args":{"name":"GPU"}})";
+    for (const TraceEvent& l_Event : m_TraceEvents)
+    {
+        l_File << ",\n{\"name\":\"" << l_Event.name << "\",\"cat\":\"" << (l_Event.isGpu ? "gpu" : "cpu")
+            << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << (l_Event.isGpu ? 2 : 1)
+            << ",\"ts\":" << l_Event.startUs << ",\"dur\":" << l_Event.durationUs << "}";
+    }
+    l_File << "\n]}\n";
+}
+
+void Profiler::drawStatsTable(const char* p_Label, const std::vector<Scope>& p_Scopes)
+{
+    ImGui::SeparatorText(p_Label);
+    if (!ImGui::BeginTable(p_Label, 5, ImGuiTableFlags_Borders | ImGuiTableFlags_RowBg))
+        return;
+
+    ImGui::TableSetupColumn("Scope");
+    ImGui::TableSetupColumn("Avg (ms)");
+    ImGui::TableSetupColumn("P50");
+    ImGui::TableSetupColumn("P95");
+    ImGui::TableSetupColumn("P99");
+    ImGui::TableHeadersRow();
+    for (const Scope& l_Scope : p_Scopes)
+    {
+        ImGui::TableNextRow();
+        ImGui::TableNextColumn();
+        ImGui::TextUnformatted(l_Scope.name);
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", l_Scope.stats.getAverage());
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", l_Scope.stats.getPercentile(0.50));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", l_Scope.stats.getPercentile(0.95));
+        ImGui::TableNextColumn();
+        ImGui::Text("%.3f", l_Scope.stats.getPercentile(0.99));
+    }
+    ImGui::EndTable();
+}
+
+ProfileScope::ProfileScope(Profiler& p_Profiler, const char* p_Name)
+    : m_Profiler(p_Profiler)
+{
+    m_Profiler.beginCpuScope(p_Name);
+}
+
+ProfileScope::~ProfileScope()
+{
+    m_Profiler.endCpuScope();
+}
+
+GpuProfileScope::GpuProfileScope(Profiler& p_Profiler, const VkCommandBuffer p_CmdBuffer, const char* p_Name)
+    : m_Profiler(p_Profiler), m_CmdBuffer(p_CmdBuffer)
+{
+    m_Profiler.beginGpuScope(m_CmdBuffer, p_Name);
+}
+
+GpuProfileScope::~GpuProfileScope()
+{
+    m_Profiler.endGpuScope(m_CmdBuffer);
+}
@@ -0,0 +1,153 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <string>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+class ScopeStats
+{
+public:
+    void addSample(double p_Ms);
+
+    [[nodiscard]] double getAverage() const;
+    [[nodiscard]] double getPercentile(double p_Percentile) const;
+    [[nodiscard]] double getLast() const;
+    [[nodiscard]] uint32_t getSampleCount() const { return m_Count; }
+
+private:
+    static constexpr uint32_t WINDOW_SIZE = 240;
+
+    std::array<double, WINDOW_SIZE> m_Samples{};
+    uint32_t m_Count = 0;
+    uint32_t m_Next = 0;
+};
+
+// Scope names must outlive the profiler, string literals are expected
+class Profiler
+{
+public:
+    static constexpr uint32_t MAX_GPU_SCOPES = 32;
+    static constexpr uint32_t MAX_CPU_DEPTH = 16;
+    static constexpr size_t MAX_TRACE_EVENTS = 1 << 20;
+
+    void init(ResourceID p_DeviceID, uint32_t p_QueueFamilyIndex, uint32_t p_FramesInFlight);
+    void free();
+
+    // Must be called once the fence of the slot has been waited on, resolves the queries it recorded last time
+    void beginFrame(uint32_t p_FrameSlot);
+    void markSubmitted();
+
+    void beginCpuScope(const char* p_Name);
+    void endCpuScope();
+
+    // Must be recorded outside of a render pass, before any GPU scope of the frame
+    void resetGpuQueries(VkCommandBuffer p_CmdBuffer);
+    void beginGpuScope(VkCommandBuffer p_CmdBuffer, const char* p_Name);
+    void endGpuScope(VkCommandBuffer p_CmdBuffer);
+
+    void startCapture();
+    void stopCapture(std::string_view p_Path);
+    [[nodiscard]] bool isCapturing() const { return m_Capturing; }
+
+    // Busy fraction of every job system thread over the last frame, thread 0 is the main thread
+    void setThreadUtilization(std::span<const float> p_Utilization);
+
+    void drawImgui();
+
+private:
+    struct Scope
+    {
+        const char* name;
+        ScopeStats stats;
+    };
+
+    struct GpuScope
+    {
+        const char* name;
+        uint32_t beginQuery;
+        uint32_t endQuery;
+    };
+
+    struct FrameSlot
+    {
+        VkQueryPool queryPool = VK_NULL_HANDLE;
+        std::vector<GpuScope> scopes{};
+        std::vector<uint32_t> openScopes{};
+        uint32_t queryCount = 0;
+        double submitUs = 0.0;
+    };
+
+    struct TraceEvent
+    {
+        const char* name;
+        double startUs;
+        double durationUs;
+        bool isGpu;
+    };
+
+    struct OpenCpuScope
+    {
+        const char* name;
+        double startUs;
+    };
+
+    [[nodiscard]] double nowUs() const;
+    static ScopeStats& findStats(std::vector<Scope>& p_Scopes, const char* p_Name);
+    void recordTraceEvent(const char* p_Name, double p_StartUs, double p_DurationUs, bool p_IsGpu);
+    void writeChromeTrace(std::string_view p_Path) const;
+    static void drawStatsTable(const char* p_Label, const std::vector<Scope>& p_Scopes);
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    bool m_GpuEnabled = false;
+    double m_TimestampPeriodNs = 1.0;
+    uint64_t m_TimestampMask = ~0ULL;
+
+    std::vector<FrameSlot> m_FrameSlots{};
+    uint32_t m_CurrentSlot = 0;
+    double m_LastGpuEndUs = 0.0;
+
+    std::array<OpenCpuScope, MAX_CPU_DEPTH> m_CpuStack{};
+    uint32_t m_CpuDepth = 0;
+
+    std::vector<Scope> m_CpuScopes{};
+    std::vector<Scope> m_GpuScopes{};
+    std::vector<ScopeStats> m_ThreadUtilization{};
+
+    std::chrono::steady_clock::time_point m_Epoch{};
+
+    bool m_Capturing = false;
+    std::vector<TraceEvent> m_TraceEvents{};
+    std::string m_CapturePath = "profile_trace.json";
+};
+
+class ProfileScope
+{
+public:
+    ProfileScope(Profiler& p_Profiler, const char* p_Name);
+    ~ProfileScope();
+
+    ProfileScope(const ProfileScope&) = delete;
+    ProfileScope& operator=(const ProfileScope&) = delete;
+
+private:
+    Profiler& m_Profiler;
+};
+
+class GpuProfileScope
+{
+public:
+    GpuProfileScope(Profiler& p_Profiler, VkCommandBuffer p_CmdBuffer, const char* p_Name);
+    ~GpuProfileScope();
+
+    GpuProfileScope(const GpuProfileScope&) = delete;
+    GpuProfileScope& operator=(const GpuProfileScope&) = delete;
+
+private:
+    Profiler& m_Profiler;
+    VkCommandBuffer m_CmdBuffer;
+};
@@ -0,0 +1,688 @@
+#include "render_graph.hpp"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+#include <string>
+
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+namespace
+{
+    struct UsageInfo
+    {
+        VkPipelineStageFlags stages;
+        VkAccessFlags readAccess;
+        VkAccessFlags writeAccess;
+        VkImageLayout layout;
+        VkImageUsageFlags imageUsage;
+    };
+
+    UsageInfo getUsageInfo(const RenderGraphUsage p_Usage)
+    {
+        switch (p_Usage)
+        {
+        case RenderGraphUsage::COLOR_ATTACHMENT:
+            return { VK_PIPELINE_STAGE_COLOR_ATTACHMENT_OUTPUT_BIT, VK_ACCESS_COLOR_ATTACHMENT_READ_BIT, VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT,
+                VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_COLOR_ATTACHMENT_BIT };
+        case RenderGraphUsage::DEPTH_ATTACHMENT:
+            return { VK_PIPELINE_STAGE_EARLY_FRAGMENT_TESTS_BIT | VK_PIPELINE_STAGE_LATE_FRAGMENT_TESTS_BIT, VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_READ_BIT,
+                VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL, VK_IMAGE_USAGE_DEPTH_STENCIL_ATTACHMENT_BIT };
+        case RenderGraphUsage::SAMPLED:
+            return { VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0,
+                VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL, VK_IMAGE_USAGE_SAMPLED_BIT };
+        case RenderGraphUsage::STORAGE_READ:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, 0, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+        case RenderGraphUsage::STORAGE_WRITE:
+            return { VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT, VK_ACCESS_SHADER_READ_BIT, VK_ACCESS_SHADER_WRITE_BIT, VK_IMAGE_LAYOUT_GENERAL, VK_IMAGE_USAGE_STORAGE_BIT };
+        case RenderGraphUsage::INDIRECT:
+            return { VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT, VK_ACCESS_INDIRECT_COMMAND_READ_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+        case RenderGraphUsage::VERTEX_INPUT:
+            return { VK_PIPELINE_STAGE_VERTEX_INPUT_BIT, VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT | VK_ACCESS_INDEX_READ_BIT, 0, VK_IMAGE_LAYOUT_UNDEFINED, 0 };
+        case RenderGraphUsage::TRANSFER_SRC:
+            return { VK_PIPELINE_STAGE_TRANSFER_BIT, VK_ACCESS_TRANSFER_READ_BIT, 0, VK_IMAGE_LAYOUT_TRANSFER_SRC_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_SRC_BIT };
+        case RenderGraphUsage::TRANSFER_DST:
+            return { VK_PIPELINE_STAGE_TRANSFER_BIT, 0, VK_ACCESS_TRANSFER_WRITE_BIT, VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, VK_IMAGE_USAGE_TRANSFER_DST_BIT };
+        }
+        throw std::runtime_error("Unknown render graph usage " + std::to_string(static_cast<uint32_t>(p_Usage)));
+    }
+
+    constexpr VkAccessFlags WRITE_ACCESS = VK_ACCESS_SHADER_WRITE_BIT | VK_ACCESS_COLOR_ATTACHMENT_WRITE_BIT | VK_ACCESS_DEPTH_STENCIL_ATTACHMENT_WRITE_BIT |
+        VK_ACCESS_TRANSFER_WRITE_BIT | VK_ACCESS_HOST_WRITE_BIT | VK_ACCESS_MEMORY_WRITE_BIT;
+
+    bool isSameAttachment(const VkAttachmentDescription& p_Left, const VkAttachmentDescription& p_Right)
+    {
+        return p_Left.format == p_Right.format && p_Left.loadOp == p_Right.loadOp && p_Left.storeOp == p_Right.storeOp &&
+            p_Left.initialLayout == p_Right.initialLayout && p_Left.finalLayout == p_Right.finalLayout;
+    }
+}
+
+RenderGraphPass& RenderGraphPass::read(const RenderGraphResource p_Resource, const RenderGraphUsage p_Usage)
+{
+    m_Accesses.push_back({ p_Resource, p_Usage, false });
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::write(const RenderGraphResource p_Resource, const RenderGraphUsage p_Usage)
+{
+    if (getUsageInfo(p_Usage).writeAccess == 0)
+        throw std::runtime_error(std::string{ m_Name } + " declares a write through a read only usage");
+    m_Accesses.push_back({ p_Resource, p_Usage, true });
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::colorAttachment(const RenderGraphResource p_Resource, const VkAttachmentLoadOp p_LoadOp, const VkClearColorValue p_Clear)
+{
+    VkClearValue l_Clear{};
+    l_Clear.color = p_Clear;
+    m_ColorAttachments.push_back({ p_Resource, p_LoadOp, l_Clear });
+    if (p_LoadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+        read(p_Resource, RenderGraphUsage::COLOR_ATTACHMENT);
+    return write(p_Resource, RenderGraphUsage::COLOR_ATTACHMENT);
+}
+
+RenderGraphPass& RenderGraphPass::depthAttachment(const RenderGraphResource p_Resource, const VkAttachmentLoadOp p_LoadOp, const VkClearDepthStencilValue p_Clear)
+{
+    VkClearValue l_Clear{};
+    l_Clear.depthStencil = p_Clear;
+    m_DepthAttachment = Attachment{ p_Resource, p_LoadOp, l_Clear };
+    if (p_LoadOp == VK_ATTACHMENT_LOAD_OP_LOAD)
+        read(p_Resource, RenderGraphUsage::DEPTH_ATTACHMENT);
+    return write(p_Resource, RenderGraphUsage::DEPTH_ATTACHMENT);
+}
+
+RenderGraphPass& RenderGraphPass::sideEffects()
+{
+    m_SideEffects = true;
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::secondaryContents()
+{
+    m_SecondaryContents = true;
+    return *this;
+}
+
+RenderGraphPass& RenderGraphPass::execute(std::function<void(const RenderGraphContext&)> p_Callback)
+{
+    m_Callback = std::move(p_Callback);
+    return *this;
+}
+
+bool RenderGraph::TransientKey::operator==(const TransientKey& p_Other) const
+{
+    return format == p_Other.format && extent.width == p_Other.extent.width && extent.height == p_Other.extent.height && aspect == p_Other.aspect &&
+        usage == p_Other.usage && firstPass == p_Other.firstPass && lastPass == p_Other.lastPass;
+}
+
+void RenderGraph::init(const ResourceID p_DeviceID, DeferredReleaseQueue& p_DeferredRelease, Profiler& p_Profiler)
+{
+    m_DeviceID = p_DeviceID;
+    m_DeferredRelease = &p_DeferredRelease;
+    m_Profiler = &p_Profiler;
+}
+
+void RenderGraph::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    const VkDevice l_Device = *VulkanContext::getDevice(m_DeviceID);
+    for (const TransientImage& l_Transient : m_Transients)
+    {
+        vkDestroyImageView(l_Device, l_Transient.view, nullptr);
+        vkDestroyImage(l_Device, l_Transient.image, nullptr);
+    }
+    for (const MemoryBlock& l_Block : m_Blocks)
+        vkFreeMemory(l_Device, l_Block.memory, nullptr);
+    for (const FramebufferEntry& l_Entry : m_Framebuffers)
+        vkDestroyFramebuffer(l_Device, l_Entry.framebuffer, nullptr);
+    for (const RenderPassEntry& l_Entry : m_RenderPasses)
+        vkDestroyRenderPass(l_Device, l_Entry.renderPass, nullptr);
+
+    m_Transients.clear();
+    m_Blocks.clear();
+    m_PlanKeys.clear();
+    m_Framebuffers.clear();
+    m_RenderPasses.clear();
+    reset();
+    m_DeviceID = UINT32_MAX;
+}
+
+void RenderGraph::reset()
+{
+    m_Resources.clear();
+    m_Passes.clear();
+    m_KeptPasses.clear();
+}
+
+RenderGraphResource RenderGraph::importImage(const VkImage p_Image, const VkImageView p_View, const VkFormat p_Format, const VkExtent2D p_Extent, const VkImageAspectFlags p_Aspect,
+    const RenderGraphState& p_Initial, const VkImageLayout p_FinalLayout)
+{
+    Resource& l_Resource = m_Resources.emplace_back();
+    l_Resource.isImage = true;
+    l_Resource.exported = p_FinalLayout != VK_IMAGE_LAYOUT_UNDEFINED;
+    l_Resource.image = p_Image;
+    l_Resource.view = p_View;
+    l_Resource.format = p_Format;
+    l_Resource.extent = p_Extent;
+    l_Resource.aspect = p_Aspect;
+    l_Resource.finalLayout = p_FinalLayout;
+    l_Resource.writeStages = p_Initial.stages;
+    l_Resource.writeAccess = p_Initial.access;
+    l_Resource.layout = p_Initial.layout;
+    return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::importBuffer(const VkBuffer p_Buffer, const RenderGraphState& p_Initial, const bool p_Exported)
+{
+    Resource& l_Resource = m_Resources.emplace_back();
+    l_Resource.exported = p_Exported;
+    l_Resource.buffer = p_Buffer;
+    l_Resource.writeStages = p_Initial.stages;
+    l_Resource.writeAccess = p_Initial.access;
+    return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+RenderGraphResource RenderGraph::createImage(const VkFormat p_Format, const VkExtent2D p_Extent, const VkImageAspectFlags p_Aspect)
+{
+    Resource& l_Resource = m_Resources.emplace_back();
+    l_Resource.isImage = true;
+    l_Resource.transient = true;
+    l_Resource.format = p_Format;
+    l_Resource.extent = p_Extent;
+    l_Resource.aspect = p_Aspect;
+    return static_cast<RenderGraphResource>(m_Resources.size() - 1);
+}
+
+RenderGraphPass& RenderGraph::addPass(const char* p_Name)
+{
+    return m_Passes.emplace_back(RenderGraphPass{ p_Name });
+}
+
+void RenderGraph::execute(VulkanCommandBuffer& p_CmdBuffer)
+{
+    cullPasses();
+
+    for (uint32_t i = 0; i < m_KeptPasses.size(); i++)
+    {
+        for (const RenderGraphPass::Access& l_Access : m_Passes[m_KeptPasses[i]].m_Accesses)
+        {
+            Resource& l_Resource = m_Resources[l_Access.resource];
+            l_Resource.firstPass = std::min(l_Resource.firstPass, i);
+            l_Resource.lastPass = std::max(l_Resource.lastPass, i);
+            l_Resource.usage |= getUsageInfo(l_Access.usage).imageUsage;
+        }
+    }
+    planTransients();
+
+    m_Stats.passCount = static_cast<uint32_t>(m_KeptPasses.size());
+    m_Stats.culledPasses = static_cast<uint32_t>(m_Passes.size() - m_KeptPasses.size());
+    m_Stats.barrierCount = 0;
+
+    BarrierBatch l_Batch{};
+    for (uint32_t i = 0; i < m_KeptPasses.size(); i++)
+    {
+        const RenderGraphPass& l_Pass = m_Passes[m_KeptPasses[i]];
+        GpuProfileScope l_Scope{ *m_Profiler, *p_CmdBuffer, l_Pass.m_Name };
+
+        // Contents never survive, a transient starts from whatever last used its memory
+        for (const RenderGraphPass::Access& l_Access : l_Pass.m_Accesses)
+        {
+            Resource& l_Resource = m_Resources[l_Access.resource];
+            if (l_Resource.transient && l_Resource.firstPass == i)
+            {
+                const MemoryBlock& l_Block = m_Blocks[m_Transients[l_Resource.transientIndex].block];
+                l_Resource.writeStages = l_Block.stages;
+                l_Resource.writeAccess = l_Block.access;
+                l_Resource.readStages = 0;
+                l_Resource.visibleAccess = 0;
+                l_Resource.layout = VK_IMAGE_LAYOUT_UNDEFINED;
+            }
+        }
+        addBarriers(l_Pass, l_Batch);
+        flushBarriers(*p_CmdBuffer, l_Batch);
+
+        if (!l_Pass.m_ColorAttachments.empty() || l_Pass.m_DepthAttachment)
+            recordRasterPass(p_CmdBuffer, l_Pass, i);
+        else if (l_Pass.m_Callback)
+            l_Pass.m_Callback({ p_CmdBuffer });
+
+        // The memory goes to the next transient sharing it, which has to wait for everything this one did
+        for (const RenderGraphPass::Access& l_Access : l_Pass.m_Accesses)
+        {
+            const Resource& l_Resource = m_Resources[l_Access.resource];
+            if (l_Resource.transient && l_Resource.lastPass == i)
+            {
+                MemoryBlock& l_Block = m_Blocks[m_Transients[l_Resource.transientIndex].block];
+                l_Block.stages = l_Resource.writeStages | l_Resource.readStages;
+                l_Block.access = l_Resource.writeAccess;
+            }
+        }
+    }
+
+    // Whatever comes after the graph, presentation or the host, synchronizes on its own
+    for (Resource& l_Resource : m_Resources)
+    {
+        if (l_Resource.isImage && l_Resource.exported && l_Resource.layout != l_Resource.finalLayout)
+            transition(l_Resource, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0, l_Resource.finalLayout, true, l_Batch);
+    }
+    flushBarriers(*p_CmdBuffer, l_Batch);
+}
+
+void RenderGraph::releaseFramebuffers()
+{
+    if (m_Framebuffers.empty())
+        return;
+
+    std::vector<VkFramebuffer> l_Framebuffers{};
+    for (const FramebufferEntry& l_Entry : m_Framebuffers)
+        l_Framebuffers.push_back(l_Entry.framebuffer);
+    m_Framebuffers.clear();
+    m_DeferredRelease->release([l_Framebuffers](VulkanDevice& p_Device)
+    {
+        for (const VkFramebuffer l_Framebuffer : l_Framebuffers)
+            vkDestroyFramebuffer(*p_Device, l_Framebuffer, nullptr);
+    });
+}
+
+void RenderGraph::cullPasses()
+{
+    // Walking backwards, a pass is needed when it writes something a needed pass reads or the graph exports
+    std::vector<bool> l_Needed(m_Resources.size());
+    for (uint32_t i = 0; i < m_Resources.size(); i++)
+        l_Needed[i] = m_Resources[i].exported;
+
+    m_KeptPasses.clear();
+    for (uint32_t i = static_cast<uint32_t>(m_Passes.size()); i-- > 0;)
+    {
+        const RenderGraphPass& l_Pass = m_Passes[i];
+        bool l_Keep = l_Pass.m_SideEffects;
+        for (const RenderGraphPass::Access& l_Access : l_Pass.m_Accesses)
+            l_Keep = l_Keep || (l_Access.write && l_Needed[l_Access.resource]);
+        if (!l_Keep)
+            continue;
+
+        m_KeptPasses.push_back(i);
+        for (const RenderGraphPass::Access& l_Access : l_Pass.m_Accesses)
+        {
+            if (!l_Access.write)
+                l_Needed[l_Access.resource] = true;
+        }
+    }
+    std::ranges::reverse(m_KeptPasses);
+}
+
+void RenderGraph::planTransients()
+{
+    std::vector<TransientKey> l_Keys{};
+    std::vector<RenderGraphResource> l_Used{};
+    for (uint32_t i = 0; i < m_Resources.size(); i++)
+    {
+        const Resource& l_Resource = m_Resources[i];
+        if (!l_Resource.transient || l_Resource.firstPass == UINT32_MAX)
+            continue;
+        l_Keys.push_back({ l_Resource.format, l_Resource.extent, l_Resource.aspect, l_Resource.usage, l_Resource.firstPass, l_Resource.lastPass });
+        l_Used.push_back(i);
+    }
+
+    if (l_Keys != m_PlanKeys)
+    {
+        releaseTransients();
+        m_PlanKeys = l_Keys;
+
+        const VkDevice l_Device = *VulkanContext::getDevice(m_DeviceID);
+        m_Transients.resize(l_Keys.size());
+        std::vector<VkMemoryRequirements> l_Requirements(l_Keys.size());
+        for (uint32_t i = 0; i < l_Keys.size(); i++)
+        {
+            VkImageCreateInfo l_ImageInfo{ VK_STRUCTURE_TYPE_IMAGE_CREATE_INFO };
+            l_ImageInfo.imageType = VK_IMAGE_TYPE_2D;
+            l_ImageInfo.format = l_Keys[i].format;
+            l_ImageInfo.extent = { l_Keys[i].extent.width, l_Keys[i].extent.height, 1 };
+            l_ImageInfo.mipLevels = 1;
+            l_ImageInfo.arrayLayers = 1;
+            l_ImageInfo.samples = VK_SAMPLE_COUNT_1_BIT;
+            l_ImageInfo.tiling = VK_IMAGE_TILING_OPTIMAL;
+            l_ImageInfo.usage = l_Keys[i].usage;
+            l_ImageInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+            l_ImageInfo.initialLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+            if (vkCreateImage(l_Device, &l_ImageInfo, nullptr, &m_Transients[i].image) != VK_SUCCESS)
+                throw std::runtime_error("Failed to create a transient render graph image");
+            vkGetImageMemoryRequirements(l_Device, m_Transients[i].image, &l_Requirements[i]);
+        }
+
+        // Largest first, each image joins the first block whose images all live in other passes
+        std::vector<uint32_t> l_Order(l_Keys.size());
+        std::iota(l_Order.begin(), l_Order.end(), 0);
+        std::ranges::stable_sort(l_Order, [&l_Requirements](const uint32_t p_Left, const uint32_t p_Right) { return l_Requirements[p_Left].size > l_Requirements[p_Right].size; });
+        for (const uint32_t l_Transient : l_Order)
+        {
+            const VkMemoryRequirements& l_Req = l_Requirements[l_Transient];
+            const auto l_Fits = [&](const MemoryBlock& p_Block)
+            {
+                if ((p_Block.typeBits & l_Req.memoryTypeBits) == 0)
+                    return false;
+                return std::ranges::all_of(p_Block.transients, [&](const uint32_t p_Other)
+                {
+                    return l_Keys[p_Other].lastPass < l_Keys[l_Transient].firstPass || l_Keys[l_Transient].lastPass < l_Keys[p_Other].firstPass;
+                });
+            };
+            auto l_Block = std::ranges::find_if(m_Blocks, l_Fits);
+            if (l_Block == m_Blocks.end())
+                l_Block = m_Blocks.emplace(m_Blocks.end());
+            l_Block->size = std::max(l_Block->size, l_Req.size);
+            l_Block->typeBits &= l_Req.memoryTypeBits;
+            l_Block->transients.push_back(l_Transient);
+            m_Transients[l_Transient].block = static_cast<uint32_t>(l_Block - m_Blocks.begin());
+        }
+
+        m_Stats.transientBytes = 0;
+        m_Stats.unaliasedBytes = 0;
+        for (MemoryBlock& l_Block : m_Blocks)
+        {
+            VkMemoryAllocateInfo l_AllocInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+            l_AllocInfo.allocationSize = l_Block.size;
+            l_AllocInfo.memoryTypeIndex = findMemoryType(l_Block.typeBits);
+            if (vkAllocateMemory(l_Device, &l_AllocInfo, nullptr, &l_Block.memory) != VK_SUCCESS)
+                throw std::runtime_error("Failed to allocate " + std::to_string(l_Block.size) + " bytes of transient render graph memory");
+            m_Stats.transientBytes += l_Block.size;
+
+            for (const uint32_t l_Transient : l_Block.transients)
+            {
+                TransientImage& l_Image = m_Transients[l_Transient];
+                vkBindImageMemory(l_Device, l_Image.image, l_Block.memory, 0);
+                m_Stats.unaliasedBytes += l_Requirements[l_Transient].size;
+
+                VkImageViewCreateInfo l_ViewInfo{ VK_STRUCTURE_TYPE_IMAGE_VIEW_CREATE_INFO };
+                l_ViewInfo.image = l_Image.image;
+                l_ViewInfo.viewType = VK_IMAGE_VIEW_TYPE_2D;
+                l_ViewInfo.format = l_Keys[l_Transient].format;
+                l_ViewInfo.subresourceRange = { l_Keys[l_Transient].aspect, 0, 1, 0, 1 };
+                if (vkCreateImageView(l_Device, &l_ViewInfo, nullptr, &l_Image.view) != VK_SUCCESS)
+                    throw std::runtime_error("Failed to create a transient render graph image view");
+            }
+        }
+        m_Stats.transientImages = static_cast<uint32_t>(m_Transients.size());
+    }
+
+    for (uint32_t i = 0; i < l_Used.size(); i++)
+    {
+        Resource& l_Resource = m_Resources[l_Used[i]];
+        l_Resource.transientIndex = i;
+        l_Resource.image = m_Transients[i].image;
+        l_Resource.view = m_Transients[i].view;
+    }
+}
+
+void RenderGraph::releaseTransients()
+{
+    // Framebuffers may hold the views
+    releaseFramebuffers();
+    if (m_Transients.empty() && m_Blocks.empty())
+        return;
+
+    m_DeferredRelease->release([l_Transients = std::move(m_Transients), l_Blocks = std::move(m_Blocks)](VulkanDevice& p_Device)
+    {
+        for (const TransientImage& l_Transient : l_Transients)
+        {
+            vkDestroyImageView(*p_Device, l_Transient.view, nullptr);
+            vkDestroyImage(*p_Device, l_Transient.image, nullptr);
+        }
+        for (const MemoryBlock& l_Block : l_Blocks)
+            vkFreeMemory(*p_Device, l_Block.memory, nullptr);
+    });
+    m_Transients.clear();
+    m_Blocks.clear();
+    m_PlanKeys.clear();
+}
+
+uint32_t RenderGraph::findMemoryType(const uint32_t p_TypeBits) const
+{
+    VkPhysicalDeviceMemoryProperties l_Properties{};
+    vkGetPhysicalDeviceMemoryProperties(*VulkanContext::getDevice(m_DeviceID).getGPU(), &l_Properties);
+
+    // Device local when there is one, any allowed type otherwise
+    uint32_t l_Fallback = UINT32_MAX;
+    for (uint32_t i = 0; i < l_Properties.memoryTypeCount; i++)
+    {
+        if ((p_TypeBits & (1U << i)) == 0)
+            continue;
+        if ((l_Properties.memoryTypes[i].propertyFlags & VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT) != 0)
+            return i;
+        l_Fallback = std::min(l_Fallback, i);
+    }
+    if (l_Fallback == UINT32_MAX)
+        throw std::runtime_error("No memory type can hold the transient render graph images");
+    return l_Fallback;
+}
+
+void RenderGraph::addBarriers(const RenderGraphPass& p_Pass, BarrierBatch& p_Batch)
+{
+    // Every usage of a resource within the pass is merged into a single transition
+    std::vector<bool> l_Done(p_Pass.m_Accesses.size());
+    for (uint32_t i = 0; i < p_Pass.m_Accesses.size(); i++)
+    {
+        if (l_Done[i])
+            continue;
+
+        const RenderGraphPass::Access& l_First = p_Pass.m_Accesses[i];
+        const UsageInfo l_FirstInfo = getUsageInfo(l_First.usage);
+        VkPipelineStageFlags l_Stages = l_FirstInfo.stages;
+        VkAccessFlags l_Access = l_FirstInfo.readAccess | (l_First.write ? l_FirstInfo.writeAccess : 0);
+        bool l_Write = l_First.write;
+        for (uint32_t j = i + 1; j < p_Pass.m_Accesses.size(); j++)
+        {
+            const RenderGraphPass::Access& l_Other = p_Pass.m_Accesses[j];
+            if (l_Other.resource != l_First.resource)
+                continue;
+            const UsageInfo l_OtherInfo = getUsageInfo(l_Other.usage);
+            if (m_Resources[l_First.resource].isImage && l_OtherInfo.layout != l_FirstInfo.layout)
+                throw std::runtime_error(std::string{ p_Pass.m_Name } + " uses an image in two layouts at once");
+            l_Stages |= l_OtherInfo.stages;
+            l_Access |= l_OtherInfo.readAccess | (l_Other.write ? l_OtherInfo.writeAccess : 0);
+            l_Write = l_Write || l_Other.write;
+            l_Done[j] = true;
+        }
+        transition(m_Resources[l_First.resource], l_Stages, l_Access, l_FirstInfo.layout, l_Write, p_Batch);
+    }
+}
+
+void RenderGraph::transition(Resource& p_Resource, const VkPipelineStageFlags p_Stages, const VkAccessFlags p_Access, const VkImageLayout p_Layout, const bool p_Write, BarrierBatch& p_Batch)
+{
+    const bool l_LayoutChange = p_Resource.isImage && p_Resource.layout != p_Layout;
+    VkPipelineStageFlags l_SrcStages = 0;
+    VkAccessFlags l_SrcAccess = 0;
+    bool l_Needed = false;
+    if (p_Write || l_LayoutChange)
+    {
+        // Earlier writes have to be made available, earlier reads only have to be done
+        l_SrcStages = p_Resource.writeStages | p_Resource.readStages;
+        l_SrcAccess = p_Resource.writeAccess;
+        l_Needed = l_SrcStages != 0 || l_LayoutChange;
+    }
+    else
+    {
+        // Reads after reads need nothing once the last write is visible to them
+        l_SrcStages = p_Resource.writeStages;
+        l_SrcAccess = p_Resource.writeAccess;
+        l_Needed = l_SrcStages != 0 && ((p_Stages & ~p_Resource.readStages) != 0 || (p_Access & ~p_Resource.visibleAccess) != 0);
+    }
+
+    if (l_Needed)
+    {
+        p_Batch.srcStages |= l_SrcStages;
+        p_Batch.dstStages |= p_Stages;
+        if (p_Resource.isImage)
+        {
+            VkImageMemoryBarrier l_Barrier{ VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+            l_Barrier.srcAccessMask = l_SrcAccess;
+            l_Barrier.dstAccessMask = p_Access;
+            l_Barrier.oldLayout = p_Resource.layout;
+            l_Barrier.newLayout = p_Layout;
+            l_Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            l_Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+            l_Barrier.image = p_Resource.image;
+            l_Barrier.subresourceRange = { p_Resource.aspect, 0, VK_REMAINING_MIP_LEVELS, 0, VK_REMAINING_ARRAY_LAYERS };
+            p_Batch.images.push_back(l_Barrier);
+        }
+        else
+        {
+            p_Batch.memory.srcAccessMask |= l_SrcAccess;
+            p_Batch.memory.dstAccessMask |= p_Access;
+            p_Batch.hasMemory = true;
+        }
+    }
+
+    if (p_Write)
+    {
+        p_Resource.writeStages = p_Stages;
+        p_Resource.writeAccess = p_Access & WRITE_ACCESS;
+        p_Resource.readStages = 0;
+        p_Resource.visibleAccess = 0;
+    }
+    else if (l_LayoutChange)
+    {
+        p_Resource.readStages = p_Stages;
+        p_Resource.visibleAccess = p_Access;
+    }
+    else
+    {
+        p_Resource.readStages |= p_Stages;
+        p_Resource.visibleAccess |= p_Access;
+    }
+    if (p_Resource.isImage && p_Layout != VK_IMAGE_LAYOUT_UNDEFINED)
+        p_Resource.layout = p_Layout;
+}
+
+void RenderGraph::flushBarriers(const VkCommandBuffer p_CmdBuffer, BarrierBatch& p_Batch)
+{
+    if (p_Batch.images.empty() && !p_Batch.hasMemory)
+        return;
+
+    const VkPipelineStageFlags l_SrcStages = p_Batch.srcStages != 0 ? p_Batch.srcStages : VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT;
+    vkCmdPipelineBarrier(p_CmdBuffer, l_SrcStages, p_Batch.dstStages, 0, p_Batch.hasMemory ? 1 : 0, &p_Batch.memory, 0, nullptr,
+        static_cast<uint32_t>(p_Batch.images.size()), p_Batch.images.data());
+    m_Stats.barrierCount++;
+
+    p_Batch.srcStages = 0;
+    p_Batch.dstStages = 0;
+    p_Batch.memory.srcAccessMask = 0;
+    p_Batch.memory.dstAccessMask = 0;
+    p_Batch.images.clear();
+    p_Batch.hasMemory = false;
+}
+
+void RenderGraph::recordRasterPass(VulkanCommandBuffer& p_CmdBuffer, const RenderGraphPass& p_Pass, const uint32_t p_PassIndex)
+{
+    std::vector<const RenderGraphPass::Attachment*> l_Attachments{};
+    for (const RenderGraphPass::Attachment& l_Attachment : p_Pass.m_ColorAttachments)
+        l_Attachments.push_back(&l_Attachment);
+    if (p_Pass.m_DepthAttachment)
+        l_Attachments.push_back(&*p_Pass.m_DepthAttachment);
+
+    std::vector<VkAttachmentDescription> l_Descriptions{};
+    std::vector<VkImageView> l_Views{};
+    std::vector<VkClearValue> l_ClearValues{};
+    VkExtent2D l_Extent{ UINT32_MAX, UINT32_MAX };
+    for (const RenderGraphPass::Attachment* l_Attachment : l_Attachments)
+    {
+        Resource& l_Resource = m_Resources[l_Attachment->resource];
+        const bool l_Depth = p_Pass.m_DepthAttachment && l_Attachment == &*p_Pass.m_DepthAttachment;
+        const VkImageLayout l_Layout = l_Depth ? VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL : VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL;
+
+        // Contents are only stored when someone looks at them afterwards. An export right after its last pass
+        // happens in the render pass itself instead of a barrier of its own
+        const bool l_LastUse = l_Resource.lastPass == p_PassIndex;
+        const bool l_Store = l_Resource.exported || !l_LastUse;
+        VkAttachmentDescription l_Description{};
+        l_Description.format = l_Resource.format;
+        l_Description.samples = VK_SAMPLE_COUNT_1_BIT;
+        l_Description.loadOp = l_Attachment->loadOp;
+        l_Description.storeOp = l_Store ? VK_ATTACHMENT_STORE_OP_STORE : VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        l_Description.stencilLoadOp = VK_ATTACHMENT_LOAD_OP_DONT_CARE;
+        l_Description.stencilStoreOp = VK_ATTACHMENT_STORE_OP_DONT_CARE;
+        l_Description.initialLayout = l_Layout;
+        l_Description.finalLayout = l_Resource.exported && l_LastUse ? l_Resource.finalLayout : l_Layout;
+        l_Resource.layout = l_Description.finalLayout;
+
+        l_Descriptions.push_back(l_Description);
+        l_Views.push_back(l_Resource.view);
+        l_ClearValues.push_back(l_Attachment->clear);
+        l_Extent.width = std::min(l_Extent.width, l_Resource.extent.width);
+        l_Extent.height = std::min(l_Extent.height, l_Resource.extent.height);
+    }
+
+    const VkRenderPass l_RenderPass = getRenderPass(l_Descriptions, p_Pass.m_DepthAttachment.has_value());
+    const VkFramebuffer l_Framebuffer = getFramebuffer(l_RenderPass, l_Views, l_Extent);
+
+    VkRenderPassBeginInfo l_BeginInfo{ VK_STRUCTURE_TYPE_RENDER_PASS_BEGIN_INFO };
+    l_BeginInfo.renderPass = l_RenderPass;
+    l_BeginInfo.framebuffer = l_Framebuffer;
+    l_BeginInfo.renderArea = { { 0, 0 }, l_Extent };
+    l_BeginInfo.clearValueCount = static_cast<uint32_t>(l_ClearValues.size());
+    l_BeginInfo.pClearValues = l_ClearValues.data();
+    vkCmdBeginRenderPass(*p_CmdBuffer, &l_BeginInfo, p_Pass.m_SecondaryContents ? VK_SUBPASS_CONTENTS_SECONDARY_COMMAND_BUFFERS : VK_SUBPASS_CONTENTS_INLINE);
+    if (p_Pass.m_Callback)
+        p_Pass.m_Callback({ p_CmdBuffer, l_RenderPass, l_Framebuffer, l_Extent });
+    vkCmdEndRenderPass(*p_CmdBuffer);
+}
+
+VkRenderPass RenderGraph::getRenderPass(const std::vector<VkAttachmentDescription>& p_Attachments, const bool p_HasDepth)
+{
+    for (const RenderPassEntry& l_Entry : m_RenderPasses)
+    {
+        if (std::ranges::equal(l_Entry.attachments, p_Attachments, isSameAttachment))
+            return l_Entry.renderPass;
+    }
+
+    // Layout changes other than the export happen in barriers, so the render pass needs no dependencies of its own
+    const uint32_t l_ColorCount = static_cast<uint32_t>(p_Attachments.size()) - (p_HasDepth ? 1 : 0);
+    std::vector<VkAttachmentReference> l_ColorReferences{};
+    for (uint32_t i = 0; i < l_ColorCount; i++)
+        l_ColorReferences.push_back({ i, VK_IMAGE_LAYOUT_COLOR_ATTACHMENT_OPTIMAL });
+    const VkAttachmentReference l_DepthReference{ l_ColorCount, VK_IMAGE_LAYOUT_DEPTH_STENCIL_ATTACHMENT_OPTIMAL };
+
+    VkSubpassDescription l_Subpass{};
+    l_Subpass.pipelineBindPoint = VK_PIPELINE_BIND_POINT_GRAPHICS;
+    l_Subpass.colorAttachmentCount = l_ColorCount;
+    l_Subpass.pColorAttachments = l_ColorReferences.data();
+    l_Subpass.pDepthStencilAttachment = p_HasDepth ? &l_DepthReference : nullptr;
+
+    VkRenderPassCreateInfo l_RenderPassInfo{ VK_STRUCTURE_TYPE_RENDER_PASS_CREATE_INFO };
+    l_RenderPassInfo.attachmentCount = static_cast<uint32_t>(p_Attachments.size());
+    l_RenderPassInfo.pAttachments = p_Attachments.data();
+    l_RenderPassInfo.subpassCount = 1;
+    l_RenderPassInfo.pSubpasses = &l_Subpass;
+
+    VkRenderPass l_RenderPass;
+    if (vkCreateRenderPass(*VulkanContext::getDevice(m_DeviceID), &l_RenderPassInfo, nullptr, &l_RenderPass) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a render graph render pass");
+    m_RenderPasses.push_back({ p_Attachments, l_RenderPass });
+    return l_RenderPass;
+}
+
+VkFramebuffer RenderGraph::getFramebuffer(const VkRenderPass p_RenderPass, const std::vector<VkImageView>& p_Views, const VkExtent2D p_Extent)
+{
+    for (const FramebufferEntry& l_Entry : m_Framebuffers)
+    {
+        if (l_Entry.renderPass == p_RenderPass && l_Entry.views == p_Views && l_Entry.extent.width == p_Extent.width && l_Entry.extent.height == p_Extent.height)
+            return l_Entry.framebuffer;
+    }
+
+    VkFramebufferCreateInfo l_FramebufferInfo{ VK_STRUCTURE_TYPE_FRAMEBUFFER_CREATE_INFO };
+    l_FramebufferInfo.renderPass = p_RenderPass;
+    l_FramebufferInfo.attachmentCount = static_cast<uint32_t>(p_Views.size());
+    l_FramebufferInfo.pAttachments = p_Views.data();
+    l_FramebufferInfo.width = p_Extent.width;
+    l_FramebufferInfo.height = p_Extent.height;
+    l_FramebufferInfo.layers = 1;
+
+    VkFramebuffer l_Framebuffer;
+    if (vkCreateFramebuffer(*VulkanContext::getDevice(m_DeviceID), &l_FramebufferInfo, nullptr, &l_Framebuffer) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create a render graph framebuffer");
+    m_Framebuffers.push_back({ p_RenderPass, p_Views, p_Extent, l_Framebuffer });
+    return l_Framebuffer;
+}
@@ -0,0 +1,257 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <optional>
+#include <vector>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+#include "vulkan_command_buffer.hpp"
+#include "profiling/profiler.hpp"
+#include "resources/deferred_release_queue.hpp"
+
+// Image or buffer of the frame graph, only valid until the graph is reset
+using RenderGraphResource = uint32_t;
+
+// How a pass touches a resource, each usage maps to the stages, access and layout its barriers use
+enum class RenderGraphUsage : uint8_t
+{
+    COLOR_ATTACHMENT,
+    DEPTH_ATTACHMENT,
+    // Fragment and compute shaders
+    SAMPLED,
+    // Compute shaders, images are in the general layout
+    STORAGE_READ,
+    STORAGE_WRITE,
+    INDIRECT,
+    VERTEX_INPUT,
+    TRANSFER_SRC,
+    TRANSFER_DST
+};
+
+// Last use of a resource before the graph, imported resources start from it. Treated as a write, so the first use
+// in the graph always waits for it
+struct RenderGraphState
+{
+    VkPipelineStageFlags stages = 0;
+    VkAccessFlags access = 0;
+    VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+};
+
+struct RenderGraphContext
+{
+    VulkanCommandBuffer& cmdBuffer;
+    // Raster passes only, the render pass is already begun
+    VkRenderPass renderPass = VK_NULL_HANDLE;
+    VkFramebuffer framebuffer = VK_NULL_HANDLE;
+    VkExtent2D extent{};
+};
+
+struct RenderGraphStats
+{
+    uint32_t passCount = 0;
+    uint32_t culledPasses = 0;
+    uint32_t barrierCount = 0;
+    uint32_t transientImages = 0;
+    // Memory the transient images take with aliasing, and what they would take without
+    VkDeviceSize transientBytes = 0;
+    VkDeviceSize unaliasedBytes = 0;
+};
+
+class RenderGraph;
+
+// Declared in execution order. Passes that write nothing a later pass reads or the graph exports are culled
+class RenderGraphPass
+{
+public:
+    RenderGraphPass& read(RenderGraphResource p_Resource, RenderGraphUsage p_Usage);
+    RenderGraphPass& write(RenderGraphResource p_Resource, RenderGraphUsage p_Usage);
+    // A pass with attachments is a raster pass, the graph begins and ends its render pass around the callback
+    RenderGraphPass& colorAttachment(RenderGraphResource p_Resource, VkAttachmentLoadOp p_LoadOp, VkClearColorValue p_Clear = {});
+    RenderGraphPass& depthAttachment(RenderGraphResource p_Resource, VkAttachmentLoadOp p_LoadOp, VkClearDepthStencilValue p_Clear = { 1.0f, 0 });
+    // Kept even when nothing reads its results, for work the host or another queue consumes
+    RenderGraphPass& sideEffects();
+    // The render pass is begun for secondary command buffers, the callback may only execute them
+    RenderGraphPass& secondaryContents();
+    RenderGraphPass& execute(std::function<void(const RenderGraphContext&)> p_Callback);
+
+private:
+    friend class RenderGraph;
+
+    struct Access
+    {
+        RenderGraphResource resource;
+        RenderGraphUsage usage;
+        bool write;
+    };
+
+    struct Attachment
+    {
+        RenderGraphResource resource;
+        VkAttachmentLoadOp loadOp;
+        VkClearValue clear;
+    };
+
+    explicit RenderGraphPass(const char* p_Name) : m_Name(p_Name) {}
+
+    const char* m_Name;
+    std::vector<Access> m_Accesses{};
+    std::vector<Attachment> m_ColorAttachments{};
+    std::optional<Attachment> m_DepthAttachment{};
+    bool m_SideEffects = false;
+    bool m_SecondaryContents = false;
+    std::function<void(const RenderGraphContext&)> m_Callback{};
+};
+
+// Frame graph rebuilt every frame: passes declare what they read and write, the graph culls the passes nobody needs,
+// records every barrier and layout transition between them and begins render passes for the raster ones.
+// Transient images are created by the graph and images whose lifetimes don't overlap share memory. The plan is kept
+// while the graph keeps the same shape, so steady frames create nothing. Transients are shared by every frame in
+// flight, the first use in a frame waits for the last use of its memory in the previous one
+class RenderGraph
+{
+public:
+    void init(ResourceID p_DeviceID, DeferredReleaseQueue& p_DeferredRelease, Profiler& p_Profiler);
+    // The device must be idle
+    void free();
+
+    // Drops the passes and resources of the previous frame, transient memory and framebuffers are kept
+    void reset();
+
+    // Imported images are exported in p_FinalLayout at the end of the graph, UNDEFINED leaves them where the last pass did
+    [[nodiscard]] RenderGraphResource importImage(VkImage p_Image, VkImageView p_View, VkFormat p_Format, VkExtent2D p_Extent, VkImageAspectFlags p_Aspect,
+        const RenderGraphState& p_Initial, VkImageLayout p_FinalLayout = VK_IMAGE_LAYOUT_UNDEFINED);
+    // Exported buffers keep the passes writing them alive
+    [[nodiscard]] RenderGraphResource importBuffer(VkBuffer p_Buffer, const RenderGraphState& p_Initial, bool p_Exported = false);
+    // Usage flags come from the passes using it, contents don't survive the frame
+    [[nodiscard]] RenderGraphResource createImage(VkFormat p_Format, VkExtent2D p_Extent, VkImageAspectFlags p_Aspect);
+
+    // Only valid until the next pass is added
+    [[nodiscard]] RenderGraphPass& addPass(const char* p_Name);
+
+    // Transient images only exist once the graph has started executing
+    [[nodiscard]] VkImageView getImageView(RenderGraphResource p_Resource) const { return m_Resources[p_Resource].view; }
+    [[nodiscard]] VkBuffer getBuffer(RenderGraphResource p_Resource) const { return m_Resources[p_Resource].buffer; }
+
+    // Culls, plans the transients and records every kept pass with its barriers
+    void execute(VulkanCommandBuffer& p_CmdBuffer);
+
+    // Framebuffers referencing views that are about to go away, e.g. on swapchain recreation
+    void releaseFramebuffers();
+
+    [[nodiscard]] const RenderGraphStats& getStats() const { return m_Stats; }
+
+private:
+    struct Resource
+    {
+        bool isImage = false;
+        bool transient = false;
+        bool exported = false;
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        VkBuffer buffer = VK_NULL_HANDLE;
+        VkFormat format = VK_FORMAT_UNDEFINED;
+        VkExtent2D extent{};
+        VkImageAspectFlags aspect = 0;
+        VkImageUsageFlags usage = 0;
+        VkImageLayout finalLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // Hazard tracking while recording
+        VkPipelineStageFlags writeStages = 0;
+        VkAccessFlags writeAccess = 0;
+        VkPipelineStageFlags readStages = 0;
+        VkAccessFlags visibleAccess = 0;
+        VkImageLayout layout = VK_IMAGE_LAYOUT_UNDEFINED;
+
+        // First and last kept pass using it
+        uint32_t firstPass = UINT32_MAX;
+        uint32_t lastPass = 0;
+        uint32_t transientIndex = UINT32_MAX;
+    };
+
+    struct TransientKey
+    {
+        VkFormat format;
+        VkExtent2D extent;
+        VkImageAspectFlags aspect;
+        VkImageUsageFlags usage;
+        uint32_t firstPass;
+        uint32_t lastPass;
+
+        bool operator==(const TransientKey& p_Other) const;
+    };
+
+    struct TransientImage
+    {
+        VkImage image = VK_NULL_HANDLE;
+        VkImageView view = VK_NULL_HANDLE;
+        uint32_t block = 0;
+    };
+
+    // Memory shared by transients with disjoint lifetimes, every one of them is bound at offset 0
+    struct MemoryBlock
+    {
+        VkDeviceMemory memory = VK_NULL_HANDLE;
+        VkDeviceSize size = 0;
+        uint32_t typeBits = UINT32_MAX;
+        std::vector<uint32_t> transients{};
+        // Last use of the memory by whichever transient held it, carried over to the next frame
+        VkPipelineStageFlags stages = 0;
+        VkAccessFlags access = 0;
+    };
+
+    struct RenderPassEntry
+    {
+        std::vector<VkAttachmentDescription> attachments;
+        VkRenderPass renderPass;
+    };
+
+    struct FramebufferEntry
+    {
+        VkRenderPass renderPass;
+        std::vector<VkImageView> views;
+        VkExtent2D extent;
+        VkFramebuffer framebuffer;
+    };
+
+    // Batched into one vkCmdPipelineBarrier per pass
+    struct BarrierBatch
+    {
+        VkPipelineStageFlags srcStages = 0;
+        VkPipelineStageFlags dstStages = 0;
+        VkMemoryBarrier memory{ VK_STRUCTURE_TYPE_MEMORY_BARRIER };
+        std::vector<VkImageMemoryBarrier> images{};
+        bool hasMemory = false;
+    };
+
+    void cullPasses();
+    void planTransients();
+    void releaseTransients();
+    [[nodiscard]] uint32_t findMemoryType(uint32_t p_TypeBits) const;
+
+    void addBarriers(const RenderGraphPass& p_Pass, BarrierBatch& p_Batch);
+    static void transition(Resource& p_Resource, VkPipelineStageFlags p_Stages, VkAccessFlags p_Access, VkImageLayout p_Layout, bool p_Write, BarrierBatch& p_Batch);
+    void flushBarriers(VkCommandBuffer p_CmdBuffer, BarrierBatch& p_Batch);
+    void recordRasterPass(VulkanCommandBuffer& p_CmdBuffer, const RenderGraphPass& p_Pass, uint32_t p_PassIndex);
+    [[nodiscard]] VkRenderPass getRenderPass(const std::vector<VkAttachmentDescription>& p_Attachments, bool p_HasDepth);
+    [[nodiscard]] VkFramebuffer getFramebuffer(VkRenderPass p_RenderPass, const std::vector<VkImageView>& p_Views, VkExtent2D p_Extent);
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    DeferredReleaseQueue* m_DeferredRelease = nullptr;
+    Profiler* m_Profiler = nullptr;
+
+    std::vector<Resource> m_Resources{};
+    std::vector<RenderGraphPass> m_Passes{};
+    // Indices of the passes that survived culling, in declaration order
+    std::vector<uint32_t> m_KeptPasses{};
+
+    std::vector<TransientKey> m_PlanKeys{};
+    std::vector<TransientImage> m_Transients{};
+    std::vector<MemoryBlock> m_Blocks{};
+
+    std::vector<RenderPassEntry> m_RenderPasses{};
+    std::vector<FramebufferEntry> m_Framebuffers{};
+
+    RenderGraphStats m_Stats{};
+};
@@ -0,0 +1,320 @@
+#include "bindless_table.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+void BindlessTable::Array::init(const uint32_t p_Capacity, const uint32_t p_FramesInFlight)
+{
+    // Handed out from the back, so the lowest indices go first
+    freeIndices.clear();
+    for (uint32_t i = p_Capacity - 1; i > 0; i--)
+        freeIndices.push_back(i);
+    retired.clear();
+    dirty.assign(p_FramesInFlight, {});
+    used = 0;
+}
+
+BindlessIndex BindlessTable::Array::acquire(const char* p_Name)
+{
+    if (freeIndices.empty())
+        throw std::runtime_error(std::string{ "Bindless " } + p_Name + " table is full");
+    const BindlessIndex l_Index = freeIndices.back();
+    freeIndices.pop_back();
+    used++;
+    return l_Index;
+}
+
+void BindlessTable::Array::retire(const BindlessIndex p_Index, const uint64_t p_Frame)
+{
+    retired.push_back({ p_Frame, p_Index });
+    used--;
+}
+
+void BindlessTable::Array::reclaim(const uint64_t p_Frame, const uint32_t p_FramesInFlight)
+{
+    std::erase_if(retired, [this, p_Frame, p_FramesInFlight](const Retired& p_Retired)
+    {
+        if (p_Frame < p_Retired.frame + p_FramesInFlight)
+            return false;
+        freeIndices.push_back(p_Retired.index);
+        return true;
+    });
+}
+
+void BindlessTable::Array::markDirty(const BindlessIndex p_Index)
+{
+    for (std::vector<BindlessIndex>& l_Dirty : dirty)
+        l_Dirty.push_back(p_Index);
+}
+
+UploadTicket BindlessTable::init(const ResourceID p_DeviceID, UploadService& p_UploadService, const uint32_t p_FamilyIndex, const uint32_t p_FramesInFlight)
+{
+    m_DeviceID = p_DeviceID;
+    m_FramesInFlight = p_FramesInFlight;
+    m_FrameIndex = 0;
+
+    // The shaders declare runtime sized arrays, so the table is as large as the device allows up to the caps
+    VkPhysicalDeviceVulkan12Properties l_Vulkan12Properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_PROPERTIES };
+    VkPhysicalDeviceProperties2 l_Properties{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_PROPERTIES_2 };
+    l_Properties.pNext = &l_Vulkan12Properties;
+    vkGetPhysicalDeviceProperties2(*VulkanContext::getDevice(m_DeviceID).getGPU(), &l_Properties);
+    m_TextureCapacity = std::min({ MAX_TEXTURE_CAPACITY, l_Vulkan12Properties.maxPerStageDescriptorUpdateAfterBindSampledImages,
+        l_Vulkan12Properties.maxDescriptorSetUpdateAfterBindSampledImages });
+    m_BufferCapacity = std::min({ MAX_BUFFER_CAPACITY, l_Vulkan12Properties.maxPerStageDescriptorUpdateAfterBindStorageBuffers,
+        l_Vulkan12Properties.maxDescriptorSetUpdateAfterBindStorageBuffers });
+    if (m_TextureCapacity < 2 || m_BufferCapacity < 2)
+        throw std::runtime_error("Device can't hold any bindless textures or buffers besides the fallbacks");
+
+    const UploadTicket l_Ticket = createFallbacks(p_UploadService, p_FamilyIndex);
+    createSet();
+    return l_Ticket;
+}
+
+void BindlessTable::requireFeatures(const VkPhysicalDevice p_GPU, VkPhysicalDeviceFeatures& p_Features, VkPhysicalDeviceVulkan12Features& p_Vulkan12Features)
+{
+    VkPhysicalDeviceVulkan12Features l_Supported12{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_VULKAN_1_2_FEATURES };
+    VkPhysicalDeviceFeatures2 l_Supported{ VK_STRUCTURE_TYPE_PHYSICAL_DEVICE_FEATURES_2 };
+    l_Supported.pNext = &l_Supported12;
+    vkGetPhysicalDeviceFeatures2(p_GPU, &l_Supported);
+
+    if (!l_Supported.features.shaderSampledImageArrayDynamicIndexing || !l_Supported.features.shaderStorageBufferArrayDynamicIndexing ||
+        !l_Supported12.runtimeDescriptorArray || !l_Supported12.descriptorBindingPartiallyBound ||
+        !l_Supported12.descriptorBindingSampledImageUpdateAfterBind || !l_Supported12.descriptorBindingStorageBufferUpdateAfterBind)
+        throw std::runtime_error("Device doesn't support descriptor indexing for sampled images and storage buffers");
+
+    p_Features.shaderSampledImageArrayDynamicIndexing = VK_TRUE;
+    p_Features.shaderStorageBufferArrayDynamicIndexing = VK_TRUE;
+    p_Vulkan12Features.descriptorIndexing = l_Supported12.descriptorIndexing;
+    p_Vulkan12Features.runtimeDescriptorArray = VK_TRUE;
+    p_Vulkan12Features.descriptorBindingPartiallyBound = VK_TRUE;
+    p_Vulkan12Features.descriptorBindingSampledImageUpdateAfterBind = VK_TRUE;
+    p_Vulkan12Features.descriptorBindingStorageBufferUpdateAfterBind = VK_TRUE;
+}
+
+void BindlessTable::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    vkDestroyDescriptorPool(*l_Device, m_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(*l_Device, m_SetLayout, nullptr);
+    vkDestroySampler(*l_Device, m_Sampler, nullptr);
+    l_Device.freeImage(m_FallbackImageID);
+    l_Device.freeBuffer(m_FallbackBufferID);
+    m_Sets.clear();
+    m_DescriptorPool = VK_NULL_HANDLE;
+    m_SetLayout = VK_NULL_HANDLE;
+    m_Sampler = VK_NULL_HANDLE;
+    m_DeviceID = UINT32_MAX;
+}
+
+BindlessIndex BindlessTable::registerTexture(const VkImageView p_View)
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    const BindlessIndex l_Index = m_TextureSlots.acquire("texture");
+    // Elements that were never handed out are left unwritten, so even a view-less index needs the fallback written
+    m_Textures[l_Index].imageView = p_View != VK_NULL_HANDLE ? p_View : m_Textures[WHITE_TEXTURE].imageView;
+    m_TextureSlots.markDirty(l_Index);
+    return l_Index;
+}
+
+void BindlessTable::updateTexture(const BindlessIndex p_Index, const VkImageView p_View)
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    m_Textures[p_Index].imageView = p_View;
+    m_TextureSlots.markDirty(p_Index);
+}
+
+void BindlessTable::releaseTexture(const BindlessIndex p_Index)
+{
+    if (p_Index == INVALID_INDEX || p_Index == WHITE_TEXTURE)
+        return;
+
+    std::scoped_lock l_Lock{ m_Mutex };
+    m_Textures[p_Index] = m_Textures[WHITE_TEXTURE];
+    m_TextureSlots.markDirty(p_Index);
+    m_TextureSlots.retire(p_Index, m_FrameIndex);
+}
+
+BindlessIndex BindlessTable::registerBuffer(const VkBuffer p_Buffer, const VkDeviceSize p_Offset, const VkDeviceSize p_Range)
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    const BindlessIndex l_Index = m_BufferSlots.acquire("buffer");
+    m_Buffers[l_Index] = { p_Buffer, p_Offset, p_Range };
+    m_BufferSlots.markDirty(l_Index);
+    return l_Index;
+}
+
+void BindlessTable::releaseBuffer(const BindlessIndex p_Index)
+{
+    if (p_Index == INVALID_INDEX || p_Index == ZERO_BUFFER)
+        return;
+
+    std::scoped_lock l_Lock{ m_Mutex };
+    m_Buffers[p_Index] = m_Buffers[ZERO_BUFFER];
+    m_BufferSlots.markDirty(p_Index);
+    m_BufferSlots.retire(p_Index, m_FrameIndex);
+}
+
+VkDescriptorSet BindlessTable::beginFrame(const uint32_t p_FrameSlot)
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    m_FrameIndex++;
+    m_TextureSlots.reclaim(m_FrameIndex, m_FramesInFlight);
+    m_BufferSlots.reclaim(m_FrameIndex, m_FramesInFlight);
+
+    const VkDescriptorSet l_Set = m_Sets[p_FrameSlot];
+    std::vector<BindlessIndex>& l_DirtyTextures = m_TextureSlots.dirty[p_FrameSlot];
+    std::vector<BindlessIndex>& l_DirtyBuffers = m_BufferSlots.dirty[p_FrameSlot];
+    if (l_DirtyTextures.empty() && l_DirtyBuffers.empty())
+        return l_Set;
+
+    std::vector<VkWriteDescriptorSet> l_Writes{};
+    l_Writes.reserve(l_DirtyTextures.size() + l_DirtyBuffers.size());
+    for (const BindlessIndex l_Index : l_DirtyTextures)
+    {
+        VkWriteDescriptorSet& l_Write = l_Writes.emplace_back(VkWriteDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
+        l_Write.dstSet = l_Set;
+        l_Write.dstBinding = TEXTURE_BINDING;
+        l_Write.dstArrayElement = l_Index;
+        l_Write.descriptorCount = 1;
+        l_Write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        l_Write.pImageInfo = &m_Textures[l_Index];
+    }
+    for (const BindlessIndex l_Index : l_DirtyBuffers)
+    {
+        VkWriteDescriptorSet& l_Write = l_Writes.emplace_back(VkWriteDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
+        l_Write.dstSet = l_Set;
+        l_Write.dstBinding = BUFFER_BINDING;
+        l_Write.dstArrayElement = l_Index;
+        l_Write.descriptorCount = 1;
+        l_Write.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        l_Write.pBufferInfo = &m_Buffers[l_Index];
+    }
+    vkUpdateDescriptorSets(*VulkanContext::getDevice(m_DeviceID), static_cast<uint32_t>(l_Writes.size()), l_Writes.data(), 0, nullptr);
+    l_DirtyTextures.clear();
+    l_DirtyBuffers.clear();
+    return l_Set;
+}
+
+uint32_t BindlessTable::getTextureCount() const
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    return m_TextureSlots.used;
+}
+
+uint32_t BindlessTable::getBufferCount() const
+{
+    std::scoped_lock l_Lock{ m_Mutex };
+    return m_BufferSlots.used;
+}
+
+void BindlessTable::createSet()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    constexpr VkShaderStageFlags STAGES = VK_SHADER_STAGE_VERTEX_BIT | VK_SHADER_STAGE_FRAGMENT_BIT | VK_SHADER_STAGE_COMPUTE_BIT;
+
+    VkSamplerCreateInfo l_SamplerInfo{ VK_STRUCTURE_TYPE_SAMPLER_CREATE_INFO };
+    l_SamplerInfo.magFilter = VK_FILTER_LINEAR;
+    l_SamplerInfo.minFilter = VK_FILTER_LINEAR;
+    l_SamplerInfo.mipmapMode = VK_SAMPLER_MIPMAP_MODE_LINEAR;
+    l_SamplerInfo.addressModeU = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    l_SamplerInfo.addressModeV = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    l_SamplerInfo.addressModeW = VK_SAMPLER_ADDRESS_MODE_REPEAT;
+    l_SamplerInfo.maxLod = VK_LOD_CLAMP_NONE;
+    if (vkCreateSampler(*l_Device, &l_SamplerInfo, nullptr, &m_Sampler) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create bindless sampler");
+
+    const std::array<VkDescriptorSetLayoutBinding, 3> l_Bindings = {{
+        { TEXTURE_BINDING, VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_TextureCapacity, STAGES, nullptr },
+        { SAMPLER_BINDING, VK_DESCRIPTOR_TYPE_SAMPLER, 1, STAGES, &m_Sampler },
+        { BUFFER_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_BufferCapacity, STAGES, nullptr }
+    }};
+    // Only elements that were handed out are ever written, and the arrays may be written while other slots' copies are bound
+    constexpr VkDescriptorBindingFlags ARRAY_FLAGS = VK_DESCRIPTOR_BINDING_PARTIALLY_BOUND_BIT | VK_DESCRIPTOR_BINDING_UPDATE_AFTER_BIND_BIT;
+    const std::array<VkDescriptorBindingFlags, 3> l_BindingFlags = { ARRAY_FLAGS, 0, ARRAY_FLAGS };
+    VkDescriptorSetLayoutBindingFlagsCreateInfo l_BindingFlagsInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_BINDING_FLAGS_CREATE_INFO };
+    l_BindingFlagsInfo.bindingCount = static_cast<uint32_t>(l_BindingFlags.size());
+    l_BindingFlagsInfo.pBindingFlags = l_BindingFlags.data();
+    VkDescriptorSetLayoutCreateInfo l_LayoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    l_LayoutInfo.pNext = &l_BindingFlagsInfo;
+    l_LayoutInfo.flags = VK_DESCRIPTOR_SET_LAYOUT_CREATE_UPDATE_AFTER_BIND_POOL_BIT;
+    l_LayoutInfo.bindingCount = static_cast<uint32_t>(l_Bindings.size());
+    l_LayoutInfo.pBindings = l_Bindings.data();
+    if (vkCreateDescriptorSetLayout(*l_Device, &l_LayoutInfo, nullptr, &m_SetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create bindless descriptor set layout");
+
+    // The sampler is immutable, only the arrays take pool space
+    const std::array<VkDescriptorPoolSize, 2> l_PoolSizes = {{
+        { VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE, m_TextureCapacity * m_FramesInFlight },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER, m_BufferCapacity * m_FramesInFlight }
+    }};
+    VkDescriptorPoolCreateInfo l_PoolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    l_PoolInfo.flags = VK_DESCRIPTOR_POOL_CREATE_UPDATE_AFTER_BIND_BIT;
+    l_PoolInfo.maxSets = m_FramesInFlight;
+    l_PoolInfo.poolSizeCount = static_cast<uint32_t>(l_PoolSizes.size());
+    l_PoolInfo.pPoolSizes = l_PoolSizes.data();
+    if (vkCreateDescriptorPool(*l_Device, &l_PoolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create bindless descriptor pool");
+
+    const std::vector<VkDescriptorSetLayout> l_Layouts(m_FramesInFlight, m_SetLayout);
+    m_Sets.resize(m_FramesInFlight);
+    VkDescriptorSetAllocateInfo l_SetInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    l_SetInfo.descriptorPool = m_DescriptorPool;
+    l_SetInfo.descriptorSetCount = m_FramesInFlight;
+    l_SetInfo.pSetLayouts = l_Layouts.data();
+    if (vkAllocateDescriptorSets(*l_Device, &l_SetInfo, m_Sets.data()) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate bindless descriptor sets");
+
+    // Only the fallbacks are written up front, the arrays are partially bound and the rest is written as it is handed out
+    m_Textures.assign(m_TextureCapacity, { VK_NULL_HANDLE, *l_Device.getImage(m_FallbackImageID).getImageView(m_FallbackViewID), VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL });
+    m_Buffers.assign(m_BufferCapacity, { *l_Device.getBuffer(m_FallbackBufferID), 0, VK_WHOLE_SIZE });
+    m_TextureSlots.init(m_TextureCapacity, m_FramesInFlight);
+    m_BufferSlots.init(m_BufferCapacity, m_FramesInFlight);
+
+    std::vector<VkWriteDescriptorSet> l_Writes{};
+    for (const VkDescriptorSet l_Set : m_Sets)
+    {
+        VkWriteDescriptorSet& l_Write = l_Writes.emplace_back(VkWriteDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
+        l_Write.dstSet = l_Set;
+        l_Write.dstBinding = TEXTURE_BINDING;
+        l_Write.dstArrayElement = WHITE_TEXTURE;
+        l_Write.descriptorCount = 1;
+        l_Write.descriptorType = VK_DESCRIPTOR_TYPE_SAMPLED_IMAGE;
+        l_Write.pImageInfo = &m_Textures[WHITE_TEXTURE];
+
+        VkWriteDescriptorSet& l_BufferWrite = l_Writes.emplace_back(VkWriteDescriptorSet{ VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET });
+        l_BufferWrite.dstSet = l_Set;
+        l_BufferWrite.dstBinding = BUFFER_BINDING;
+        l_BufferWrite.dstArrayElement = ZERO_BUFFER;
+        l_BufferWrite.descriptorCount = 1;
+        l_BufferWrite.descriptorType = VK_DESCRIPTOR_TYPE_STORAGE_BUFFER;
+        l_BufferWrite.pBufferInfo = &m_Buffers[ZERO_BUFFER];
+    }
+    vkUpdateDescriptorSets(*l_Device, static_cast<uint32_t>(l_Writes.size()), l_Writes.data(), 0, nullptr);
+}
+
+UploadTicket BindlessTable::createFallbacks(UploadService& p_UploadService, const uint32_t p_FamilyIndex)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
+        .preferredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+
+    m_FallbackImageID = l_Device.createAndAllocateImage(l_MemPrefs, {VK_IMAGE_TYPE_2D, VK_FORMAT_R8G8B8A8_UNORM, { 1, 1, 1 }, VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0});
+    m_FallbackViewID = l_Device.getImage(m_FallbackImageID).createImageView(VK_FORMAT_R8G8B8A8_UNORM, VK_IMAGE_ASPECT_COLOR_BIT);
+    constexpr std::array<uint8_t, 4> WHITE = { 255, 255, 255, 255 };
+    p_UploadService.uploadImage(m_FallbackImageID, WHITE.data(), WHITE.size(), { { 1, 1, 1 } });
+
+    // Tickets grow monotonically, the buffer's covers the image too
+    constexpr std::array<uint32_t, 4> ZERO{};
+    m_FallbackBufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {sizeof(ZERO), VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_TRANSFER_DST_BIT, p_FamilyIndex});
+    return p_UploadService.uploadBuffer(m_FallbackBufferID, ZERO.data(), sizeof(ZERO));
+}
@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstdint>
+#include <mutex>
+#include <vector>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+#include "upload/upload_service.hpp"
+
+// Slot in one of the bindless arrays, shaders index the arrays with it directly. Stays valid until released
+using BindlessIndex = uint32_t;
+
+// One descriptor set holding every texture and storage buffer the frame may touch, bound once per command buffer.
+// Layout matches shaders/bindless.slang: a runtime sized array of sampled images at binding 0, a shared sampler at 1
+// and a runtime sized array of storage buffers at 2. Both arrays are partially bound and update after bind, so their
+// sizes come from the device's descriptor indexing limits and only elements that were handed out are ever written.
+// Released elements point at a white texture or a zeroed buffer. Every frame slot has
+// its own copy of the set and changes reach a copy when its slot begins, after the fence wait, so registering and
+// releasing never touch a set the GPU may still be reading
+class BindlessTable
+{
+public:
+    // Clamped to the device limits
+    static constexpr uint32_t MAX_TEXTURE_CAPACITY = 16384;
+    static constexpr uint32_t MAX_BUFFER_CAPACITY = 1024;
+    static constexpr BindlessIndex INVALID_INDEX = UINT32_MAX;
+    // Index 0 of each array is the fallback and is never given out
+    static constexpr BindlessIndex WHITE_TEXTURE = 0;
+    static constexpr BindlessIndex ZERO_BUFFER = 0;
+
+    // The device must have been created with descriptor indexing, see requireFeatures. The fallbacks reach the GPU
+    // through the upload service, nothing may use the table before the returned ticket is submitted. p_FamilyIndex
+    // owns the fallback buffer, like every other buffer the upload service fills
+    [[nodiscard]] UploadTicket init(ResourceID p_DeviceID, UploadService& p_UploadService, uint32_t p_FamilyIndex, uint32_t p_FramesInFlight);
+    void free();
+
+    // Checks the GPU for the descriptor indexing features the table needs and enables them in p_Features, throws when
+    // they are missing. Every Vulkan 1.3 device has them
+    static void requireFeatures(VkPhysicalDevice p_GPU, VkPhysicalDeviceFeatures& p_Features, VkPhysicalDeviceVulkan12Features& p_Vulkan12Features);
+
+    // The view must stay alive and in SHADER_READ_ONLY_OPTIMAL until the index is released and p_FramesInFlight frames have begun.
+    // Without a view the index shows the white texture until it is updated
+    [[nodiscard]] BindlessIndex registerTexture(VkImageView p_View = VK_NULL_HANDLE);
+    // Points a registered index at another view, frames begun from now on sample it. The old view has the same lifetime rule as a release
+    void updateTexture(BindlessIndex p_Index, VkImageView p_View);
+    void releaseTexture(BindlessIndex p_Index);
+
+    // The range must stay alive until the index is released and p_FramesInFlight frames have begun. Shaders see it as
+    // a ByteAddressBuffer, so the offset has to meet minStorageBufferOffsetAlignment
+    [[nodiscard]] BindlessIndex registerBuffer(VkBuffer p_Buffer, VkDeviceSize p_Offset = 0, VkDeviceSize p_Range = VK_WHOLE_SIZE);
+    void releaseBuffer(BindlessIndex p_Index);
+
+    // Applies every change the slot's copy of the set hasn't seen yet and returns it. The slot's fence must have been waited on
+    [[nodiscard]] VkDescriptorSet beginFrame(uint32_t p_FrameSlot);
+
+    [[nodiscard]] VkDescriptorSetLayout getSetLayout() const { return m_SetLayout; }
+    [[nodiscard]] uint32_t getTextureCount() const;
+    [[nodiscard]] uint32_t getTextureCapacity() const { return m_TextureCapacity; }
+    [[nodiscard]] uint32_t getBufferCount() const;
+    [[nodiscard]] uint32_t getBufferCapacity() const { return m_BufferCapacity; }
+
+private:
+    static constexpr uint32_t TEXTURE_BINDING = 0;
+    static constexpr uint32_t SAMPLER_BINDING = 1;
+    static constexpr uint32_t BUFFER_BINDING = 2;
+
+    // Indices go back to the free list only once every copy of the set has stopped pointing at the old resource
+    struct Retired
+    {
+        uint64_t frame;
+        BindlessIndex index;
+    };
+
+    struct Array
+    {
+        std::vector<BindlessIndex> freeIndices{};
+        std::vector<Retired> retired{};
+        // One list per frame slot of the indices its copy of the set still has to rewrite
+        std::vector<std::vector<BindlessIndex>> dirty{};
+        uint32_t used = 0;
+
+        void init(uint32_t p_Capacity, uint32_t p_FramesInFlight);
+        [[nodiscard]] BindlessIndex acquire(const char* p_Name);
+        void retire(BindlessIndex p_Index, uint64_t p_Frame);
+        void reclaim(uint64_t p_Frame, uint32_t p_FramesInFlight);
+        void markDirty(BindlessIndex p_Index);
+    };
+
+    void createSet();
+    [[nodiscard]] UploadTicket createFallbacks(UploadService& p_UploadService, uint32_t p_FamilyIndex);
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    uint32_t m_FramesInFlight = 0;
+    uint32_t m_TextureCapacity = 0;
+    uint32_t m_BufferCapacity = 0;
+    uint64_t m_FrameIndex = 0;
+
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkSampler m_Sampler = VK_NULL_HANDLE;
+    std::vector<VkDescriptorSet> m_Sets{};
+
+    ResourceID m_FallbackImageID = UINT32_MAX;
+    ResourceID m_FallbackViewID = UINT32_MAX;
+    ResourceID m_FallbackBufferID = UINT32_MAX;
+
+    // Streaming jobs register textures while the render thread begins frames
+    mutable std::mutex m_Mutex{};
+    std::vector<VkDescriptorImageInfo> m_Textures{};
+    std::vector<VkDescriptorBufferInfo> m_Buffers{};
+    Array m_TextureSlots{};
+    Array m_BufferSlots{};
+};
@@ -0,0 +1,81 @@
+#include "deferred_release_queue.hpp"
+
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "ext/vulkan_swapchain.hpp"
+
+void DeferredReleaseQueue::init(const ResourceID p_DeviceID)
+{
+    m_DeviceID = p_DeviceID;
+    m_CurrentFrame = 0;
+}
+
+void DeferredReleaseQueue::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    for (Entry& l_Entry : m_Pending)
+        destroy(l_Device, l_Entry);
+    m_Pending.clear();
+    m_DeviceID = UINT32_MAX;
+}
+
+void DeferredReleaseQueue::release(const DeferredResource p_Type, const ResourceID p_ID)
+{
+    m_Pending.push_back({ m_CurrentFrame, p_Type, p_ID, nullptr });
+}
+
+void DeferredReleaseQueue::release(std::function<void(VulkanDevice&)> p_Release)
+{
+    m_Pending.push_back({ m_CurrentFrame, DeferredResource::BUFFER, UINT32_MAX, std::move(p_Release) });
+}
+
+void DeferredReleaseQueue::collect(const uint64_t p_CompletedFrames)
+{
+    if (m_Pending.empty())
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    while (!m_Pending.empty() && m_Pending.front().frame < p_CompletedFrames)
+    {
+        destroy(l_Device, m_Pending.front());
+        m_Pending.pop_front();
+    }
+}
+
+void DeferredReleaseQueue::destroy(VulkanDevice& p_Device, Entry& p_Entry)
+{
+    m_ReleasedCount++;
+    if (p_Entry.callback)
+    {
+        p_Entry.callback(p_Device);
+        return;
+    }
+
+    switch (p_Entry.type)
+    {
+    case DeferredResource::BUFFER:
+        p_Device.freeBuffer(p_Entry.id);
+        break;
+    case DeferredResource::IMAGE:
+        p_Device.freeImage(p_Entry.id);
+        break;
+    case DeferredResource::FRAMEBUFFER:
+        p_Device.freeFramebuffer(p_Entry.id);
+        break;
+    case DeferredResource::SHADER_MODULE:
+        p_Device.freeShaderModule(p_Entry.id);
+        break;
+    case DeferredResource::FENCE:
+        p_Device.freeFence(p_Entry.id);
+        break;
+    case DeferredResource::SEMAPHORE:
+        p_Device.freeSemaphore(p_Entry.id);
+        break;
+    case DeferredResource::SWAPCHAIN:
+        VulkanSwapchainExtension::get(p_Device)->freeSwapchain(p_Entry.id);
+        break;
+    }
+}
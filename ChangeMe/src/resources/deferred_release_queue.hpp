@@ -0,0 +1,59 @@
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <utils/identifiable.hpp>
+
+class VulkanDevice;
+
+enum class DeferredResource : uint8_t
+{
+    BUFFER,
+    IMAGE,
+    FRAMEBUFFER,
+    SHADER_MODULE,
+    FENCE,
+    SEMAPHORE,
+    SWAPCHAIN
+};
+
+// Device resources that frames in flight may still use are released here instead of freed. Each one is tagged with
+// the frame being recorded and destroyed once that frame has finished on the GPU, so nothing has to wait for the device
+class DeferredReleaseQueue
+{
+public:
+    void init(ResourceID p_DeviceID);
+    // Frees everything still queued, the device must be idle
+    void free();
+
+    // Frames are counted from 0 in submission order, everything released from now on may be used by p_Frame
+    void setCurrentFrame(uint64_t p_Frame) { m_CurrentFrame = p_Frame; }
+
+    void release(DeferredResource p_Type, ResourceID p_ID);
+    // For anything that isn't a plain device resource, the callback runs once the frame has finished
+    void release(std::function<void(VulkanDevice&)> p_Release);
+
+    // p_CompletedFrames frames are known to be done on the GPU, everything only they used is destroyed
+    void collect(uint64_t p_CompletedFrames);
+
+    [[nodiscard]] size_t getPendingCount() const { return m_Pending.size(); }
+    [[nodiscard]] uint64_t getReleasedCount() const { return m_ReleasedCount; }
+
+private:
+    struct Entry
+    {
+        uint64_t frame;
+        DeferredResource type;
+        ResourceID id;
+        std::function<void(VulkanDevice&)> callback;
+    };
+
+    void destroy(VulkanDevice& p_Device, Entry& p_Entry);
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    uint64_t m_CurrentFrame = 0;
+    // Frames only grow, so the queue stays sorted by frame
+    std::deque<Entry> m_Pending{};
+    uint64_t m_ReleasedCount = 0;
+};
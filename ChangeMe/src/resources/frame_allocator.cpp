@@ -0,0 +1,144 @@
+#include "frame_allocator.hpp"
+
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+#include <string>
+
+#include "vulkan_buffer.hpp"
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+static VkDeviceSize alignUp(const VkDeviceSize p_Value, const VkDeviceSize p_Alignment)
+{
+    return (p_Value + p_Alignment - 1) / p_Alignment * p_Alignment;
+}
+
+void FrameAllocator::init(const ResourceID p_DeviceID, const uint32_t p_FamilyIndex, const VkDeviceSize p_FrameCapacity, const uint32_t p_FramesInFlight)
+{
+    m_DeviceID = p_DeviceID;
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+
+    const VkPhysicalDeviceLimits& l_Limits = l_Device.getGPU().getProperties().limits;
+    m_UniformAlignment = std::max<VkDeviceSize>(l_Limits.minUniformBufferOffsetAlignment, 1);
+    m_StorageAlignment = std::max<VkDeviceSize>(l_Limits.minStorageBufferOffsetAlignment, 1);
+
+    m_FrameCapacity = alignUp(p_FrameCapacity, PARTITION_ALIGNMENT);
+    const VkDeviceSize l_Size = m_FrameCapacity * p_FramesInFlight;
+
+    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
+        .preferredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+    constexpr VkBufferUsageFlags USAGE = VK_BUFFER_USAGE_VERTEX_BUFFER_BIT | VK_BUFFER_USAGE_INDEX_BUFFER_BIT | VK_BUFFER_USAGE_UNIFORM_BUFFER_BIT |
+        VK_BUFFER_USAGE_STORAGE_BUFFER_BIT | VK_BUFFER_USAGE_INDIRECT_BUFFER_BIT;
+    m_BufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {l_Size, USAGE, p_FamilyIndex});
+    m_Buffer = *l_Device.getBuffer(m_BufferID);
+    m_Data = static_cast<uint8_t*>(l_Device.getBuffer(m_BufferID).map(l_Size, 0));
+    m_FrameBase = 0;
+    m_Head = 0;
+    m_PeakUsed = 0;
+
+    createSet(l_Size);
+}
+
+void FrameAllocator::free()
+{
+    if (m_BufferID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    vkDestroyDescriptorPool(*l_Device, m_DescriptorPool, nullptr);
+    vkDestroyDescriptorSetLayout(*l_Device, m_SetLayout, nullptr);
+    m_DescriptorPool = VK_NULL_HANDLE;
+    m_SetLayout = VK_NULL_HANDLE;
+    m_Set = VK_NULL_HANDLE;
+
+    l_Device.getBuffer(m_BufferID).unmap();
+    l_Device.freeBuffer(m_BufferID);
+    m_BufferID = UINT32_MAX;
+    m_Buffer = VK_NULL_HANDLE;
+    m_Data = nullptr;
+}
+
+void FrameAllocator::beginFrame(const uint32_t p_FrameSlot)
+{
+    m_PeakUsed = std::max(m_PeakUsed, m_Head.load(std::memory_order_relaxed));
+    m_FrameBase = m_FrameCapacity * p_FrameSlot;
+    m_Head.store(0, std::memory_order_relaxed);
+}
+
+FrameAllocation FrameAllocator::allocate(const VkDeviceSize p_Size, const VkDeviceSize p_Alignment)
+{
+    VkDeviceSize l_Head = m_Head.load(std::memory_order_relaxed);
+    VkDeviceSize l_Offset;
+    do
+    {
+        l_Offset = alignUp(l_Head, p_Alignment);
+        if (l_Offset + p_Size > m_FrameCapacity)
+            throw std::runtime_error("Frame allocator is out of space, " + std::to_string(p_Size) + " bytes requested with " +
+                std::to_string(m_FrameCapacity - l_Head) + " left in the frame");
+    } while (!m_Head.compare_exchange_weak(l_Head, l_Offset + p_Size, std::memory_order_relaxed));
+
+    return { m_Buffer, m_FrameBase + l_Offset, m_Data + m_FrameBase + l_Offset };
+}
+
+FrameAllocation FrameAllocator::allocateUniform(const VkDeviceSize p_Size)
+{
+    if (p_Size > UNIFORM_RANGE)
+        throw std::runtime_error("Uniform allocation of " + std::to_string(p_Size) + " bytes is larger than the " + std::to_string(UNIFORM_RANGE) + " byte window");
+    return allocate(UNIFORM_RANGE, m_UniformAlignment);
+}
+
+void FrameAllocator::createSet(const VkDeviceSize p_BufferSize)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    if (p_BufferSize > l_Device.getGPU().getProperties().limits.maxStorageBufferRange)
+        throw std::runtime_error("Frame allocator is larger than the device's storage buffer range");
+
+    const std::array<VkDescriptorSetLayoutBinding, 2> l_Bindings = {{
+        { UNIFORM_BINDING, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_ALL, nullptr },
+        { STORAGE_BINDING, VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1, VK_SHADER_STAGE_ALL, nullptr }
+    }};
+    VkDescriptorSetLayoutCreateInfo l_LayoutInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_LAYOUT_CREATE_INFO };
+    l_LayoutInfo.bindingCount = static_cast<uint32_t>(l_Bindings.size());
+    l_LayoutInfo.pBindings = l_Bindings.data();
+    if (vkCreateDescriptorSetLayout(*l_Device, &l_LayoutInfo, nullptr, &m_SetLayout) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create frame allocator descriptor set layout");
+
+    const std::array<VkDescriptorPoolSize, 2> l_PoolSizes = {{
+        { VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER_DYNAMIC, 1 },
+        { VK_DESCRIPTOR_TYPE_STORAGE_BUFFER_DYNAMIC, 1 }
+    }};
+    VkDescriptorPoolCreateInfo l_PoolInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_POOL_CREATE_INFO };
+    l_PoolInfo.maxSets = 1;
+    l_PoolInfo.poolSizeCount = static_cast<uint32_t>(l_PoolSizes.size());
+    l_PoolInfo.pPoolSizes = l_PoolSizes.data();
+    if (vkCreateDescriptorPool(*l_Device, &l_PoolInfo, nullptr, &m_DescriptorPool) != VK_SUCCESS)
+        throw std::runtime_error("Failed to create frame allocator descriptor pool");
+
+    VkDescriptorSetAllocateInfo l_SetInfo{ VK_STRUCTURE_TYPE_DESCRIPTOR_SET_ALLOCATE_INFO };
+    l_SetInfo.descriptorPool = m_DescriptorPool;
+    l_SetInfo.descriptorSetCount = 1;
+    l_SetInfo.pSetLayouts = &m_SetLayout;
+    if (vkAllocateDescriptorSets(*l_Device, &l_SetInfo, &m_Set) != VK_SUCCESS)
+        throw std::runtime_error("Failed to allocate frame allocator descriptor set");
+
+    // Written once, the dynamic offsets pick the allocations. The whole size storage range shrinks by the dynamic offset
+    // when bound, so it never reaches past the buffer
+    const std::array<VkDescriptorBufferInfo, 2> l_BufferInfos = {{
+        { m_Buffer, 0, UNIFORM_RANGE },
+        { m_Buffer, 0, VK_WHOLE_SIZE }
+    }};
+    std::array<VkWriteDescriptorSet, 2> l_Writes{};
+    for (uint32_t i = 0; i < l_Writes.size(); i++)
+    {
+        l_Writes[i] = { VK_STRUCTURE_TYPE_WRITE_DESCRIPTOR_SET };
+        l_Writes[i].dstSet = m_Set;
+        l_Writes[i].dstBinding = l_Bindings[i].binding;
+        l_Writes[i].descriptorCount = 1;
+        l_Writes[i].descriptorType = l_Bindings[i].descriptorType;
+        l_Writes[i].pBufferInfo = &l_BufferInfos[i];
+    }
+    vkUpdateDescriptorSets(*l_Device, static_cast<uint32_t>(l_Writes.size()), l_Writes.data(), 0, nullptr);
+}
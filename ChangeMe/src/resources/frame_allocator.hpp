@@ -0,0 +1,87 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+struct FrameAllocation
+{
+    VkBuffer buffer = VK_NULL_HANDLE;
+    // From the start of the buffer, used as a bind offset or a dynamic descriptor offset
+    VkDeviceSize offset = 0;
+    void* data = nullptr;
+};
+
+// Persistently mapped host visible buffer split in one partition per frame in flight. Allocations bump the head of
+// the current partition and are all given back at once when its slot comes around again, so per frame data costs
+// a memcpy and never a buffer allocation. Vertex, index, uniform, storage and indirect reads are all allowed.
+// Shaders reach allocations through the allocator's own set, one dynamic uniform and one dynamic storage buffer over the
+// arena: bind it with the allocation offsets as the dynamic offsets, no descriptor is ever written per frame
+class FrameAllocator
+{
+public:
+    // Window the dynamic uniform descriptor exposes, uniform allocations can't be larger
+    static constexpr VkDeviceSize UNIFORM_RANGE = 256;
+    static constexpr uint32_t UNIFORM_BINDING = 0;
+    // Reaches from the dynamic offset to the end of the buffer
+    static constexpr uint32_t STORAGE_BINDING = 1;
+
+    void init(ResourceID p_DeviceID, uint32_t p_FamilyIndex, VkDeviceSize p_FrameCapacity, uint32_t p_FramesInFlight);
+    void free();
+
+    // The slot's fence must have been waited on, everything allocated the last time it was used is overwritten
+    void beginFrame(uint32_t p_FrameSlot);
+
+    // Safe to call from several recording jobs at once. Throws when the frame's partition is full. The alignment must
+    // be a power of two no larger than PARTITION_ALIGNMENT
+    [[nodiscard]] FrameAllocation allocate(VkDeviceSize p_Size, VkDeviceSize p_Alignment);
+    // Offsets follow the device's minimum descriptor offset alignments. Uniform allocations always reserve UNIFORM_RANGE
+    // bytes so the descriptor window stays inside the buffer, whatever the size asked for
+    [[nodiscard]] FrameAllocation allocateUniform(VkDeviceSize p_Size);
+    [[nodiscard]] FrameAllocation allocateStorage(VkDeviceSize p_Size) { return allocate(p_Size, m_StorageAlignment); }
+
+    template<typename T>
+    [[nodiscard]] FrameAllocation pushUniform(const T& p_Value)
+    {
+        const FrameAllocation l_Allocation = allocateUniform(sizeof(T));
+        std::memcpy(l_Allocation.data, &p_Value, sizeof(T));
+        return l_Allocation;
+    }
+
+    // Set with the dynamic uniform buffer at UNIFORM_BINDING and the dynamic storage buffer at STORAGE_BINDING, visible
+    // to every stage. Dynamic offsets are given in binding order
+    [[nodiscard]] VkDescriptorSetLayout getSetLayout() const { return m_SetLayout; }
+    [[nodiscard]] VkDescriptorSet getSet() const { return m_Set; }
+
+    [[nodiscard]] ResourceID getBufferID() const { return m_BufferID; }
+    [[nodiscard]] VkDeviceSize getFrameCapacity() const { return m_FrameCapacity; }
+    [[nodiscard]] VkDeviceSize getFrameUsed() const { return m_Head.load(std::memory_order_relaxed); }
+    [[nodiscard]] VkDeviceSize getPeakUsed() const { return m_PeakUsed; }
+
+private:
+    // Partitions start on it, so an offset aligned within the partition is aligned within the buffer. The device's
+    // descriptor offset alignments are powers of two no larger than this
+    static constexpr VkDeviceSize PARTITION_ALIGNMENT = 256;
+
+    void createSet(VkDeviceSize p_BufferSize);
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    ResourceID m_BufferID = UINT32_MAX;
+    VkBuffer m_Buffer = VK_NULL_HANDLE;
+    uint8_t* m_Data = nullptr;
+
+    VkDeviceSize m_FrameCapacity = 0;
+    VkDeviceSize m_UniformAlignment = 1;
+    VkDeviceSize m_StorageAlignment = 1;
+
+    VkDescriptorSetLayout m_SetLayout = VK_NULL_HANDLE;
+    VkDescriptorPool m_DescriptorPool = VK_NULL_HANDLE;
+    VkDescriptorSet m_Set = VK_NULL_HANDLE;
+
+    VkDeviceSize m_FrameBase = 0;
+    // Relative to the current partition
+    std::atomic<VkDeviceSize> m_Head{ 0 };
+    VkDeviceSize m_PeakUsed = 0;
+};
@@ -0,0 +1,78 @@
+#include "readback_buffer.hpp"
+
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+void ReadbackBuffer::init(const ResourceID p_DeviceID, const VkDeviceSize p_Size, const char* p_Name)
+{
+    m_DeviceID = p_DeviceID;
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+
+    VkBufferCreateInfo l_BufferInfo{ VK_STRUCTURE_TYPE_BUFFER_CREATE_INFO };
+    l_BufferInfo.size = p_Size;
+    l_BufferInfo.usage = VK_BUFFER_USAGE_TRANSFER_DST_BIT;
+    l_BufferInfo.sharingMode = VK_SHARING_MODE_EXCLUSIVE;
+    if (vkCreateBuffer(*l_Device, &l_BufferInfo, nullptr, &m_Buffer) != VK_SUCCESS)
+        throw std::runtime_error(std::string{ "Failed to create " } + p_Name + " readback buffer");
+
+    VkMemoryRequirements l_Requirements{};
+    vkGetBufferMemoryRequirements(*l_Device, m_Buffer, &l_Requirements);
+    VkPhysicalDeviceMemoryProperties l_MemoryProperties{};
+    vkGetPhysicalDeviceMemoryProperties(*l_Device.getGPU(), &l_MemoryProperties);
+
+    // Cached memory is much faster to read from the host
+    uint32_t l_MemoryType = UINT32_MAX;
+    for (const VkMemoryPropertyFlags l_Wanted : { VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_CACHED_BIT, VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT })
+    {
+        for (uint32_t i = 0; i < l_MemoryProperties.memoryTypeCount && l_MemoryType == UINT32_MAX; i++)
+        {
+            if ((l_Requirements.memoryTypeBits & (1U << i)) != 0 && (l_MemoryProperties.memoryTypes[i].propertyFlags & l_Wanted) == l_Wanted)
+                l_MemoryType = i;
+        }
+    }
+    if (l_MemoryType == UINT32_MAX)
+        throw std::runtime_error(std::string{ "No host visible memory for the " } + p_Name + " readback");
+    m_Coherent = (l_MemoryProperties.memoryTypes[l_MemoryType].propertyFlags & VK_MEMORY_PROPERTY_HOST_COHERENT_BIT) != 0;
+
+    VkMemoryAllocateInfo l_AllocInfo{ VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO };
+    l_AllocInfo.allocationSize = l_Requirements.size;
+    l_AllocInfo.memoryTypeIndex = l_MemoryType;
+    if (vkAllocateMemory(*l_Device, &l_AllocInfo, nullptr, &m_Memory) != VK_SUCCESS)
+        throw std::runtime_error(std::string{ "Failed to allocate " } + p_Name + " readback memory");
+    vkBindBufferMemory(*l_Device, m_Buffer, m_Memory, 0);
+
+    if (vkMapMemory(*l_Device, m_Memory, 0, VK_WHOLE_SIZE, 0, &m_Data) != VK_SUCCESS)
+        throw std::runtime_error(std::string{ "Failed to map " } + p_Name + " readback memory");
+    std::memset(m_Data, 0, p_Size);
+}
+
+void ReadbackBuffer::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    vkDestroyBuffer(*l_Device, m_Buffer, nullptr);
+    vkFreeMemory(*l_Device, m_Memory, nullptr);
+    m_Buffer = VK_NULL_HANDLE;
+    m_Memory = VK_NULL_HANDLE;
+    m_Data = nullptr;
+    m_DeviceID = UINT32_MAX;
+}
+
+void ReadbackBuffer::invalidate() const
+{
+    if (m_Coherent)
+        return;
+
+    VkMappedMemoryRange l_Range{ VK_STRUCTURE_TYPE_MAPPED_MEMORY_RANGE };
+    l_Range.memory = m_Memory;
+    l_Range.offset = 0;
+    l_Range.size = VK_WHOLE_SIZE;
+    vkInvalidateMappedMemoryRanges(*VulkanContext::getDevice(m_DeviceID), 1, &l_Range);
+}
@@ -0,0 +1,27 @@
+#pragma once
+
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+// Persistently mapped buffer the GPU copies into and the host reads from. Allocated directly instead of through the
+// device allocator so the memory type that was picked is known, cached memory is preferred and is often not coherent
+class ReadbackBuffer
+{
+public:
+    void init(ResourceID p_DeviceID, VkDeviceSize p_Size, const char* p_Name);
+    void free();
+
+    // Call after the copy's fence has been waited on. The host barrier recorded after the copy only makes the write
+    // available, non coherent memory still has to be invalidated before the mapping sees it
+    void invalidate() const;
+
+    [[nodiscard]] VkBuffer getBuffer() const { return m_Buffer; }
+    [[nodiscard]] const void* getData() const { return m_Data; }
+
+private:
+    ResourceID m_DeviceID = UINT32_MAX;
+    VkBuffer m_Buffer = VK_NULL_HANDLE;
+    VkDeviceMemory m_Memory = VK_NULL_HANDLE;
+    bool m_Coherent = false;
+    void* m_Data = nullptr;
+};
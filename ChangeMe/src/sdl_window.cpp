@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <stdexcept>
+#include <string>
 #include <SDL3/SDL.h>
 
 #include "backends/imgui_impl_sdl3.h"
@@ -36,9 +37,10 @@ SDLWindow::SDLWindow(const std::string_view p_Name, const int p_Width, const int
         });
 }
 
-void SDLWindow::initImgui() const
+void SDLWindow::initImgui()
 {
     ImGui_ImplSDL3_InitForVulkan(m_SDLHandle);
+    m_ForwardEvents = true;
 }
 
 bool SDLWindow::shouldClose() const
@@ -77,64 +79,181 @@ bool SDLWindow::isMinimized() const
     return m_Minimized;
 }
 
-void SDLWindow::pollEvents()
+void SDLWindow::pollEvents(const uint32_t p_TimeoutMs)
 {
     SDL_Event l_Event;
-    while (SDL_PollEvent(&l_Event))
+    bool l_HasEvent = p_TimeoutMs > 0 ? SDL_WaitEventTimeout(&l_Event, static_cast<Sint32>(p_TimeoutMs)) : SDL_PollEvent(&l_Event);
+    while (l_HasEvent)
     {
-        ImGui_ImplSDL3_ProcessEvent(&l_Event);
-        switch (l_Event.type)
+        processEvent(l_Event);
+        l_HasEvent = SDL_PollEvent(&l_Event);
+    }
+    finishEvents();
+}
+
+void SDLWindow::processEvent(const SDL_Event& p_Event)
+{
+    switch (p_Event.type)
+    {
+    case SDL_EVENT_MOUSE_MOTION:
+        m_RawMouseMoved.emit(p_Event.motion.xrel, p_Event.motion.yrel);
+        if (m_CoalesceInput)
         {
-        case SDL_EVENT_QUIT:
-            m_ShouldClose = true;
-            break;
-        case SDL_EVENT_WINDOW_RESIZED:
-            if (l_Event.window.data1 > 0 && l_Event.window.data2 > 0) 
-            {
-                m_ResizeSignal.emit(WindowSize{l_Event.window.data1, l_Event.window.data2}.toExtent2D());
-                m_Minimized = false;
-            }
-            break;
-        case SDL_EVENT_WINDOW_MINIMIZED:
-            m_Minimized = true;
-            break;
-        case SDL_EVENT_WINDOW_RESTORED:
+            m_HasPendingMotion = true;
+            m_PendingMotionEvent = p_Event;
+            m_PendingRelX += p_Event.motion.xrel;
+            m_PendingRelY += p_Event.motion.yrel;
+            return;
+        }
+        break;
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+    case SDL_EVENT_KEY_DOWN:
+    case SDL_EVENT_KEY_UP:
+        flushCoalescedInput();
+        break;
+    }
+
+    forwardToRenderThread(p_Event);
+    switch (p_Event.type)
+    {
+    case SDL_EVENT_QUIT:
+        m_ShouldClose = true;
+        break;
+    case SDL_EVENT_WINDOW_RESIZED:
+        if (p_Event.window.data1 > 0 && p_Event.window.data2 > 0) 
+        {
+            m_ResizeSignal.emit(WindowSize{p_Event.window.data1, p_Event.window.data2}.toExtent2D());
             m_Minimized = false;
-            break;
-        case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
-            {
-                int32_t l_PxW = 0, l_PxH = 0;
-                SDL_GetWindowSizeInPixels(m_SDLHandle, &l_PxW, &l_PxH);
-                if (l_PxW > 0 && l_PxH > 0)
-                    m_PixelResizeSignal.emit(WindowSize{l_PxW, l_PxH}.toExtent2D());
-            }
-            break;
-        case SDL_EVENT_MOUSE_MOTION:
-            m_MouseMoved.emit(l_Event.motion.xrel, l_Event.motion.yrel);
-            break;
-        case SDL_EVENT_KEY_DOWN:
-            m_KeyPressed.emit(l_Event.key.key);
-            break;
-        case SDL_EVENT_MOUSE_BUTTON_DOWN:
-            m_MouseButtonPressed.emit(l_Event.button.button);
-            break;
-        case SDL_EVENT_MOUSE_BUTTON_UP:
-            m_MouseButtonReleased.emit(l_Event.button.button);
-            break;
-        case SDL_EVENT_MOUSE_WHEEL:
-            m_MouseScrolled.emit(l_Event.wheel.y);
-            break;
-        case SDL_EVENT_KEY_UP:
-            m_KeyReleased.emit(l_Event.key.key);
-            break;
         }
+        break;
+    case SDL_EVENT_WINDOW_MINIMIZED:
+        m_Minimized = true;
+        break;
+    case SDL_EVENT_WINDOW_RESTORED:
+        m_Minimized = false;
+        break;
+    case SDL_EVENT_WINDOW_PIXEL_SIZE_CHANGED:
+        {
+            int32_t l_PxW = 0, l_PxH = 0;
+            SDL_GetWindowSizeInPixels(m_SDLHandle, &l_PxW, &l_PxH);
+            if (l_PxW > 0 && l_PxH > 0)
+                m_PendingPixelSize.store(static_cast<uint64_t>(l_PxW) << 32 | static_cast<uint32_t>(l_PxH), std::memory_order_release);
+        }
+        break;
+    case SDL_EVENT_MOUSE_MOTION:
+        m_MouseMoved.emit(p_Event.motion.xrel, p_Event.motion.yrel);
+        break;
+    case SDL_EVENT_KEY_DOWN:
+        m_KeyPressed.emit(p_Event.key.key);
+        break;
+    case SDL_EVENT_MOUSE_BUTTON_DOWN:
+        m_MouseButtonPressed.emit(p_Event.button.button);
+        break;
+    case SDL_EVENT_MOUSE_BUTTON_UP:
+        m_MouseButtonReleased.emit(p_Event.button.button);
+        break;
+    case SDL_EVENT_MOUSE_WHEEL:
+        if (m_CoalesceInput)
+            m_PendingScroll += p_Event.wheel.y;
+        else
+            m_MouseScrolled.emit(p_Event.wheel.y);
+        break;
+    case SDL_EVENT_KEY_UP:
+        m_KeyReleased.emit(p_Event.key.key);
+        break;
     }
+}
+
+void SDLWindow::finishEvents()
+{
+    flushCoalescedInput();
+    // Polls without new events still make room for the overflow once the render thread catches up
+    flushRenderEventOverflow();
+
     const uint64_t l_Now = SDL_GetTicks();
     m_Delta = (static_cast<float>(l_Now) - m_PrevDelta) * 0.001f;
     m_PrevDelta = static_cast<float>(l_Now);
     m_EventsProcessed.emit(m_Delta);
 }
 
+void SDLWindow::flushCoalescedInput()
+{
+    if (m_HasPendingMotion)
+    {
+        forwardToRenderThread(m_PendingMotionEvent);
+        m_MouseMoved.emit(m_PendingRelX, m_PendingRelY);
+        m_HasPendingMotion = false;
+        m_PendingRelX = 0.f;
+        m_PendingRelY = 0.f;
+    }
+    if (m_PendingScroll != 0.f)
+    {
+        m_MouseScrolled.emit(m_PendingScroll);
+        m_PendingScroll = 0.f;
+    }
+}
+
+void SDLWindow::setInputCoalescing(const bool p_Enabled)
+{
+    flushCoalescedInput();
+    m_CoalesceInput = p_Enabled;
+}
+
+void SDLWindow::forwardToRenderThread(const SDL_Event& p_Event)
+{
+    if (!m_ForwardEvents)
+        return;
+
+    RenderEvent l_RenderEvent{ p_Event, {} };
+    if (p_Event.type == SDL_EVENT_TEXT_INPUT)
+        SDL_strlcpy(l_RenderEvent.text.data(), p_Event.text.text, l_RenderEvent.text.size());
+
+    // Anything already waiting in the overflow goes first, otherwise events would reach ImGui out of order
+    flushRenderEventOverflow();
+    if (m_RenderEventOverflow.empty() && m_RenderEvents.tryPush(l_RenderEvent))
+        return;
+
+    // ImGui only reads the absolute position of a motion event, the newest one replaces the one before it
+    if (p_Event.type == SDL_EVENT_MOUSE_MOTION && !m_RenderEventOverflow.empty() && m_RenderEventOverflow.back().event.type == SDL_EVENT_MOUSE_MOTION)
+        m_RenderEventOverflow.back() = l_RenderEvent;
+    else
+        m_RenderEventOverflow.push_back(l_RenderEvent);
+}
+
+void SDLWindow::flushRenderEventOverflow()
+{
+    size_t l_Pushed = 0;
+    while (l_Pushed < m_RenderEventOverflow.size() && m_RenderEvents.tryPush(m_RenderEventOverflow[l_Pushed]))
+        l_Pushed++;
+    m_RenderEventOverflow.erase(m_RenderEventOverflow.begin(), m_RenderEventOverflow.begin() + static_cast<std::ptrdiff_t>(l_Pushed));
+}
+
+void SDLWindow::dispatchRenderEvents()
+{
+    m_DispatchEvents.clear();
+    RenderEvent l_RenderEvent;
+    while (m_RenderEvents.tryPop(l_RenderEvent))
+        m_DispatchEvents.push_back(l_RenderEvent);
+
+    if (!m_DispatchEvents.empty())
+    {
+        runOnMainThread([](void* p_Window)
+        {
+            for (RenderEvent& l_Event : static_cast<SDLWindow*>(p_Window)->m_DispatchEvents)
+            {
+                if (l_Event.event.type == SDL_EVENT_TEXT_INPUT)
+                    l_Event.event.text.text = l_Event.text.data();
+                ImGui_ImplSDL3_ProcessEvent(&l_Event.event);
+            }
+        }, this);
+    }
+
+    const uint64_t l_PixelSize = m_PendingPixelSize.exchange(0, std::memory_order_acquire);
+    if (l_PixelSize != 0)
+        m_PixelResizeSignal.emit(WindowSize{ static_cast<uint32_t>(l_PixelSize >> 32), static_cast<uint32_t>(l_PixelSize) }.toExtent2D());
+}
+
 void SDLWindow::toggleMouseCapture()
 {
     m_MouseCaptured = !m_MouseCaptured;
@@ -184,55 +303,67 @@ void SDLWindow::shutdownImgui() const
 
 void SDLWindow::frameImgui() const
 {
-    ImGui_ImplSDL3_NewFrame();
+    runOnMainThread([](void*) { ImGui_ImplSDL3_NewFrame(); }, nullptr);
+}
+
+void SDLWindow::runOnMainThread(const SDL_MainThreadCallback p_Callback, void* p_UserData)
+{
+    // Runs right away when already on the main thread
+    if (!SDL_RunOnMainThread(p_Callback, p_UserData, true))
+        throw std::runtime_error(std::string{ "Failed to run on the main thread: " } + SDL_GetError());
 }
 
-Signal<VkExtent2D>& SDLWindow::getResizedSignal()
+InlineSignal<VkExtent2D>& SDLWindow::getResizedSignal()
 {
     return m_ResizeSignal;
 }
 
-Signal<VkExtent2D>& SDLWindow::getPixelResizedSignal()
+InlineSignal<VkExtent2D>& SDLWindow::getPixelResizedSignal()
 {
     return m_PixelResizeSignal;
 }
 
-Signal<float, float>& SDLWindow::getMouseMovedSignal()
+InlineSignal<float, float>& SDLWindow::getMouseMovedSignal()
 {
     return m_MouseMoved;
 }
 
-Signal<uint32_t>& SDLWindow::getKeyPressedSignal()
+InlineSignal<float, float>& SDLWindow::getRawMouseMovedSignal()
+{
+    return m_RawMouseMoved;
+}
+
+InlineSignal<uint32_t>& SDLWindow::getKeyPressedSignal()
 {
     return m_KeyPressed;
 }
 
-Signal<uint32_t>& SDLWindow::getKeyReleasedSignal()
+InlineSignal<uint32_t>& SDLWindow::getKeyReleasedSignal()
 {
     return m_KeyReleased;
 }
 
-Signal<uint32_t>& SDLWindow::getMouseButtonPressedSignal()
+InlineSignal<uint32_t>& SDLWindow::getMouseButtonPressedSignal()
 {
     return m_MouseButtonPressed;
 }
 
-Signal<uint32_t>& SDLWindow::getMouseButtonReleasedSignal()
+InlineSignal<uint32_t>& SDLWindow::getMouseButtonReleasedSignal()
 {
     return m_MouseButtonReleased;
 }
 
-Signal<float>& SDLWindow::getMouseScrolledSignal()
+InlineSignal<float>& SDLWindow::getMouseScrolledSignal()
 {
     return m_MouseScrolled;
 }
 
-Signal<float>& SDLWindow::getEventsProcessedSignal()
+InlineSignal<float>& SDLWindow::getEventsProcessedSignal()
 {
     return m_EventsProcessed;
 }
 
-Signal<bool>& SDLWindow::getMouseCaptureChangedSignal()
+InlineSignal<bool>& SDLWindow::getMouseCaptureChangedSignal()
 {
     return m_MouseCaptureChanged;
 }
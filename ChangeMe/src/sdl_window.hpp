@@ -1,9 +1,15 @@
 #pragma once
+#include <array>
+#include <atomic>
+#include <vector>
+#include <SDL3/SDL_events.h>
+#include <SDL3/SDL_init.h>
 #include <SDL3/SDL_vulkan.h>
 #include <SDL3/SDL_keycode.h>
 #include <Volk/volk.h>
 
-#include "utils/signal.hpp"
+#include "events/inline_signal.hpp"
+#include "concurrency/spsc_queue.hpp"
 
 class VulkanFence;
 class VulkanDevice;
@@ -36,7 +42,18 @@ public:
 
     void getRequiredVulkanExtensions(const char* p_Container[]) const;
 
-	void pollEvents();
+	// Must run on the thread that created the window. Input signals are emitted from here, a timeout blocks until the
+	// first event arrives or the timeout elapses so the thread doesn't spin between events
+	void pollEvents(uint32_t p_TimeoutMs = 0);
+	// pollEvents runs every SDL event through processEvent and ends with finishEvents, they are public so input can be replayed
+	void processEvent(const SDL_Event& p_Event);
+	void finishEvents();
+	// Mouse motion and wheel deltas are summed over a poll and emitted once from finishEvents instead of once per event,
+	// on by default. Pending motion is flushed before button and key events so their order relative to it is kept
+	void setInputCoalescing(bool p_Enabled);
+	// Render thread side of pollEvents, feeds the forwarded events to ImGui and emits the pixel resized signal.
+	// Blocks until the main thread pumps events, which has to keep polling until the render thread is done
+	void dispatchRenderEvents();
 	void toggleMouseCapture();
 
 	void createSurface(VkInstance p_Instance);
@@ -46,20 +63,24 @@ public:
 
 	void free();
 
-	void initImgui() const;
+	// Events are only forwarded to the render thread once ImGui is there to consume them
+	void initImgui();
+	// Render thread, runs the SDL backend's new frame on the main thread like dispatchRenderEvents
 	void frameImgui() const;
 	void shutdownImgui() const;
 
-	[[nodiscard]] Signal<VkExtent2D>& getResizedSignal();
-	[[nodiscard]] Signal<VkExtent2D>& getPixelResizedSignal();
-	[[nodiscard]] Signal<float, float>& getMouseMovedSignal();
-	[[nodiscard]] Signal<uint32_t>& getKeyPressedSignal();
-	[[nodiscard]] Signal<uint32_t>& getKeyReleasedSignal();
-    [[nodiscard]] Signal<uint32_t>& getMouseButtonPressedSignal();
-    [[nodiscard]] Signal<uint32_t>& getMouseButtonReleasedSignal();
-    [[nodiscard]] Signal<float>& getMouseScrolledSignal();
-	[[nodiscard]] Signal<float>& getEventsProcessedSignal();
-    [[nodiscard]] Signal<bool>& getMouseCaptureChangedSignal();
+	[[nodiscard]] InlineSignal<VkExtent2D>& getResizedSignal();
+	[[nodiscard]] InlineSignal<VkExtent2D>& getPixelResizedSignal();
+	[[nodiscard]] InlineSignal<float, float>& getMouseMovedSignal();
+	// One emit per motion event even when coalescing, for consumers that need every sample
+	[[nodiscard]] InlineSignal<float, float>& getRawMouseMovedSignal();
+	[[nodiscard]] InlineSignal<uint32_t>& getKeyPressedSignal();
+	[[nodiscard]] InlineSignal<uint32_t>& getKeyReleasedSignal();
+    [[nodiscard]] InlineSignal<uint32_t>& getMouseButtonPressedSignal();
+    [[nodiscard]] InlineSignal<uint32_t>& getMouseButtonReleasedSignal();
+    [[nodiscard]] InlineSignal<float>& getMouseScrolledSignal();
+	[[nodiscard]] InlineSignal<float>& getEventsProcessedSignal();
+    [[nodiscard]] InlineSignal<bool>& getMouseCaptureChangedSignal();
 
 private:
 
@@ -68,25 +89,61 @@ private:
 
     VkInstance m_Instance = nullptr;
 
+	// Events copied out of SDL for the render thread. Text input points into SDL memory that the next poll frees,
+	// so it travels inline
+	struct RenderEvent
+	{
+		SDL_Event event;
+		std::array<char, 64> text;
+	};
+	static constexpr uint32_t RENDER_EVENT_CAPACITY = 1024;
+
+	void forwardToRenderThread(const SDL_Event& p_Event);
+	// Moves overflowed events into the queue in order until it is full again
+	void flushRenderEventOverflow();
+	void flushCoalescedInput();
+	// SDL3 only allows window, mouse and cursor calls on the main thread, which ImGui's SDL backend makes. The calling
+	// thread waits for the callback, so the ImGui context is never used from both threads at once
+	static void runOnMainThread(SDL_MainThreadCallback p_Callback, void* p_UserData);
+
+	SpscQueue<RenderEvent, RENDER_EVENT_CAPACITY> m_RenderEvents{};
+	// Main thread, events that didn't fit while the render thread was stalled. Nothing is dropped, a lost release would
+	// leave ImGui with a held key or button, so only consecutive motion is merged
+	std::vector<RenderEvent> m_RenderEventOverflow{};
+	// Render thread, popped from the queue and fed to ImGui by the main thread while the render thread waits
+	std::vector<RenderEvent> m_DispatchEvents{};
+	// Latest pixel size as width << 32 | height, 0 when unchanged. Only the last size matters for the swapchain
+	std::atomic<uint64_t> m_PendingPixelSize{ 0 };
+	bool m_ForwardEvents = false;
+
+	// Motion summed since the last flush, the last motion event carries the absolute position ImGui wants
+	bool m_CoalesceInput = true;
+	bool m_HasPendingMotion = false;
+	SDL_Event m_PendingMotionEvent{};
+	float m_PendingRelX = 0.f;
+	float m_PendingRelY = 0.f;
+	float m_PendingScroll = 0.f;
+
 	// Signals
-	Signal<VkExtent2D> m_ResizeSignal;      // WindowSize
-    Signal<VkExtent2D> m_PixelResizeSignal; // WindowSize
-	Signal<float, float> m_MouseMoved;      // relX, relY, isMouseCaptured
-	Signal<uint32_t> m_KeyPressed;          // key, isMouseCaptured
-	Signal<uint32_t> m_KeyReleased;         // key, isMouseCaptured
-    Signal<uint32_t> m_MouseButtonPressed;  // button, isMouseCaptured
-    Signal<uint32_t> m_MouseButtonReleased; // button, isMouseCaptured
-    Signal<float> m_MouseScrolled;          // y, isMouseCaptured
-	Signal<float> m_EventsProcessed;        // delta
-    Signal<bool> m_MouseCaptureChanged;     // isMouseCaptured
+	InlineSignal<VkExtent2D> m_ResizeSignal;      // WindowSize
+    InlineSignal<VkExtent2D> m_PixelResizeSignal; // WindowSize, emitted by dispatchRenderEvents
+	InlineSignal<float, float> m_MouseMoved;      // relX, relY, isMouseCaptured
+	InlineSignal<float, float> m_RawMouseMoved;   // relX, relY
+	InlineSignal<uint32_t> m_KeyPressed;          // key, isMouseCaptured
+	InlineSignal<uint32_t> m_KeyReleased;         // key, isMouseCaptured
+    InlineSignal<uint32_t> m_MouseButtonPressed;  // button, isMouseCaptured
+    InlineSignal<uint32_t> m_MouseButtonReleased; // button, isMouseCaptured
+    InlineSignal<float> m_MouseScrolled;          // y, isMouseCaptured
+	InlineSignal<float> m_EventsProcessed;        // delta
+    InlineSignal<bool> m_MouseCaptureChanged;     // isMouseCaptured
 
 	float m_PrevDelta = 0.f;
 	float m_Delta = 0.f;
 
 	bool m_MouseCaptured = false;
-    bool m_Minimized = false;
+    std::atomic<bool> m_Minimized = false;
 
-    bool m_ShouldClose = false;
+    std::atomic<bool> m_ShouldClose = false;
 
 	friend class Surface;
 	friend class VulkanGPU;
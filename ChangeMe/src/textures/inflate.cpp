@@ -0,0 +1,279 @@
+#include "inflate.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+namespace
+{
+    constexpr uint32_t MAX_CODE_BITS = 15;
+    constexpr uint32_t MAX_LITERAL_CODES = 288;
+    constexpr uint32_t MAX_DISTANCE_CODES = 30;
+
+    constexpr std::array<uint16_t, 29> LENGTH_BASE = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+    constexpr std::array<uint8_t, 29> LENGTH_EXTRA = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+    constexpr std::array<uint16_t, 30> DISTANCE_BASE = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145, 8193, 12289, 16385, 24577 };
+    constexpr std::array<uint8_t, 30> DISTANCE_EXTRA = { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+    constexpr std::array<uint8_t, 19> CODE_LENGTH_ORDER = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+    // Deflate packs bits starting from the least significant one, Huffman codes are read one bit at a time
+    class BitReader
+    {
+    public:
+        explicit BitReader(const std::span<const uint8_t> p_Data) : m_Data(p_Data) {}
+
+        uint32_t read(const uint32_t p_Count)
+        {
+            while (m_BitCount < p_Count)
+            {
+                if (m_Pos >= m_Data.size())
+                    throw std::runtime_error("Deflate stream ends early");
+                m_Bits |= static_cast<uint32_t>(m_Data[m_Pos++]) << m_BitCount;
+                m_BitCount += 8;
+            }
+            const uint32_t l_Value = m_Bits & ((1U << p_Count) - 1);
+            m_Bits >>= p_Count;
+            m_BitCount -= p_Count;
+            return l_Value;
+        }
+
+        // Only ever less than a byte is buffered, so dropping it lands on the next byte boundary
+        void alignToByte()
+        {
+            m_Bits = 0;
+            m_BitCount = 0;
+        }
+
+        [[nodiscard]] std::span<const uint8_t> takeBytes(const size_t p_Count)
+        {
+            if (m_Data.size() - m_Pos < p_Count)
+                throw std::runtime_error("Deflate stream ends early");
+            const std::span<const uint8_t> l_Bytes = m_Data.subspan(m_Pos, p_Count);
+            m_Pos += p_Count;
+            return l_Bytes;
+        }
+
+    private:
+        std::span<const uint8_t> m_Data;
+        size_t m_Pos = 0;
+        uint32_t m_Bits = 0;
+        uint32_t m_BitCount = 0;
+    };
+
+    // Canonical code, symbols sorted by code length and then by value
+    struct Huffman
+    {
+        std::array<uint16_t, MAX_CODE_BITS + 1> counts{};
+        std::array<uint16_t, MAX_LITERAL_CODES> symbols{};
+
+        void build(const uint8_t* p_Lengths, const uint32_t p_Count)
+        {
+            counts.fill(0);
+            for (uint32_t i = 0; i < p_Count; i++)
+                counts[p_Lengths[i]]++;
+            counts[0] = 0;
+
+            std::array<uint16_t, MAX_CODE_BITS + 1> l_Offsets{};
+            for (uint32_t i = 1; i < MAX_CODE_BITS; i++)
+                l_Offsets[i + 1] = l_Offsets[i] + counts[i];
+            for (uint32_t i = 0; i < p_Count; i++)
+            {
+                if (p_Lengths[i] != 0)
+                    symbols[l_Offsets[p_Lengths[i]]++] = static_cast<uint16_t>(i);
+            }
+        }
+
+        [[nodiscard]] uint32_t decode(BitReader& p_Reader) const
+        {
+            int32_t l_Code = 0;
+            int32_t l_First = 0;
+            int32_t l_Index = 0;
+            for (uint32_t l_Length = 1; l_Length <= MAX_CODE_BITS; l_Length++)
+            {
+                l_Code |= static_cast<int32_t>(p_Reader.read(1));
+                const int32_t l_Count = counts[l_Length];
+                if (l_Code - l_Count < l_First)
+                    return symbols[l_Index + (l_Code - l_First)];
+                l_Index += l_Count;
+                l_First = (l_First + l_Count) << 1;
+                l_Code <<= 1;
+            }
+            throw std::runtime_error("Invalid Huffman code in deflate stream");
+        }
+    };
+
+    void readDynamicCodes(BitReader& p_Reader, Huffman& p_Literals, Huffman& p_Distances)
+    {
+        const uint32_t l_LiteralCount = p_Reader.read(5) + 257;
+        const uint32_t l_DistanceCount = p_Reader.read(5) + 1;
+        const uint32_t l_CodeLengthCount = p_Reader.read(4) + 4;
+        if (l_LiteralCount > 286 || l_DistanceCount > MAX_DISTANCE_CODES)
+            throw std::runtime_error("Too many codes in deflate block");
+
+        std::array<uint8_t, CODE_LENGTH_ORDER.size()> l_CodeLengths{};
+        for (uint32_t i = 0; i < l_CodeLengthCount; i++)
+            l_CodeLengths[CODE_LENGTH_ORDER[i]] = static_cast<uint8_t>(p_Reader.read(3));
+        Huffman l_CodeLengthCode{};
+        l_CodeLengthCode.build(l_CodeLengths.data(), static_cast<uint32_t>(l_CodeLengths.size()));
+
+        // Literal and distance lengths form one sequence, repeats may cross from one into the other
+        std::array<uint8_t, MAX_LITERAL_CODES + MAX_DISTANCE_CODES> l_Lengths{};
+        uint32_t l_Filled = 0;
+        while (l_Filled < l_LiteralCount + l_DistanceCount)
+        {
+            const uint32_t l_Symbol = l_CodeLengthCode.decode(p_Reader);
+            if (l_Symbol < 16)
+            {
+                l_Lengths[l_Filled++] = static_cast<uint8_t>(l_Symbol);
+                continue;
+            }
+
+            uint8_t l_Value = 0;
+            uint32_t l_Repeat;
+            if (l_Symbol == 16)
+            {
+                if (l_Filled == 0)
+                    throw std::runtime_error("Deflate length repeat without a previous length");
+                l_Value = l_Lengths[l_Filled - 1];
+                l_Repeat = 3 + p_Reader.read(2);
+            }
+            else if (l_Symbol == 17)
+                l_Repeat = 3 + p_Reader.read(3);
+            else
+                l_Repeat = 11 + p_Reader.read(7);
+
+            if (l_Filled + l_Repeat > l_LiteralCount + l_DistanceCount)
+                throw std::runtime_error("Deflate code lengths overflow");
+            std::memset(l_Lengths.data() + l_Filled, l_Value, l_Repeat);
+            l_Filled += l_Repeat;
+        }
+        if (l_Lengths[256] == 0)
+            throw std::runtime_error("Deflate block has no end of block code");
+
+        p_Literals.build(l_Lengths.data(), l_LiteralCount);
+        p_Distances.build(l_Lengths.data() + l_LiteralCount, l_DistanceCount);
+    }
+
+    void buildFixedCodes(Huffman& p_Literals, Huffman& p_Distances)
+    {
+        std::array<uint8_t, MAX_LITERAL_CODES> l_Lengths{};
+        std::memset(l_Lengths.data(), 8, 144);
+        std::memset(l_Lengths.data() + 144, 9, 112);
+        std::memset(l_Lengths.data() + 256, 7, 24);
+        std::memset(l_Lengths.data() + 280, 8, 8);
+        p_Literals.build(l_Lengths.data(), MAX_LITERAL_CODES);
+
+        l_Lengths.fill(5);
+        p_Distances.build(l_Lengths.data(), MAX_DISTANCE_CODES);
+    }
+
+    size_t inflateBlock(BitReader& p_Reader, const Huffman& p_Literals, const Huffman& p_Distances, const std::span<uint8_t> p_Dst, size_t p_Written)
+    {
+        while (true)
+        {
+            const uint32_t l_Symbol = p_Literals.decode(p_Reader);
+            if (l_Symbol < 256)
+            {
+                if (p_Written >= p_Dst.size())
+                    throw std::runtime_error("Deflate stream decodes past the expected size");
+                p_Dst[p_Written++] = static_cast<uint8_t>(l_Symbol);
+                continue;
+            }
+            if (l_Symbol == 256)
+                return p_Written;
+
+            // The length's extra bits come before the distance code
+            const uint32_t l_LengthCode = l_Symbol - 257;
+            if (l_LengthCode >= LENGTH_BASE.size())
+                throw std::runtime_error("Invalid length code in deflate stream");
+            const size_t l_Length = LENGTH_BASE[l_LengthCode] + p_Reader.read(LENGTH_EXTRA[l_LengthCode]);
+            const uint32_t l_DistanceCode = p_Distances.decode(p_Reader);
+            if (l_DistanceCode >= DISTANCE_BASE.size())
+                throw std::runtime_error("Invalid distance code in deflate stream");
+            const size_t l_Distance = DISTANCE_BASE[l_DistanceCode] + p_Reader.read(DISTANCE_EXTRA[l_DistanceCode]);
+            if (l_Distance > p_Written || l_Length > p_Dst.size() - p_Written)
+                throw std::runtime_error("Deflate match points outside of the output");
+
+            // Matches may overlap their own output, so this has to go byte by byte
+            for (size_t i = 0; i < l_Length; i++, p_Written++)
+                p_Dst[p_Written] = p_Dst[p_Written - l_Distance];
+        }
+    }
+
+    uint32_t adler32(const std::span<const uint8_t> p_Data)
+    {
+        constexpr uint32_t MOD = 65521;
+        // Largest run that can't overflow the sums before reducing them
+        constexpr size_t BLOCK = 5552;
+        uint32_t l_A = 1;
+        uint32_t l_B = 0;
+        for (size_t l_Begin = 0; l_Begin < p_Data.size(); l_Begin += BLOCK)
+        {
+            const size_t l_End = std::min(p_Data.size(), l_Begin + BLOCK);
+            for (size_t i = l_Begin; i < l_End; i++)
+            {
+                l_A += p_Data[i];
+                l_B += l_A;
+            }
+            l_A %= MOD;
+            l_B %= MOD;
+        }
+        return (l_B << 16) | l_A;
+    }
+}
+
+void inflateZlib(const std::span<const uint8_t> p_Src, const std::span<uint8_t> p_Dst)
+{
+    if (p_Src.size() < 6)
+        throw std::runtime_error("Zlib stream is too short");
+    const uint8_t l_Method = p_Src[0];
+    const uint8_t l_Flags = p_Src[1];
+    if ((l_Method & 0x0F) != 8 || (l_Method << 8 | l_Flags) % 31 != 0 || (l_Flags & 0x20) != 0)
+        throw std::runtime_error("Unsupported zlib header, only deflate without a preset dictionary is accepted");
+
+    BitReader l_Reader{ p_Src.subspan(2, p_Src.size() - 6) };
+    Huffman l_Literals{};
+    Huffman l_Distances{};
+    size_t l_Written = 0;
+    bool l_LastBlock = false;
+    while (!l_LastBlock)
+    {
+        l_LastBlock = l_Reader.read(1) != 0;
+        switch (l_Reader.read(2))
+        {
+        case 0:
+        {
+            l_Reader.alignToByte();
+            const std::span<const uint8_t> l_Header = l_Reader.takeBytes(4);
+            const uint16_t l_Length = static_cast<uint16_t>(l_Header[0] | l_Header[1] << 8);
+            const uint16_t l_Complement = static_cast<uint16_t>(l_Header[2] | l_Header[3] << 8);
+            if (l_Length != static_cast<uint16_t>(~l_Complement) || l_Length > p_Dst.size() - l_Written)
+                throw std::runtime_error("Invalid stored block in deflate stream");
+            const std::span<const uint8_t> l_Stored = l_Reader.takeBytes(l_Length);
+            if (l_Length > 0)
+                std::memcpy(p_Dst.data() + l_Written, l_Stored.data(), l_Length);
+            l_Written += l_Length;
+            break;
+        }
+        case 1:
+            buildFixedCodes(l_Literals, l_Distances);
+            l_Written = inflateBlock(l_Reader, l_Literals, l_Distances, p_Dst, l_Written);
+            break;
+        case 2:
+            readDynamicCodes(l_Reader, l_Literals, l_Distances);
+            l_Written = inflateBlock(l_Reader, l_Literals, l_Distances, p_Dst, l_Written);
+            break;
+        default:
+            throw std::runtime_error("Invalid deflate block type");
+        }
+    }
+
+    if (l_Written != p_Dst.size())
+        throw std::runtime_error("Deflate stream decodes to " + std::to_string(l_Written) + " bytes instead of " + std::to_string(p_Dst.size()));
+    const uint8_t* l_Trailer = p_Src.data() + p_Src.size() - 4;
+    const uint32_t l_Checksum = static_cast<uint32_t>(l_Trailer[0]) << 24 | static_cast<uint32_t>(l_Trailer[1]) << 16 | static_cast<uint32_t>(l_Trailer[2]) << 8 | l_Trailer[3];
+    if (l_Checksum != adler32(p_Dst))
+        throw std::runtime_error("Zlib checksum mismatch");
+}
@@ -0,0 +1,8 @@
+#pragma once
+
+#include <cstdint>
+#include <span>
+
+// Decodes a zlib stream (RFC 1950/1951) whose decoded size is known up front, as KTX2 stores it for every level.
+// Throws if the stream is malformed, fails its checksum or doesn't decode to exactly p_Dst.size() bytes
+void inflateZlib(std::span<const uint8_t> p_Src, std::span<uint8_t> p_Dst);
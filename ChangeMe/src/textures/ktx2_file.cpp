@@ -0,0 +1,145 @@
+#include "ktx2_file.hpp"
+
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "textures/inflate.hpp"
+
+// Basic data format descriptor block, only the texel block size is needed from it
+static constexpr uint64_t DFD_BLOCK_DIMENSIONS_OFFSET = 16;
+static constexpr uint64_t DFD_BYTES_PLANE0_OFFSET = 20;
+
+struct Ktx2Block
+{
+    uint32_t width;
+    uint32_t height;
+    uint32_t bytes;
+};
+
+// Formats the streamer is expected to see, supercompressed files leave the byte count out of the descriptor
+static Ktx2Block getFormatBlock(const VkFormat p_Format)
+{
+    switch (p_Format)
+    {
+    case VK_FORMAT_R8_UNORM:
+    case VK_FORMAT_R8_SRGB:
+        return { 1, 1, 1 };
+    case VK_FORMAT_R8G8_UNORM:
+    case VK_FORMAT_R8G8_SRGB:
+        return { 1, 1, 2 };
+    case VK_FORMAT_R8G8B8A8_UNORM:
+    case VK_FORMAT_R8G8B8A8_SRGB:
+    case VK_FORMAT_B8G8R8A8_UNORM:
+    case VK_FORMAT_B8G8R8A8_SRGB:
+        return { 1, 1, 4 };
+    case VK_FORMAT_R16G16B16A16_SFLOAT:
+        return { 1, 1, 8 };
+    case VK_FORMAT_R32G32B32A32_SFLOAT:
+        return { 1, 1, 16 };
+    case VK_FORMAT_BC1_RGB_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGB_SRGB_BLOCK:
+    case VK_FORMAT_BC1_RGBA_UNORM_BLOCK:
+    case VK_FORMAT_BC1_RGBA_SRGB_BLOCK:
+    case VK_FORMAT_BC4_UNORM_BLOCK:
+    case VK_FORMAT_BC4_SNORM_BLOCK:
+        return { 4, 4, 8 };
+    case VK_FORMAT_BC2_UNORM_BLOCK:
+    case VK_FORMAT_BC2_SRGB_BLOCK:
+    case VK_FORMAT_BC3_UNORM_BLOCK:
+    case VK_FORMAT_BC3_SRGB_BLOCK:
+    case VK_FORMAT_BC5_UNORM_BLOCK:
+    case VK_FORMAT_BC5_SNORM_BLOCK:
+    case VK_FORMAT_BC6H_UFLOAT_BLOCK:
+    case VK_FORMAT_BC6H_SFLOAT_BLOCK:
+    case VK_FORMAT_BC7_UNORM_BLOCK:
+    case VK_FORMAT_BC7_SRGB_BLOCK:
+        return { 4, 4, 16 };
+    default:
+        return { 0, 0, 0 };
+    }
+}
+
+Ktx2File::Ktx2File(const std::string_view p_Path)
+    : m_File(p_Path)
+{
+    const std::string l_Path{ p_Path };
+    const uint8_t* l_Data = m_File.getData();
+    const uint64_t l_Size = m_File.getSize();
+
+    if (l_Size < sizeof(Ktx2Header))
+        throw std::runtime_error(l_Path + " is too small to be a KTX2 file");
+
+    m_Header = reinterpret_cast<const Ktx2Header*>(l_Data);
+    if (std::memcmp(m_Header->identifier, KTX2_IDENTIFIER.data(), KTX2_IDENTIFIER.size()) != 0)
+        throw std::runtime_error(l_Path + " is not a KTX2 file");
+    if (m_Header->vkFormat == VK_FORMAT_UNDEFINED)
+        throw std::runtime_error(l_Path + " has no Vulkan format, Basis Universal payloads need a transcoder");
+    if (m_Header->pixelWidth == 0 || m_Header->pixelHeight == 0 || m_Header->pixelDepth > 1 || m_Header->layerCount > 1 || m_Header->faceCount != 1)
+        throw std::runtime_error(l_Path + " is not a single 2D texture");
+    if (m_Header->supercompressionScheme != Ktx2Supercompression::NONE && m_Header->supercompressionScheme != Ktx2Supercompression::ZLIB)
+        throw std::runtime_error(l_Path + " uses supercompression scheme " + std::to_string(static_cast<uint32_t>(m_Header->supercompressionScheme)) +
+            ", only uncompressed and zlib levels can be decoded");
+
+    // A level count of 0 asks the loader to generate mips, those are left out and only the base level is used
+    const uint32_t l_LevelCount = std::max(m_Header->levelCount, 1U);
+    const uint64_t l_IndexBytes = static_cast<uint64_t>(l_LevelCount) * sizeof(Ktx2LevelIndex);
+    const auto l_Fits = [l_Size](const uint64_t p_Offset, const uint64_t p_Bytes) { return p_Offset <= l_Size && p_Bytes <= l_Size - p_Offset; };
+    if (!l_Fits(sizeof(Ktx2Header), l_IndexBytes) || !l_Fits(m_Header->dfdByteOffset, m_Header->dfdByteLength))
+        throw std::runtime_error(l_Path + " is truncated");
+    if (l_LevelCount > 32 || std::max(m_Header->pixelWidth, m_Header->pixelHeight) >> (l_LevelCount - 1) == 0)
+        throw std::runtime_error(l_Path + " has more levels than its size allows");
+
+    // Known formats come from the table, anything else from the descriptor
+    Ktx2Block l_Block = getFormatBlock(m_Header->vkFormat);
+    if (l_Block.bytes == 0 && m_Header->dfdByteLength >= DFD_BYTES_PLANE0_OFFSET + 1)
+    {
+        const uint8_t* l_Dfd = l_Data + m_Header->dfdByteOffset;
+        l_Block = { l_Dfd[DFD_BLOCK_DIMENSIONS_OFFSET] + 1U, l_Dfd[DFD_BLOCK_DIMENSIONS_OFFSET + 1] + 1U, l_Dfd[DFD_BYTES_PLANE0_OFFSET] };
+    }
+    if (l_Block.bytes == 0)
+        throw std::runtime_error(l_Path + " has a format with an unknown block size");
+    m_BlockHeight = l_Block.height;
+
+    // Every level must decode to exactly the blocks that cover its extent, uploads and the GPU image rely on it
+    m_Levels = { reinterpret_cast<const Ktx2LevelIndex*>(l_Data + sizeof(Ktx2Header)), l_LevelCount };
+    for (uint32_t i = 0; i < l_LevelCount; i++)
+    {
+        const Ktx2LevelIndex& l_Level = m_Levels[i];
+        if (!l_Fits(l_Level.byteOffset, l_Level.byteLength))
+            throw std::runtime_error(l_Path + " has a level outside of the file");
+        if (!isSupercompressed() && l_Level.byteLength != l_Level.uncompressedByteLength)
+            throw std::runtime_error(l_Path + " has an uncompressed level with a mismatched size");
+
+        const VkExtent3D l_Extent = getLevelExtent(i);
+        const uint64_t l_BlocksWide = (l_Extent.width + l_Block.width - 1) / l_Block.width;
+        const uint64_t l_BlocksHigh = (l_Extent.height + l_Block.height - 1) / l_Block.height;
+        if (l_Level.uncompressedByteLength != l_BlocksWide * l_BlocksHigh * l_Block.bytes)
+            throw std::runtime_error(l_Path + " level " + std::to_string(i) + " holds " + std::to_string(l_Level.uncompressedByteLength) +
+                " bytes, its extent needs " + std::to_string(l_BlocksWide * l_BlocksHigh * l_Block.bytes));
+    }
+}
+
+VkExtent3D Ktx2File::getLevelExtent(const uint32_t p_Level) const
+{
+    return { std::max(m_Header->pixelWidth >> p_Level, 1U), std::max(m_Header->pixelHeight >> p_Level, 1U), 1 };
+}
+
+std::span<const uint8_t> Ktx2File::getLevelData(const uint32_t p_Level) const
+{
+    const Ktx2LevelIndex& l_Level = m_Levels[p_Level];
+    return { m_File.getData() + l_Level.byteOffset, static_cast<size_t>(l_Level.byteLength) };
+}
+
+void Ktx2File::decodeLevel(const uint32_t p_Level, const std::span<uint8_t> p_Dst) const
+{
+    if (p_Dst.size() != getLevelSize(p_Level))
+        throw std::runtime_error("Level " + std::to_string(p_Level) + " decodes to " + std::to_string(getLevelSize(p_Level)) + " bytes");
+
+    const std::span<const uint8_t> l_Src = getLevelData(p_Level);
+    if (isSupercompressed())
+        inflateZlib(l_Src, p_Dst);
+    else
+        std::memcpy(p_Dst.data(), l_Src.data(), l_Src.size());
+}
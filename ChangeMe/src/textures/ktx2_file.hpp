@@ -0,0 +1,81 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <span>
+#include <string_view>
+#include <vector>
+#include <Volk/volk.h>
+
+#include "mesh/mapped_file.hpp"
+
+// On disk layout of the KTX 2.0 container, little endian. Level images are stored smallest first
+constexpr std::array<uint8_t, 12> KTX2_IDENTIFIER = { 0xAB, 0x4B, 0x54, 0x58, 0x20, 0x32, 0x30, 0xBB, 0x0D, 0x0A, 0x1A, 0x0A };
+
+enum class Ktx2Supercompression : uint32_t
+{
+    NONE = 0,
+    BASIS_LZ = 1,
+    ZSTANDARD = 2,
+    ZLIB = 3
+};
+
+struct Ktx2Header
+{
+    uint8_t identifier[12];
+    VkFormat vkFormat;
+    uint32_t typeSize;
+    uint32_t pixelWidth;
+    uint32_t pixelHeight;
+    uint32_t pixelDepth;
+    uint32_t layerCount;
+    uint32_t faceCount;
+    uint32_t levelCount;
+    Ktx2Supercompression supercompressionScheme;
+
+    uint32_t dfdByteOffset;
+    uint32_t dfdByteLength;
+    uint32_t kvdByteOffset;
+    uint32_t kvdByteLength;
+    uint64_t sgdByteOffset;
+    uint64_t sgdByteLength;
+};
+
+struct Ktx2LevelIndex
+{
+    uint64_t byteOffset;
+    uint64_t byteLength;
+    uint64_t uncompressedByteLength;
+};
+
+static_assert(sizeof(Ktx2Header) == 80 && sizeof(Ktx2LevelIndex) == 24, "KTX2 structs must not pick up padding");
+
+// Single 2D image with its mip chain, array and cube textures are rejected
+class Ktx2File
+{
+public:
+    // Throws if the file can't be mapped, isn't KTX2 or needs something not built in, BasisLZ and Zstandard need a transcoder
+    explicit Ktx2File(std::string_view p_Path);
+
+    [[nodiscard]] const Ktx2Header& getHeader() const { return *m_Header; }
+    [[nodiscard]] VkFormat getFormat() const { return m_Header->vkFormat; }
+    [[nodiscard]] uint32_t getLevelCount() const { return static_cast<uint32_t>(m_Levels.size()); }
+    [[nodiscard]] VkExtent3D getLevelExtent(uint32_t p_Level) const;
+    // Texel rows per block row, 4 for BCn
+    [[nodiscard]] uint32_t getBlockHeight() const { return m_BlockHeight; }
+
+    [[nodiscard]] bool isSupercompressed() const { return m_Header->supercompressionScheme != Ktx2Supercompression::NONE; }
+    // Bytes the level takes once decoded, which is also what it takes on the GPU
+    [[nodiscard]] uint64_t getLevelSize(const uint32_t p_Level) const { return m_Levels[p_Level].uncompressedByteLength; }
+    // Points straight into the mapping, valid while the Ktx2File is alive. Still supercompressed if the file is
+    [[nodiscard]] std::span<const uint8_t> getLevelData(uint32_t p_Level) const;
+
+    // p_Dst must hold getLevelSize(p_Level) bytes. Safe to call for different levels from several threads at once
+    void decodeLevel(uint32_t p_Level, std::span<uint8_t> p_Dst) const;
+
+private:
+    MappedFile m_File;
+    const Ktx2Header* m_Header = nullptr;
+    std::span<const Ktx2LevelIndex> m_Levels{};
+    uint32_t m_BlockHeight = 1;
+};
@@ -0,0 +1,262 @@
+#include "texture_streamer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <exception>
+#include <stdexcept>
+
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_gpu.hpp"
+
+void TextureStreamer::init(const ResourceID p_DeviceID, JobSystem& p_JobSystem, UploadService& p_UploadService, BindlessTable& p_BindlessTable, DeferredReleaseQueue& p_DeferredRelease, const VkDeviceSize p_Budget)
+{
+    m_DeviceID = p_DeviceID;
+    m_JobSystem = &p_JobSystem;
+    m_UploadService = &p_UploadService;
+    m_BindlessTable = &p_BindlessTable;
+    m_DeferredRelease = &p_DeferredRelease;
+    m_Budget = p_Budget;
+}
+
+void TextureStreamer::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    for (const std::unique_ptr<Texture>& l_Texture : m_Textures)
+    {
+        m_JobSystem->wait(l_Texture->decodeCounter);
+        if (l_Texture->imageID != UINT32_MAX)
+            l_Device.freeImage(l_Texture->imageID);
+        if (l_Texture->pendingImageID != UINT32_MAX)
+            l_Device.freeImage(l_Texture->pendingImageID);
+        m_BindlessTable->releaseTexture(l_Texture->bindlessIndex);
+    }
+    m_Textures.clear();
+    m_Stats = {};
+    m_DeviceID = UINT32_MAX;
+}
+
+TextureHandle TextureStreamer::load(const std::string_view p_Path)
+{
+    std::unique_ptr<Texture> l_NewTexture = std::make_unique<Texture>(p_Path);
+    VkFormatProperties l_FormatProperties{};
+    vkGetPhysicalDeviceFormatProperties(*VulkanContext::getDevice(m_DeviceID).getGPU(), l_NewTexture->file.getFormat(), &l_FormatProperties);
+    if ((l_FormatProperties.optimalTilingFeatures & VK_FORMAT_FEATURE_SAMPLED_IMAGE_BIT) == 0)
+        throw std::runtime_error(std::string{ p_Path } + " has a format the device can't sample");
+
+    Texture& l_Texture = *m_Textures.emplace_back(std::move(l_NewTexture));
+    const Ktx2File& l_File = l_Texture.file;
+    l_Texture.levelCount = l_File.getLevelCount();
+    l_Texture.residentLevel = l_Texture.levelCount;
+    l_Texture.targetLevel = l_Texture.levelCount;
+
+    // Largest level that still counts as tail, the smallest level when even that one is bigger
+    l_Texture.tailLevel = l_Texture.levelCount - 1;
+    while (l_Texture.tailLevel > 0)
+    {
+        const VkExtent3D l_Extent = l_File.getLevelExtent(l_Texture.tailLevel - 1);
+        if (std::max(l_Extent.width, l_Extent.height) > MIP_TAIL_SIZE)
+            break;
+        l_Texture.tailLevel--;
+    }
+
+    l_Texture.levelReady = std::make_unique<std::atomic<bool>[]>(l_Texture.levelCount);
+    if (l_File.isSupercompressed())
+    {
+        // Smallest first, they are needed first and take the least time
+        l_Texture.decoded.resize(l_Texture.levelCount);
+        for (uint32_t i = l_Texture.levelCount; i-- > 0;)
+            m_JobSystem->submit([this, &l_Texture, i] { decodeLevel(l_Texture, i); }, &l_Texture.decodeCounter);
+    }
+    else
+    {
+        for (uint32_t i = 0; i < l_Texture.levelCount; i++)
+            l_Texture.levelReady[i].store(true, std::memory_order_relaxed);
+    }
+
+    l_Texture.bindlessIndex = m_BindlessTable->registerTexture();
+    m_Stats.textureCount = static_cast<uint32_t>(m_Textures.size());
+    return static_cast<TextureHandle>(m_Textures.size() - 1);
+}
+
+void TextureStreamer::update()
+{
+    for (const std::unique_ptr<Texture>& l_Texture : m_Textures)
+    {
+        if (l_Texture->pendingTicket != UploadService::INVALID_TICKET && m_UploadService->isSubmitted(l_Texture->pendingTicket))
+            finishTransfer(*l_Texture);
+
+        if (l_Texture->failed.load(std::memory_order_acquire) && !l_Texture->errorReported)
+        {
+            std::scoped_lock l_Lock{ l_Texture->errorMutex };
+            m_Stats.failedTextures++;
+            m_Stats.lastError = l_Texture->path + ": " + l_Texture->error;
+            l_Texture->errorReported = true;
+        }
+    }
+
+    chooseTargets();
+
+    // Textures without anything resident go first and only get their tail, the rest then moves towards its target
+    VkDeviceSize l_ResidentBytes = 0;
+    for (const std::unique_ptr<Texture>& l_Texture : m_Textures)
+        l_ResidentBytes += getBytesFrom(*l_Texture, l_Texture->residentLevel);
+
+    std::vector<Texture*> l_Candidates{};
+    for (const std::unique_ptr<Texture>& l_Texture : m_Textures)
+    {
+        if (l_Texture->pendingTicket != UploadService::INVALID_TICKET || l_Texture->errorReported || l_Texture->targetLevel == l_Texture->residentLevel)
+            continue;
+        // Dropping levels costs a transfer too, only worth it when over budget
+        if (l_Texture->targetLevel > l_Texture->residentLevel && l_ResidentBytes <= m_Budget)
+            continue;
+        l_Candidates.push_back(l_Texture.get());
+    }
+    std::ranges::stable_partition(l_Candidates, [](const Texture* p_Texture) { return p_Texture->residentLevel == p_Texture->levelCount; });
+
+    for (Texture* l_Texture : l_Candidates)
+    {
+        const bool l_Empty = l_Texture->residentLevel == l_Texture->levelCount;
+        const uint32_t l_FirstLevel = l_Empty ? std::max(l_Texture->targetLevel, l_Texture->tailLevel) : l_Texture->targetLevel;
+        if (!areLevelsReady(*l_Texture, l_FirstLevel))
+            continue;
+
+        const VkDeviceSize l_Bytes = getBytesFrom(*l_Texture, l_FirstLevel);
+        const VkDeviceSize l_StagingUsed = m_UploadService->getStagingUsed();
+        if (l_StagingUsed != 0 && l_Bytes > m_UploadService->getStagingCapacity() - l_StagingUsed)
+            break;
+        startTransfer(*l_Texture, l_FirstLevel);
+    }
+    m_UploadService->flush();
+
+    m_Stats.transfersInFlight = 0;
+    m_Stats.residentBytes = 0;
+    for (const std::unique_ptr<Texture>& l_Texture : m_Textures)
+    {
+        m_Stats.transfersInFlight += l_Texture->pendingTicket != UploadService::INVALID_TICKET ? 1 : 0;
+        m_Stats.residentBytes += getBytesFrom(*l_Texture, l_Texture->residentLevel);
+    }
+}
+
+void TextureStreamer::decodeLevel(Texture& p_Texture, const uint32_t p_Level)
+{
+    // Jobs must not throw, the failure is reported by the next update
+    try
+    {
+        std::vector<uint8_t>& l_Level = p_Texture.decoded[p_Level];
+        l_Level.resize(p_Texture.file.getLevelSize(p_Level));
+        p_Texture.file.decodeLevel(p_Level, l_Level);
+        p_Texture.levelReady[p_Level].store(true, std::memory_order_release);
+    }
+    catch (const std::exception& l_Exception)
+    {
+        std::scoped_lock l_Lock{ p_Texture.errorMutex };
+        if (p_Texture.error.empty())
+            p_Texture.error = l_Exception.what();
+        p_Texture.failed.store(true, std::memory_order_release);
+    }
+}
+
+std::span<const uint8_t> TextureStreamer::getLevelData(const Texture& p_Texture, const uint32_t p_Level) const
+{
+    return p_Texture.decoded.empty() ? p_Texture.file.getLevelData(p_Level) : std::span<const uint8_t>{ p_Texture.decoded[p_Level] };
+}
+
+VkDeviceSize TextureStreamer::getBytesFrom(const Texture& p_Texture, const uint32_t p_FirstLevel)
+{
+    VkDeviceSize l_Bytes = 0;
+    for (uint32_t i = p_FirstLevel; i < p_Texture.levelCount; i++)
+        l_Bytes += p_Texture.file.getLevelSize(i);
+    return l_Bytes;
+}
+
+bool TextureStreamer::areLevelsReady(const Texture& p_Texture, const uint32_t p_FirstLevel)
+{
+    for (uint32_t i = p_FirstLevel; i < p_Texture.levelCount; i++)
+    {
+        if (!p_Texture.levelReady[i].load(std::memory_order_acquire))
+            return false;
+    }
+    return true;
+}
+
+void TextureStreamer::chooseTargets()
+{
+    // The level whose size still covers the demand, the tail at the least
+    VkDeviceSize l_Total = 0;
+    for (const std::unique_ptr<Texture>& l_Texture : m_Textures)
+    {
+        const VkExtent3D l_Extent = l_Texture->file.getLevelExtent(0);
+        const float l_Size = static_cast<float>(std::max(l_Extent.width, l_Extent.height));
+        uint32_t l_Level = l_Texture->tailLevel;
+        if (l_Texture->demand > 0.0f)
+            l_Level = std::min(static_cast<uint32_t>(std::max(std::floor(std::log2(l_Size / l_Texture->demand)), 0.0f)), l_Texture->tailLevel);
+        l_Texture->targetLevel = l_Level;
+        l_Total += getBytesFrom(*l_Texture, l_Level);
+    }
+    m_Stats.requestedBytes = l_Total;
+
+    // Over budget the largest texture gives up its top level until everything fits or only tails are left
+    while (l_Total > m_Budget)
+    {
+        Texture* l_Largest = nullptr;
+        VkDeviceSize l_LargestBytes = 0;
+        for (const std::unique_ptr<Texture>& l_Texture : m_Textures)
+        {
+            const VkDeviceSize l_Bytes = getBytesFrom(*l_Texture, l_Texture->targetLevel);
+            if (l_Texture->targetLevel < l_Texture->tailLevel && l_Bytes > l_LargestBytes)
+            {
+                l_Largest = l_Texture.get();
+                l_LargestBytes = l_Bytes;
+            }
+        }
+        if (l_Largest == nullptr)
+            break;
+        l_Total -= l_Largest->file.getLevelSize(l_Largest->targetLevel);
+        l_Largest->targetLevel++;
+    }
+}
+
+void TextureStreamer::startTransfer(Texture& p_Texture, const uint32_t p_FirstLevel)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    const Ktx2File& l_File = p_Texture.file;
+    const uint32_t l_LevelCount = p_Texture.levelCount - p_FirstLevel;
+
+    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
+        .preferredProperties = VK_MEMORY_PROPERTY_DEVICE_LOCAL_BIT
+    };
+    p_Texture.pendingImageID = l_Device.createAndAllocateImage(l_MemPrefs, {VK_IMAGE_TYPE_2D, l_File.getFormat(), l_File.getLevelExtent(p_FirstLevel), VK_IMAGE_USAGE_SAMPLED_BIT | VK_IMAGE_USAGE_TRANSFER_DST_BIT, 0, l_LevelCount});
+    p_Texture.pendingViewID = l_Device.getImage(p_Texture.pendingImageID).createImageView(l_File.getFormat(), VK_IMAGE_ASPECT_COLOR_BIT);
+    p_Texture.pendingLevel = p_FirstLevel;
+
+    // Smallest first, the transfer queue works through them in order
+    for (uint32_t i = p_Texture.levelCount; i-- > p_FirstLevel;)
+    {
+        const std::span<const uint8_t> l_Data = getLevelData(p_Texture, i);
+        ImageUploadRegion l_Region{ l_File.getLevelExtent(i) };
+        l_Region.mipLevel = i - p_FirstLevel;
+        l_Region.blockHeight = l_File.getBlockHeight();
+        p_Texture.pendingTicket = m_UploadService->uploadImage(p_Texture.pendingImageID, l_Data.data(), l_Data.size(), l_Region);
+        m_Stats.uploadedBytes += l_Data.size();
+    }
+}
+
+void TextureStreamer::finishTransfer(Texture& p_Texture)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+
+    // Frames already recorded may still sample the old image, the bindless table stops pointing at it from this frame on
+    if (p_Texture.imageID != UINT32_MAX)
+        m_DeferredRelease->release(DeferredResource::IMAGE, p_Texture.imageID);
+    m_BindlessTable->updateTexture(p_Texture.bindlessIndex, *l_Device.getImage(p_Texture.pendingImageID).getImageView(p_Texture.pendingViewID));
+
+    p_Texture.imageID = p_Texture.pendingImageID;
+    p_Texture.residentLevel = p_Texture.pendingLevel;
+    p_Texture.pendingImageID = UINT32_MAX;
+    p_Texture.pendingViewID = UINT32_MAX;
+    p_Texture.pendingTicket = UploadService::INVALID_TICKET;
+}
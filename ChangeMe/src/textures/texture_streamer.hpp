@@ -0,0 +1,121 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+#include "jobs/job_system.hpp"
+#include "resources/bindless_table.hpp"
+#include "resources/deferred_release_queue.hpp"
+#include "textures/ktx2_file.hpp"
+#include "upload/upload_service.hpp"
+
+using TextureHandle = uint32_t;
+
+struct TextureStreamStats
+{
+    uint32_t textureCount = 0;
+    uint32_t transfersInFlight = 0;
+    // What demand asks for before the budget is applied
+    VkDeviceSize requestedBytes = 0;
+    VkDeviceSize residentBytes = 0;
+    uint64_t uploadedBytes = 0;
+    // Textures whose levels couldn't be decoded, they keep sampling whatever was resident before
+    uint32_t failedTextures = 0;
+    // Path and reason of the most recent one
+    std::string lastError{};
+};
+
+// KTX2 textures whose resident mip levels follow screen space demand within a VRAM budget. Every level is decoded on the
+// job system as soon as the texture is loaded and kept in memory, smallest first, so the mip tail is ready almost at once.
+// Changing residency builds a new image holding the wanted levels, uploads them smallest first and swaps it in behind the
+// texture's bindless index once the transfer is submitted, the old image goes through the deferred release queue.
+// Frames never wait on any of it, until a level is resident the coarser ones or the white texture are sampled
+class TextureStreamer
+{
+public:
+    // Levels up to this size are wanted even without demand, budget permitting
+    static constexpr uint32_t MIP_TAIL_SIZE = 128;
+
+    void init(ResourceID p_DeviceID, JobSystem& p_JobSystem, UploadService& p_UploadService, BindlessTable& p_BindlessTable, DeferredReleaseQueue& p_DeferredRelease, VkDeviceSize p_Budget);
+    // Waits for pending decodes, the device must be idle
+    void free();
+
+    // Parses the container right away and throws if it can't be streamed. The bindless index is valid from here on
+    [[nodiscard]] TextureHandle load(std::string_view p_Path);
+
+    // Screen pixels covered by one repeat of the texture, 0 only asks for the mip tail
+    void setDemand(TextureHandle p_Texture, float p_Pixels) { m_Textures[p_Texture]->demand = p_Pixels; }
+    void setBudget(VkDeviceSize p_Budget) { m_Budget = p_Budget; }
+
+    // Render thread, once per frame before the bindless table begins it. Starts a transfer only when the staging ring
+    // has room for it, so it never blocks unless a single residency change is larger than the whole ring
+    void update();
+
+    [[nodiscard]] BindlessIndex getBindlessIndex(const TextureHandle p_Texture) const { return m_Textures[p_Texture]->bindlessIndex; }
+    // Level count of the texture when nothing is resident yet
+    [[nodiscard]] uint32_t getResidentLevel(const TextureHandle p_Texture) const { return m_Textures[p_Texture]->residentLevel; }
+    [[nodiscard]] uint32_t getTextureCount() const { return static_cast<uint32_t>(m_Textures.size()); }
+    [[nodiscard]] VkDeviceSize getBudget() const { return m_Budget; }
+    [[nodiscard]] const TextureStreamStats& getStats() const { return m_Stats; }
+
+private:
+    struct Texture
+    {
+        explicit Texture(const std::string_view p_Path) : file(p_Path), path(p_Path) {}
+
+        Ktx2File file;
+        std::string path;
+        uint32_t levelCount = 0;
+        uint32_t tailLevel = 0;
+        BindlessIndex bindlessIndex = BindlessTable::INVALID_INDEX;
+
+        // Written by the decode jobs, a level is only read once its flag is set. Empty for files stored uncompressed
+        std::vector<std::vector<uint8_t>> decoded{};
+        std::unique_ptr<std::atomic<bool>[]> levelReady{};
+        JobCounter decodeCounter{};
+        std::atomic<bool> failed{ false };
+        std::mutex errorMutex{};
+        std::string error{};
+        bool errorReported = false;
+
+        float demand = 0.0f;
+        uint32_t residentLevel = 0;
+        uint32_t targetLevel = 0;
+        ResourceID imageID = UINT32_MAX;
+
+        // Replacement image whose levels are being uploaded
+        ResourceID pendingImageID = UINT32_MAX;
+        ResourceID pendingViewID = UINT32_MAX;
+        uint32_t pendingLevel = 0;
+        UploadTicket pendingTicket = UploadService::INVALID_TICKET;
+    };
+
+    void decodeLevel(Texture& p_Texture, uint32_t p_Level);
+    [[nodiscard]] std::span<const uint8_t> getLevelData(const Texture& p_Texture, uint32_t p_Level) const;
+    // Bytes of every level from p_FirstLevel down to the smallest one
+    [[nodiscard]] static VkDeviceSize getBytesFrom(const Texture& p_Texture, uint32_t p_FirstLevel);
+    [[nodiscard]] static bool areLevelsReady(const Texture& p_Texture, uint32_t p_FirstLevel);
+
+    void chooseTargets();
+    void startTransfer(Texture& p_Texture, uint32_t p_FirstLevel);
+    void finishTransfer(Texture& p_Texture);
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    JobSystem* m_JobSystem = nullptr;
+    UploadService* m_UploadService = nullptr;
+    BindlessTable* m_BindlessTable = nullptr;
+    DeferredReleaseQueue* m_DeferredRelease = nullptr;
+    VkDeviceSize m_Budget = 0;
+
+    // Decode jobs hold on to their texture, so textures never move
+    std::vector<std::unique_ptr<Texture>> m_Textures{};
+    TextureStreamStats m_Stats{};
+};
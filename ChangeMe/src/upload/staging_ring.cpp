@@ -0,0 +1,88 @@
+#include "staging_ring.hpp"
+
+#include "vulkan_buffer.hpp"
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+
+static VkDeviceSize alignUp(const VkDeviceSize p_Value, const VkDeviceSize p_Alignment)
+{
+    return (p_Value + p_Alignment - 1) / p_Alignment * p_Alignment;
+}
+
+void StagingRing::init(const ResourceID p_DeviceID, const uint32_t p_FamilyIndex, const VkDeviceSize p_Capacity)
+{
+    m_DeviceID = p_DeviceID;
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    VulkanMemoryAllocator::MemoryPreferences l_MemPrefs {
+        .preferredProperties = VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT | VK_MEMORY_PROPERTY_HOST_COHERENT_BIT
+    };
+    m_BufferID = l_Device.createAndAllocateBuffer(l_MemPrefs, {p_Capacity, VK_BUFFER_USAGE_TRANSFER_SRC_BIT, p_FamilyIndex});
+    m_Data = static_cast<uint8_t*>(l_Device.getBuffer(m_BufferID).map(p_Capacity, 0));
+    m_Capacity = p_Capacity;
+    m_Head = 0;
+    m_Tail = 0;
+    m_Used = 0;
+}
+
+void StagingRing::free()
+{
+    if (m_BufferID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    l_Device.getBuffer(m_BufferID).unmap();
+    l_Device.freeBuffer(m_BufferID);
+    m_BufferID = UINT32_MAX;
+    m_Data = nullptr;
+    m_Capacity = 0;
+}
+
+bool StagingRing::allocate(const VkDeviceSize p_Size, const VkDeviceSize p_Alignment, VkDeviceSize& p_Offset)
+{
+    // An empty ring starts over from the beginning so the next allocation gets the whole buffer
+    if (m_Used == 0)
+    {
+        m_Head = 0;
+        m_Tail = 0;
+    }
+    else if (m_Used == m_Capacity)
+    {
+        return false;
+    }
+
+    const VkDeviceSize l_Aligned = alignUp(m_Head, p_Alignment);
+    if (m_Head >= m_Tail)
+    {
+        if (l_Aligned + p_Size <= m_Capacity)
+        {
+            m_Used += l_Aligned + p_Size - m_Head;
+            p_Offset = l_Aligned;
+            m_Head = l_Aligned + p_Size;
+            return true;
+        }
+        // Wrap around, the unused tail end of the buffer is accounted as consumed until the space before it is released
+        if (p_Size <= m_Tail)
+        {
+            m_Used += m_Capacity - m_Head + p_Size;
+            p_Offset = 0;
+            m_Head = p_Size;
+            return true;
+        }
+        return false;
+    }
+
+    if (l_Aligned + p_Size <= m_Tail)
+    {
+        m_Used += l_Aligned + p_Size - m_Head;
+        p_Offset = l_Aligned;
+        m_Head = l_Aligned + p_Size;
+        return true;
+    }
+    return false;
+}
+
+void StagingRing::release(const VkDeviceSize p_Marker, const VkDeviceSize p_Bytes)
+{
+    m_Tail = p_Marker;
+    m_Used = p_Bytes < m_Used ? m_Used - p_Bytes : 0;
+}
@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+// Persistently mapped host visible buffer handed out front to back. Space is given back in allocation order through
+// the markers returned by getHead, which is how the transfer batches retire
+class StagingRing
+{
+public:
+    void init(ResourceID p_DeviceID, uint32_t p_FamilyIndex, VkDeviceSize p_Capacity);
+    void free();
+
+    // Returns false when there is no contiguous room left, nothing is consumed in that case
+    [[nodiscard]] bool allocate(VkDeviceSize p_Size, VkDeviceSize p_Alignment, VkDeviceSize& p_Offset);
+    void release(VkDeviceSize p_Marker, VkDeviceSize p_Bytes);
+
+    [[nodiscard]] VkDeviceSize getHead() const { return m_Head; }
+    [[nodiscard]] VkDeviceSize getUsed() const { return m_Used; }
+    [[nodiscard]] VkDeviceSize getCapacity() const { return m_Capacity; }
+    [[nodiscard]] ResourceID getBufferID() const { return m_BufferID; }
+    [[nodiscard]] uint8_t* getData() const { return m_Data; }
+
+private:
+    ResourceID m_DeviceID = UINT32_MAX;
+    ResourceID m_BufferID = UINT32_MAX;
+    uint8_t* m_Data = nullptr;
+
+    VkDeviceSize m_Capacity = 0;
+    VkDeviceSize m_Head = 0;
+    VkDeviceSize m_Tail = 0;
+    VkDeviceSize m_Used = 0;
+};
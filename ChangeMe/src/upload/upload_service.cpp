@@ -0,0 +1,413 @@
+#include "upload_service.hpp"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include "vulkan_buffer.hpp"
+#include "vulkan_context.hpp"
+#include "vulkan_device.hpp"
+#include "vulkan_image.hpp"
+#include "vulkan_sync.hpp"
+
+// Buffer copies only need 4 byte aligned offsets, image copies need a multiple of the texel block size and 16 covers every format we upload
+static constexpr VkDeviceSize BUFFER_ALIGNMENT = 4;
+static constexpr VkDeviceSize IMAGE_ALIGNMENT = 16;
+
+void UploadService::init(const ResourceID p_DeviceID, const QueueFamily& p_TransferFamily, const QueueSelection p_TransferQueue, const QueueSelection p_GraphicsQueue, const VkDeviceSize p_ChunkSize, const uint32_t p_ChunkCount)
+{
+    // With two chunks or more the batch being recorded always finds room once every other batch has retired
+    if (p_ChunkSize == 0 || p_ChunkCount < 2)
+        throw std::runtime_error("Upload staging needs a non empty chunk size and at least 2 chunks");
+
+    m_DeviceID = p_DeviceID;
+    m_TransferFamily = p_TransferFamily;
+    m_TransferQueue = p_TransferQueue;
+    m_GraphicsQueue = p_GraphicsQueue;
+    m_OwnershipTransfer = p_TransferQueue.familyIndex != p_GraphicsQueue.familyIndex;
+    m_ChunkSize = p_ChunkSize;
+    m_Ring.init(p_DeviceID, p_TransferQueue.familyIndex, p_ChunkSize * p_ChunkCount);
+    m_Stats = {};
+}
+
+void UploadService::free()
+{
+    if (m_DeviceID == UINT32_MAX)
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    for (Batch& l_Batch : m_InFlight)
+    {
+        l_Device.getFence(l_Batch.fenceID).wait();
+        m_FreeBatches.push_back(std::move(l_Batch));
+    }
+    m_InFlight.clear();
+    if (m_Recording.commandBufferID != UINT32_MAX)
+        m_FreeBatches.push_back(std::move(m_Recording));
+
+    for (Batch& l_Batch : m_FreeBatches)
+    {
+        l_Device.freeCommandBuffer(l_Batch.commandBufferID, 0);
+        l_Device.freeFence(l_Batch.fenceID);
+        l_Device.freeSemaphore(l_Batch.semaphoreID);
+    }
+    m_FreeBatches.clear();
+    m_Ring.free();
+    m_DeviceID = UINT32_MAX;
+}
+
+UploadTicket UploadService::uploadBuffer(const ResourceID p_BufferID, const void* p_Data, const VkDeviceSize p_Size, const VkDeviceSize p_DstOffset)
+{
+    const uint8_t* l_Src = static_cast<const uint8_t*>(p_Data);
+    VkDeviceSize l_Done = 0;
+    UploadTicket l_Ticket = INVALID_TICKET;
+    while (l_Done < p_Size)
+    {
+        Batch& l_Batch = getRecordingBatch();
+        const VkDeviceSize l_Bytes = std::min(p_Size - l_Done, m_ChunkSize - l_Batch.stagingBytes);
+        const VkDeviceSize l_Offset = allocateStaging(l_Batch, l_Bytes, BUFFER_ALIGNMENT);
+
+        std::memcpy(m_Ring.getData() + l_Offset, l_Src + l_Done, l_Bytes);
+        l_Batch.bufferCopies.push_back({ p_BufferID, { l_Offset, p_DstOffset + l_Done, l_Bytes } });
+        l_Done += l_Bytes;
+        l_Ticket = l_Batch.ticket;
+    }
+    return l_Ticket;
+}
+
+UploadTicket UploadService::uploadImage(const ResourceID p_ImageID, const void* p_Data, const VkDeviceSize p_Size, const ImageUploadRegion& p_Region)
+{
+    // 2D regions are split in block rows, 3D regions in slices, so every chunk is still a box of the image
+    const bool l_SplitSlices = p_Region.extent.depth > 1;
+    const uint32_t l_RowsPerUnit = l_SplitSlices ? 1 : std::max(p_Region.blockHeight, 1U);
+    const uint32_t l_UnitCount = l_SplitSlices ? p_Region.extent.depth : (p_Region.extent.height + l_RowsPerUnit - 1) / l_RowsPerUnit;
+    const VkDeviceSize l_UnitSize = p_Size / l_UnitCount;
+    if (l_UnitSize > m_ChunkSize)
+        throw std::runtime_error("Image upload needs chunks of at least " + std::to_string(l_UnitSize) + " bytes");
+
+    const uint8_t* l_Src = static_cast<const uint8_t*>(p_Data);
+    uint32_t l_Done = 0;
+    UploadTicket l_Ticket = INVALID_TICKET;
+    while (l_Done < l_UnitCount)
+    {
+        Batch& l_Batch = getRecordingBatch();
+        const uint32_t l_Units = static_cast<uint32_t>(std::min<VkDeviceSize>(l_UnitCount - l_Done, (m_ChunkSize - l_Batch.stagingBytes) / l_UnitSize));
+        if (l_Units == 0)
+        {
+            flush();
+            continue;
+        }
+
+        const VkDeviceSize l_Bytes = l_Units * l_UnitSize;
+        const VkDeviceSize l_Offset = allocateStaging(l_Batch, l_Bytes, IMAGE_ALIGNMENT);
+        std::memcpy(m_Ring.getData() + l_Offset, l_Src + l_Done * l_UnitSize, l_Bytes);
+
+        ImageUploadRegion l_Region = p_Region;
+        if (l_SplitSlices)
+        {
+            l_Region.offset.z += static_cast<int32_t>(l_Done);
+            l_Region.extent.depth = l_Units;
+        }
+        else
+        {
+            // The last block row may be partial when the height isn't a multiple of the block
+            l_Region.offset.y += static_cast<int32_t>(l_Done * l_RowsPerUnit);
+            l_Region.extent.height = std::min(l_Units * l_RowsPerUnit, p_Region.extent.height - l_Done * l_RowsPerUnit);
+        }
+        l_Batch.imageCopies.push_back({ p_ImageID, l_Offset, l_Region, l_Done == 0, l_Done + l_Units == l_UnitCount });
+        l_Done += l_Units;
+        l_Ticket = l_Batch.ticket;
+    }
+    return l_Ticket;
+}
+
+void UploadService::flush()
+{
+    if (m_Recording.ticket == INVALID_TICKET || (m_Recording.bufferCopies.empty() && m_Recording.imageCopies.empty()))
+        return;
+
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    recordBatch(m_Recording);
+
+    l_Device.getFence(m_Recording.fenceID).reset();
+    const std::array<ResourceID, 1> l_SignalSemaphores = { m_Recording.semaphoreID };
+    l_Device.getCommandBuffer(m_Recording.commandBufferID, 0).submit(l_Device.getQueue(m_TransferQueue), {}, l_SignalSemaphores, m_Recording.fenceID);
+
+    m_Recording.state = BatchState::SUBMITTED;
+    m_Recording.submitTime = std::chrono::steady_clock::now();
+    m_LastSubmitted = m_Recording.ticket;
+    m_InFlight.push_back(std::move(m_Recording));
+    m_Recording = {};
+}
+
+void UploadService::update()
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    retireFinished(INVALID_TICKET);
+
+    // The semaphore of a finished batch stays in use until the graphics frame that waited on it is done as well
+    while (!m_InFlight.empty())
+    {
+        Batch& l_Batch = m_InFlight.front();
+        if (l_Batch.ticket > m_LastCompleted || l_Batch.state != BatchState::ACQUIRED)
+            break;
+        if (vkGetFenceStatus(*l_Device, *l_Device.getFence(l_Batch.consumerFenceID)) != VK_SUCCESS)
+            break;
+
+        l_Batch.bufferCopies.clear();
+        l_Batch.imageCopies.clear();
+        l_Batch.consumerFenceID = UINT32_MAX;
+        m_FreeBatches.push_back(std::move(l_Batch));
+        m_InFlight.pop_front();
+    }
+}
+
+bool UploadService::isSubmitted(const UploadTicket p_Ticket) const
+{
+    return p_Ticket != INVALID_TICKET && p_Ticket <= m_LastSubmitted;
+}
+
+bool UploadService::isComplete(const UploadTicket p_Ticket) const
+{
+    return p_Ticket != INVALID_TICKET && p_Ticket <= m_LastCompleted;
+}
+
+void UploadService::wait(const UploadTicket p_Ticket)
+{
+    if (!isSubmitted(p_Ticket))
+        flush();
+    retireFinished(p_Ticket);
+}
+
+void UploadService::acquireOnGraphics(const VkCommandBuffer p_CmdBuffer, const ResourceID p_FrameFenceID, std::vector<VulkanCommandBuffer::WaitSemaphoreData>& p_WaitSemaphores)
+{
+    std::vector<VkBufferMemoryBarrier> l_BufferBarriers{};
+    std::vector<VkImageMemoryBarrier> l_ImageBarriers{};
+    for (Batch& l_Batch : m_InFlight)
+    {
+        if (l_Batch.state != BatchState::SUBMITTED)
+            continue;
+
+        if (m_OwnershipTransfer)
+        {
+            for (const BufferCopy& l_Copy : l_Batch.bufferCopies)
+                fillBufferBarrier(l_BufferBarriers.emplace_back(), l_Copy, true);
+        }
+        for (const ImageCopy& l_Copy : l_Batch.imageCopies)
+        {
+            if (l_Copy.lastChunk)
+                fillImageBarrier(l_ImageBarriers.emplace_back(), l_Copy, true);
+        }
+
+        p_WaitSemaphores.push_back({ l_Batch.semaphoreID, CONSUMER_STAGES });
+        l_Batch.state = BatchState::ACQUIRED;
+        l_Batch.consumerFenceID = p_FrameFenceID;
+    }
+
+    if (l_BufferBarriers.empty() && l_ImageBarriers.empty())
+        return;
+
+    vkCmdPipelineBarrier(p_CmdBuffer, CONSUMER_STAGES, CONSUMER_STAGES, 0,
+        0, nullptr,
+        static_cast<uint32_t>(l_BufferBarriers.size()), l_BufferBarriers.data(),
+        static_cast<uint32_t>(l_ImageBarriers.size()), l_ImageBarriers.data());
+}
+
+UploadService::Batch& UploadService::getRecordingBatch()
+{
+    if (m_Recording.ticket != INVALID_TICKET)
+    {
+        if (m_Recording.stagingBytes < m_ChunkSize)
+            return m_Recording;
+        flush();
+    }
+
+    if (!m_FreeBatches.empty())
+    {
+        m_Recording = std::move(m_FreeBatches.back());
+        m_FreeBatches.pop_back();
+    }
+    else
+    {
+        createBatchObjects(m_Recording);
+    }
+
+    m_Recording.ticket = m_NextTicket++;
+    m_Recording.state = BatchState::RECORDING;
+    m_Recording.stagingBytes = 0;
+    m_Recording.ringBytes = 0;
+    m_Recording.ringMarker = m_Ring.getHead();
+    return m_Recording;
+}
+
+VkDeviceSize UploadService::allocateStaging(Batch& p_Batch, const VkDeviceSize p_Size, const VkDeviceSize p_Alignment)
+{
+    const VkDeviceSize l_UsedBefore = m_Ring.getUsed();
+    VkDeviceSize l_Offset = 0;
+    while (!m_Ring.allocate(p_Size, p_Alignment, l_Offset))
+    {
+        // Ring is full, wait for the oldest batch that still holds staging space. The recording batch can't be
+        // flushed here since its copies are still being appended, it never holds more than one chunk though
+        UploadTicket l_Oldest = INVALID_TICKET;
+        for (const Batch& l_InFlight : m_InFlight)
+        {
+            if (l_InFlight.ticket > m_LastCompleted)
+            {
+                l_Oldest = l_InFlight.ticket;
+                break;
+            }
+        }
+        if (l_Oldest == INVALID_TICKET)
+            throw std::runtime_error("Staging ring can't fit an upload of " + std::to_string(p_Size) + " bytes");
+        retireFinished(l_Oldest);
+    }
+
+    p_Batch.stagingBytes += p_Size;
+    p_Batch.ringBytes += m_Ring.getUsed() - l_UsedBefore;
+    p_Batch.ringMarker = m_Ring.getHead();
+    return l_Offset;
+}
+
+void UploadService::createBatchObjects(Batch& p_Batch)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    p_Batch.commandBufferID = l_Device.createCommandBuffer(m_TransferFamily, 0, false);
+    p_Batch.fenceID = l_Device.createFence(true);
+    p_Batch.semaphoreID = l_Device.createSemaphore();
+}
+
+void UploadService::recordBatch(Batch& p_Batch) const
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    VulkanCommandBuffer& l_CmdBuffer = l_Device.getCommandBuffer(p_Batch.commandBufferID, 0);
+    const VkBuffer l_Staging = *l_Device.getBuffer(m_Ring.getBufferID());
+
+    l_CmdBuffer.reset();
+    l_CmdBuffer.beginRecording();
+
+    // Images start undefined, every uploaded subresource is moved to TRANSFER_DST by its first chunk
+    std::vector<VkImageMemoryBarrier> l_ToTransfer{};
+    for (const ImageCopy& l_Copy : p_Batch.imageCopies)
+    {
+        if (!l_Copy.firstChunk)
+            continue;
+
+        VkImageMemoryBarrier& l_Barrier = l_ToTransfer.emplace_back();
+        l_Barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+        l_Barrier.srcAccessMask = 0;
+        l_Barrier.dstAccessMask = VK_ACCESS_TRANSFER_WRITE_BIT;
+        l_Barrier.oldLayout = VK_IMAGE_LAYOUT_UNDEFINED;
+        l_Barrier.newLayout = VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+        l_Barrier.srcQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        l_Barrier.dstQueueFamilyIndex = VK_QUEUE_FAMILY_IGNORED;
+        l_Barrier.image = *l_Device.getImage(l_Copy.imageID);
+        l_Barrier.subresourceRange = { l_Copy.region.aspect, l_Copy.region.mipLevel, 1, l_Copy.region.arrayLayer, 1 };
+    }
+    if (!l_ToTransfer.empty())
+    {
+        vkCmdPipelineBarrier(*l_CmdBuffer, VK_PIPELINE_STAGE_TOP_OF_PIPE_BIT, VK_PIPELINE_STAGE_TRANSFER_BIT, 0,
+            0, nullptr, 0, nullptr, static_cast<uint32_t>(l_ToTransfer.size()), l_ToTransfer.data());
+    }
+
+    for (const BufferCopy& l_Copy : p_Batch.bufferCopies)
+    {
+        vkCmdCopyBuffer(*l_CmdBuffer, l_Staging, *l_Device.getBuffer(l_Copy.bufferID), 1, &l_Copy.region);
+    }
+    for (const ImageCopy& l_Copy : p_Batch.imageCopies)
+    {
+        VkBufferImageCopy l_Region{};
+        l_Region.bufferOffset = l_Copy.stagingOffset;
+        l_Region.imageSubresource = { l_Copy.region.aspect, l_Copy.region.mipLevel, l_Copy.region.arrayLayer, 1 };
+        l_Region.imageOffset = l_Copy.region.offset;
+        l_Region.imageExtent = l_Copy.region.extent;
+        vkCmdCopyBufferToImage(*l_CmdBuffer, l_Staging, *l_Device.getImage(l_Copy.imageID), VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL, 1, &l_Region);
+    }
+
+    // Release half of the ownership transfer, the acquire half is recorded by acquireOnGraphics
+    std::vector<VkBufferMemoryBarrier> l_BufferBarriers{};
+    if (m_OwnershipTransfer)
+    {
+        l_BufferBarriers.resize(p_Batch.bufferCopies.size());
+        for (size_t i = 0; i < p_Batch.bufferCopies.size(); i++)
+            fillBufferBarrier(l_BufferBarriers[i], p_Batch.bufferCopies[i], false);
+    }
+    std::vector<VkImageMemoryBarrier> l_ImageBarriers{};
+    for (const ImageCopy& l_Copy : p_Batch.imageCopies)
+    {
+        if (l_Copy.lastChunk)
+            fillImageBarrier(l_ImageBarriers.emplace_back(), l_Copy, false);
+    }
+
+    if (!l_BufferBarriers.empty() || !l_ImageBarriers.empty())
+    {
+        vkCmdPipelineBarrier(*l_CmdBuffer, VK_PIPELINE_STAGE_TRANSFER_BIT, VK_PIPELINE_STAGE_BOTTOM_OF_PIPE_BIT, 0,
+            0, nullptr,
+            static_cast<uint32_t>(l_BufferBarriers.size()), l_BufferBarriers.data(),
+            static_cast<uint32_t>(l_ImageBarriers.size()), l_ImageBarriers.data());
+    }
+
+    l_CmdBuffer.endRecording();
+}
+
+bool UploadService::isBatchFinished(const Batch& p_Batch) const
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    return vkGetFenceStatus(*l_Device, *l_Device.getFence(p_Batch.fenceID)) == VK_SUCCESS;
+}
+
+void UploadService::retireFinished(const UploadTicket p_WaitTicket)
+{
+    VulkanDevice& l_Device = VulkanContext::getDevice(m_DeviceID);
+    for (const Batch& l_Batch : m_InFlight)
+    {
+        if (l_Batch.ticket <= m_LastCompleted)
+            continue;
+        if (l_Batch.ticket <= p_WaitTicket)
+            l_Device.getFence(l_Batch.fenceID).wait();
+        else if (!isBatchFinished(l_Batch))
+            break;
+
+        m_Ring.release(l_Batch.ringMarker, l_Batch.ringBytes);
+        m_LastCompleted = l_Batch.ticket;
+
+        // Completion is only observed when polled, so back to back batches are timed from the previous retirement
+        // rather than from their own submission to avoid counting the same busy time twice
+        const std::chrono::steady_clock::time_point l_Now = std::chrono::steady_clock::now();
+        const std::chrono::steady_clock::time_point l_Start = std::max(l_Batch.submitTime, m_LastRetireTime);
+        const double l_Seconds = std::chrono::duration<double>(l_Now - l_Start).count();
+        m_Stats.bytes += l_Batch.stagingBytes;
+        m_Stats.batches++;
+        m_Stats.busySeconds += l_Seconds;
+        if (l_Seconds > 0.0)
+            m_Stats.lastBatchMBps = static_cast<double>(l_Batch.stagingBytes) / (1024.0 * 1024.0) / l_Seconds;
+        m_LastRetireTime = l_Now;
+    }
+}
+
+void UploadService::fillBufferBarrier(VkBufferMemoryBarrier& p_Barrier, const BufferCopy& p_Copy, const bool p_Acquire) const
+{
+    p_Barrier = { VK_STRUCTURE_TYPE_BUFFER_MEMORY_BARRIER };
+    p_Barrier.srcAccessMask = p_Acquire ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+    p_Barrier.dstAccessMask = p_Acquire ? CONSUMER_ACCESS : 0;
+    p_Barrier.srcQueueFamilyIndex = m_TransferQueue.familyIndex;
+    p_Barrier.dstQueueFamilyIndex = m_GraphicsQueue.familyIndex;
+    p_Barrier.buffer = *VulkanContext::getDevice(m_DeviceID).getBuffer(p_Copy.bufferID);
+    p_Barrier.offset = p_Copy.region.dstOffset;
+    p_Barrier.size = p_Copy.region.size;
+}
+
+void UploadService::fillImageBarrier(VkImageMemoryBarrier& p_Barrier, const ImageCopy& p_Copy, const bool p_Acquire) const
+{
+    // Without an ownership transfer the layout change happens entirely on the transfer queue
+    p_Barrier = { VK_STRUCTURE_TYPE_IMAGE_MEMORY_BARRIER };
+    p_Barrier.srcAccessMask = p_Acquire ? 0 : VK_ACCESS_TRANSFER_WRITE_BIT;
+    p_Barrier.dstAccessMask = p_Acquire ? CONSUMER_ACCESS : 0;
+    p_Barrier.oldLayout = p_Acquire && !m_OwnershipTransfer ? p_Copy.region.finalLayout : VK_IMAGE_LAYOUT_TRANSFER_DST_OPTIMAL;
+    p_Barrier.newLayout = p_Copy.region.finalLayout;
+    p_Barrier.srcQueueFamilyIndex = m_OwnershipTransfer ? m_TransferQueue.familyIndex : VK_QUEUE_FAMILY_IGNORED;
+    p_Barrier.dstQueueFamilyIndex = m_OwnershipTransfer ? m_GraphicsQueue.familyIndex : VK_QUEUE_FAMILY_IGNORED;
+    p_Barrier.image = *VulkanContext::getDevice(m_DeviceID).getImage(p_Copy.imageID);
+    p_Barrier.subresourceRange = { p_Copy.region.aspect, p_Copy.region.mipLevel, 1, p_Copy.region.arrayLayer, 1 };
+}
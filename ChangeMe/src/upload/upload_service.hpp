@@ -0,0 +1,152 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <vector>
+#include <Volk/volk.h>
+#include <utils/identifiable.hpp>
+
+#include "vulkan_command_buffer.hpp"
+#include "vulkan_queues.hpp"
+#include "upload/staging_ring.hpp"
+
+// Identifies the batch an upload was recorded into, tickets grow monotonically so a later ticket never completes first
+using UploadTicket = uint64_t;
+
+struct ImageUploadRegion
+{
+    VkExtent3D extent;
+    VkOffset3D offset{};
+    uint32_t mipLevel = 0;
+    uint32_t arrayLayer = 0;
+    VkImageAspectFlags aspect = VK_IMAGE_ASPECT_COLOR_BIT;
+    VkImageLayout finalLayout = VK_IMAGE_LAYOUT_SHADER_READ_ONLY_OPTIMAL;
+    // Texel rows per block row of block compressed formats, 2D uploads are only split between block rows
+    uint32_t blockHeight = 1;
+};
+
+struct UploadStats
+{
+    uint64_t bytes = 0;
+    uint64_t batches = 0;
+    double busySeconds = 0.0;
+    double lastBatchMBps = 0.0;
+
+    [[nodiscard]] double getMBps() const { return busySeconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / busySeconds : 0.0; }
+};
+
+class UploadService
+{
+public:
+    static constexpr UploadTicket INVALID_TICKET = 0;
+
+    // The staging ring holds p_ChunkCount chunks of p_ChunkSize bytes, each submitted batch carries at most one chunk
+    void init(ResourceID p_DeviceID, const QueueFamily& p_TransferFamily, QueueSelection p_TransferQueue, QueueSelection p_GraphicsQueue, VkDeviceSize p_ChunkSize, uint32_t p_ChunkCount);
+    void free();
+
+    // Data is copied into staging memory right away, the source can be released as soon as these return.
+    // Uploads bigger than a chunk are split over several batches and the returned ticket is the one of the last chunk.
+    // When the ring is full these block until the oldest batch in flight is done with its staging space
+    UploadTicket uploadBuffer(ResourceID p_BufferID, const void* p_Data, VkDeviceSize p_Size, VkDeviceSize p_DstOffset = 0);
+    UploadTicket uploadImage(ResourceID p_ImageID, const void* p_Data, VkDeviceSize p_Size, const ImageUploadRegion& p_Region);
+
+    // Records everything queued since the last flush and submits it to the transfer queue as a single batch
+    void flush();
+
+    // Retires finished batches, never blocks
+    void update();
+
+    [[nodiscard]] bool isSubmitted(UploadTicket p_Ticket) const;
+    [[nodiscard]] bool isComplete(UploadTicket p_Ticket) const;
+    void wait(UploadTicket p_Ticket);
+
+    // Records the queue family acquire barriers of every submitted batch into a graphics command buffer and appends
+    // the semaphores the graphics submission has to wait on. The frame fence tells when the semaphores can be reused
+    void acquireOnGraphics(VkCommandBuffer p_CmdBuffer, ResourceID p_FrameFenceID, std::vector<VulkanCommandBuffer::WaitSemaphoreData>& p_WaitSemaphores);
+
+    [[nodiscard]] const UploadStats& getStats() const { return m_Stats; }
+    [[nodiscard]] VkDeviceSize getStagingUsed() const { return m_Ring.getUsed(); }
+    [[nodiscard]] VkDeviceSize getStagingCapacity() const { return m_Ring.getCapacity(); }
+
+private:
+    static constexpr VkPipelineStageFlags CONSUMER_STAGES = VK_PIPELINE_STAGE_DRAW_INDIRECT_BIT | VK_PIPELINE_STAGE_VERTEX_INPUT_BIT |
+        VK_PIPELINE_STAGE_VERTEX_SHADER_BIT | VK_PIPELINE_STAGE_FRAGMENT_SHADER_BIT | VK_PIPELINE_STAGE_COMPUTE_SHADER_BIT;
+    static constexpr VkAccessFlags CONSUMER_ACCESS = VK_ACCESS_INDIRECT_COMMAND_READ_BIT | VK_ACCESS_VERTEX_ATTRIBUTE_READ_BIT |
+        VK_ACCESS_INDEX_READ_BIT | VK_ACCESS_UNIFORM_READ_BIT | VK_ACCESS_SHADER_READ_BIT;
+
+    enum class BatchState : uint8_t
+    {
+        RECORDING,
+        SUBMITTED,
+        ACQUIRED
+    };
+
+    struct BufferCopy
+    {
+        ResourceID bufferID;
+        VkBufferCopy region;
+    };
+
+    // Large images are split in whole rows, or whole slices for 3D images. Only the first chunk moves the
+    // subresource to TRANSFER_DST and only the last one hands it over to its final layout
+    struct ImageCopy
+    {
+        ResourceID imageID;
+        VkDeviceSize stagingOffset;
+        ImageUploadRegion region;
+        bool firstChunk;
+        bool lastChunk;
+    };
+
+    struct Batch
+    {
+        UploadTicket ticket = INVALID_TICKET;
+        BatchState state = BatchState::RECORDING;
+
+        ResourceID commandBufferID = UINT32_MAX;
+        ResourceID fenceID = UINT32_MAX;
+        ResourceID semaphoreID = UINT32_MAX;
+        ResourceID consumerFenceID = UINT32_MAX;
+
+        VkDeviceSize stagingBytes = 0;
+        VkDeviceSize ringMarker = 0;
+        VkDeviceSize ringBytes = 0;
+        std::chrono::steady_clock::time_point submitTime{};
+
+        std::vector<BufferCopy> bufferCopies{};
+        std::vector<ImageCopy> imageCopies{};
+    };
+
+    Batch& getRecordingBatch();
+    [[nodiscard]] VkDeviceSize allocateStaging(Batch& p_Batch, VkDeviceSize p_Size, VkDeviceSize p_Alignment);
+    void createBatchObjects(Batch& p_Batch);
+    void recordBatch(Batch& p_Batch) const;
+    [[nodiscard]] bool isBatchFinished(const Batch& p_Batch) const;
+
+    // Gives back the staging space of every finished batch, in order. Batches up to p_WaitTicket are waited on
+    void retireFinished(UploadTicket p_WaitTicket);
+
+    void fillBufferBarrier(VkBufferMemoryBarrier& p_Barrier, const BufferCopy& p_Copy, bool p_Acquire) const;
+    void fillImageBarrier(VkImageMemoryBarrier& p_Barrier, const ImageCopy& p_Copy, bool p_Acquire) const;
+
+    ResourceID m_DeviceID = UINT32_MAX;
+    QueueFamily m_TransferFamily;
+    QueueSelection m_TransferQueue;
+    QueueSelection m_GraphicsQueue;
+    bool m_OwnershipTransfer = false;
+
+    VkDeviceSize m_ChunkSize = 0;
+    StagingRing m_Ring{};
+
+    Batch m_Recording{};
+    std::deque<Batch> m_InFlight{};
+    std::vector<Batch> m_FreeBatches{};
+
+    UploadTicket m_NextTicket = 1;
+    UploadTicket m_LastSubmitted = INVALID_TICKET;
+    UploadTicket m_LastCompleted = INVALID_TICKET;
+
+    UploadStats m_Stats{};
+    std::chrono::steady_clock::time_point m_LastRetireTime{};
+};
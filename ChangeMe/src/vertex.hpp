@@ -1,9 +1,40 @@
 #pragma once
 
+#include <cstdint>
 #include <glm/glm.hpp>
+#include <glm/gtc/type_precision.hpp>
+
+enum class VertexFormat : uint32_t
+{
+    FULL = 0,
+    QUANTIZED = 1
+};
+constexpr uint32_t VERTEX_FORMAT_COUNT = 2;
 
 struct Vertex
 {
     glm::vec3 position;
+    glm::vec3 normal;
     glm::u8vec3 color;
-};
\ No newline at end of file
+};
+
+// 16 bytes instead of 28. Positions are unorm16 inside the mesh bounds and are brought back to object space by the
+// dequantization transform stored with the mesh, normals are octahedral encoded in two snorm16
+struct QuantizedVertex
+{
+    glm::u16vec4 position;
+    glm::i16vec2 normal;
+    glm::u8vec4 color;
+};
+
+static_assert(sizeof(QuantizedVertex) == 16, "QuantizedVertex must stay tightly packed");
+
+// Per instance data the vertex shader reads from a storage buffer, the transform is applied after the mesh model matrix.
+// Aligned so its size matches the std430 array stride of Instance in the shaders
+struct alignas(16) InstanceData
+{
+    glm::mat4 transform;
+    glm::u8vec4 color;
+};
+
+static_assert(sizeof(InstanceData) == 80, "InstanceData must match the std430 layout of the shaders");